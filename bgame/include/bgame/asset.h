@@ -32,17 +32,57 @@ typedef void (*bgame_asset_unload_fn_t)(
 	bgame_asset_bundle_t* bundle,
 	void* asset
 );
+// Runs on a worker thread so it must only read and decode files.
+// `bundle` is only for bgame_asset_malloc and bgame_asset_free.
+// The result is given to `load` through bgame_asset_decoded, NULL means error.
+typedef void* (*bgame_asset_decode_fn_t)(
+	bgame_asset_bundle_t* bundle,
+	const char* path,
+	const void* args
+);
+typedef void (*bgame_asset_free_decoded_fn_t)(
+	bgame_asset_bundle_t* bundle,
+	void* decoded
+);
+// Bytes held by a loaded asset, including what it uploaded to the GPU
+typedef size_t (*bgame_asset_measure_fn_t)(
+	bgame_asset_bundle_t* bundle,
+	const void* asset
+);
 
 typedef struct bgame_asset_type_s {
 	const char* name;
 	size_t size;
 	bgame_asset_load_fn_t load;
 	bgame_asset_unload_fn_t unload;
+
+	// Optional, for bgame_asset_begin_async_load.
+	// Async loads copy `args_size` bytes of their args until `load` runs.
+	size_t args_size;
+	bgame_asset_decode_fn_t decode;
+	bgame_asset_free_decoded_fn_t free_decoded;
+
+	// Optional, for bgame_asset_set_cache_budget.
+	// `size` is used when this is not set.
+	bgame_asset_measure_fn_t measure;
 } bgame_asset_type_t;
 
+typedef enum {
+	BGAME_ASSET_PENDING,
+	BGAME_ASSET_READY,
+	BGAME_ASSET_FAILED,
+} bgame_asset_status_t;
+
 void
 bgame_asset_begin_load(bgame_asset_bundle_t** bundle_ptr);
 
+// Same as bgame_asset_begin_load but types with a `decode` function are
+// decoded on worker threads.
+// bgame_asset_load returns them right away as pending and bgame_asset_check_bundle
+// finishes them on the main thread.
+void
+bgame_asset_begin_async_load(bgame_asset_bundle_t** bundle_ptr);
+
 bool
 bgame_asset_source_changed(bgame_asset_bundle_t* bundle, void* asset);
 
@@ -60,6 +100,28 @@ bgame_asset_unload(bgame_asset_bundle_t* bundle, void* asset);
 void
 bgame_asset_end_load(bgame_asset_bundle_t* bundle);
 
+// Unreferenced assets stay loaded until the measure of all of them exceeds
+// `budget` bytes, then the least recently used ones are unloaded.
+// Loading one of them again reuses it as long as its file did not change.
+// The default of 0 unloads assets as soon as they are unreferenced.
+void
+bgame_asset_set_cache_budget(bgame_asset_bundle_t* bundle, size_t budget);
+
+bgame_asset_status_t
+bgame_asset_status(bgame_asset_bundle_t* bundle, const void* asset);
+
+int
+bgame_asset_num_pending(bgame_asset_bundle_t* bundle);
+
+// Blocks until the pending assets of every bundle are finished since they
+// share the same workers
+void
+bgame_asset_wait(void);
+
+// The output of the type's `decode` when called from an async load, NULL otherwise
+void*
+bgame_asset_decoded(bgame_asset_bundle_t* bundle, void* asset);
+
 void*
 bgame_asset_malloc(bgame_asset_bundle_t* bundle, size_t size);
 
@@ -0,0 +1,67 @@
+#ifndef BGAME_ASSET_ARCHIVE_H
+#define BGAME_ASSET_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Many asset files packed into one so that they can be mapped at once instead
+// of being opened one by one.
+//
+// All integers are in the byte order of the machine that packed it, the magic
+// number does not match on the others.
+//
+// - Header:
+//   - u32: BGAME_ARCHIVE_MAGIC
+//   - u32: BGAME_ARCHIVE_VERSION
+//   - u32: Number of entries
+//   - u32: Reserved
+// - bgame_archive_entry_t for each file, sorted by path
+// - Paths, not null-terminated
+// - File contents, each starting at a multiple of BGAME_ARCHIVE_ALIGNMENT
+#define BGAME_ARCHIVE_MAGIC 0x4b504742  // "BGPK"
+#define BGAME_ARCHIVE_VERSION 1
+#define BGAME_ARCHIVE_HEADER_SIZE 16
+#define BGAME_ARCHIVE_ALIGNMENT 16
+
+struct CF_Image;
+
+typedef struct {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t path_offset;
+	uint32_t path_len;
+	// Set when the content is a decoded image in RGBA8, 0 otherwise
+	uint32_t width;
+	uint32_t height;
+} bgame_archive_entry_t;
+
+typedef struct {
+	const void* data;
+	size_t size;
+	int width;
+	int height;
+} bgame_archive_file_t;
+
+// Takes a path on the real file system.
+// Mounting again replaces the previous archive.
+bool
+bgame_archive_mount(const char* path);
+
+// Files found earlier must not be used after this, including by pending loads
+void
+bgame_archive_unmount(void);
+
+// Looks up a virtual path such as "/assets/icon.png".
+// `file` points into the mapping and stays valid until unmounted.
+// This can be called from any thread.
+bool
+bgame_archive_find(const char* path, bgame_archive_file_t* file);
+
+// Same as cf_image_load_png but from the archive.
+// Decoded images point straight into the mapping and set `*mapped` instead of
+// being copied, they must not be modified or given to cf_image_free.
+bool
+bgame_archive_load_image(const char* path, struct CF_Image* image, bool* mapped);
+
+#endif
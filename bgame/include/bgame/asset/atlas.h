@@ -0,0 +1,94 @@
+#ifndef BGAME_ASSET_ATLAS_H
+#define BGAME_ASSET_ATLAS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// PNG images baked by bgame-atlas into shared pages so that drawing them does
+// not switch textures.
+//
+// Once an atlas is given to bgame_use_atlas, bgame_load_sprite and
+// bgame_load_9patch resolve the PNG images in it to regions of its pages
+// instead of making a texture each.
+// 9-patches only do so when loaded with the borders they were baked with.
+//
+// All integers are in the byte order of the machine that baked it, the magic
+// number does not match on the others.
+//
+// - Header:
+//   - u32: BGAME_ATLAS_MAGIC
+//   - u32: BGAME_ATLAS_VERSION
+//   - u32: Number of pages
+//   - u32: Number of images
+// - bgame_atlas_page_t for each page
+// - bgame_atlas_image_t for each image, sorted by path
+// - Paths, not null-terminated
+#define BGAME_ATLAS_MAGIC 0x54414742  // "BGAT"
+#define BGAME_ATLAS_VERSION 1
+#define BGAME_ATLAS_HEADER_SIZE 16
+// An image and its 9-patch slices
+#define BGAME_ATLAS_IDS_PER_IMAGE 10
+#define BGAME_ATLAS_MAX_USED 8
+
+struct bgame_asset_bundle_s;
+struct CF_Sprite;
+
+typedef struct bgame_atlas_s bgame_atlas_t;
+
+typedef struct {
+	// Virtual path of the page image
+	uint32_t path_offset;
+	uint32_t path_len;
+	uint32_t width;
+	uint32_t height;
+} bgame_atlas_page_t;
+
+typedef enum {
+	BGAME_ATLAS_IMAGE_9PATCH = 1 << 0,
+} bgame_atlas_image_flag_t;
+
+typedef struct {
+	uint32_t path_offset;
+	uint32_t path_len;
+	uint32_t page;
+	uint32_t x, y;
+	uint32_t width, height;
+	uint32_t flags;
+	// Borders the 9-patch was sliced with
+	uint32_t left, right, top, bottom;
+} bgame_atlas_image_t;
+
+bgame_atlas_t*
+bgame_load_atlas(struct bgame_asset_bundle_s* bundle, const char* path);
+
+// Makes the sprite and 9-patch loaders look for their images in the atlas at
+// the virtual `path`, in the order the atlases were given.
+// They load it into their own bundle as a dependency, so it stays loaded while
+// they use it and a new bake reloads them.
+// PNG images found in none of them still depend on all of them.
+void
+bgame_use_atlas(const char* path);
+
+// For the sprite and 9-patch loaders
+
+bool
+bgame_atlas_find_sprite(
+	struct bgame_asset_bundle_s* bundle,
+	const char* path,
+	struct CF_Sprite* sprite
+);
+
+// Fills 9 `patches` ordered nw, n, ne, w, c, e, sw, s, se
+bool
+bgame_atlas_find_9patch(
+	struct bgame_asset_bundle_s* bundle,
+	const char* path,
+	int left, int right, int top, int bottom,
+	struct CF_Sprite* patches
+);
+
+// Atlas regions must not be given to cf_easy_sprite_unload
+bool
+bgame_atlas_is_region(const struct CF_Sprite* sprite);
+
+#endif
@@ -6,7 +6,9 @@
 #include <bgame/allocator/frame.h>
 #include <bgame/log.h>
 #include <bhash.h>
+#include <barray.h>
 #include <cute_file_system.h>
+#include <cute_multithreading.h>
 #include <cute_string.h>
 
 #if BGAME_RELOADABLE
@@ -25,16 +27,35 @@ typedef struct {
 	bgame_str_t path;
 } bgame_asset_key_t;
 
-typedef struct {
+typedef struct bgame_asset_job_s bgame_asset_job_t;
+
+typedef struct bgame_asset_s {
 	int ref_count;
 	bool dynamic;
 	bgame_asset_key_t key;
+	bgame_asset_status_t status;
 
 	int source_version;
 	int loaded_version;
 
+	// Assets loaded from within this asset's `load`, each holding a reference
+	barray(struct bgame_asset_s*) dependencies;
+
+	// Only set while waiting for a worker
+	bgame_asset_job_t* job;
+	// Only set while the type's `load` is given the output of `decode`
+	void* decoded;
+
+	// Set while unreferenced and kept in the bundle's cache
+	bool cached;
+	size_t cost;
+	struct bgame_asset_s* lru_prev;
+	struct bgame_asset_s* lru_next;
+
 #if BGAME_RELOADABLE
 	bresmon_watch_t* watch;
+	// For bgame_asset_reload_changed
+	int visit_mark;
 #endif
 
 	_Alignas(BGAME_MAX_ALIGN_TYPE) char data[];
@@ -42,6 +63,31 @@ typedef struct {
 
 typedef BHASH_TABLE(bgame_asset_key_t, bgame_asset_t*) bgame_asset_cache_t;
 
+// Workers only touch `decoded` and `next`, everything else belongs to the main
+// thread
+struct bgame_asset_job_s {
+	bgame_asset_job_t* next;
+	bgame_asset_bundle_t* bundle;
+	bgame_asset_type_t* type;
+	// NULL when the asset is destroyed before the job finishes
+	bgame_asset_t* asset;
+	bgame_asset_decode_fn_t decode;
+	int source_version;
+	void* decoded;
+	bgame_str_t path;
+	bool has_args;
+	_Alignas(BGAME_MAX_ALIGN_TYPE) char args[];
+};
+
+// Shared by all bundles so that destroying a bundle does not have to wait for
+// its jobs
+BGAME_VAR(CF_Threadpool*, bgame_asset_pool) = NULL;
+BGAME_VAR(CF_Mutex, bgame_asset_finished_jobs_mutex) = { 0 };
+BGAME_VAR(bgame_asset_job_t*, bgame_asset_finished_jobs) = NULL;
+// Jobs which are queued or still decoding, guarded by the mutex above
+BGAME_VAR(int, bgame_asset_num_running_jobs) = 0;
+BGAME_VAR(CF_ConditionVariable, bgame_asset_jobs_done) = { 0 };
+
 #if BGAME_RELOADABLE
 
 static bool bgame_asset_initialized = false;
@@ -60,8 +106,19 @@ AUTOLIST_DECLARE(bgame_asset_type_list)
 struct bgame_asset_bundle_s {
 	bgame_asset_cache_t assets;
 	bool loading;
+	bool async;
+	int num_pending;
+	// The asset whose `load` is running, it depends on everything loaded
+	bgame_asset_t* loading_asset;
+
+	size_t cache_budget;
+	size_t cache_size;
+	// Least recently used first
+	bgame_asset_t* lru_first;
+	bgame_asset_t* lru_last;
 #if BGAME_RELOADABLE
 	int code_version;
+	int visit_mark;
 	bresmon_t* monitor;
 #endif
 };
@@ -209,13 +266,30 @@ bgame_asset_begin_load(bgame_asset_bundle_t** bundle_ptr) {
 		// If an asset is loaded within bgame_asset_begin_load and
 		// bgame_asset_end_load, it is eligible for purging when not mentioned
 		// again
-		// TODO: this may not be correct without tracking asset dependency
 		if (!asset->dynamic) {
 			asset->ref_count = 0;
 		}
 	}
 
+	// Unless another asset still depends on it
+	for (bhash_index_t i = 0; i < num_assets; ++i) {
+		bgame_asset_t* asset = bundle->assets.values[i];
+		for (size_t j = 0; j < barray_len(asset->dependencies); ++j) {
+			bgame_asset_t* dependency = asset->dependencies[j];
+			if (!dependency->dynamic) {
+				dependency->ref_count += 1;
+			}
+		}
+	}
+
 	bundle->loading = true;
+	bundle->async = false;
+}
+
+void
+bgame_asset_begin_async_load(bgame_asset_bundle_t** bundle_ptr) {
+	bgame_asset_begin_load(bundle_ptr);
+	(*bundle_ptr)->async = true;
 }
 
 static inline bgame_asset_type_t*
@@ -232,22 +306,323 @@ bgame_asset_translate_type(bgame_asset_type_t* type) {
 #endif
 }
 
+static void
+bgame_asset_uncache(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	if (asset->lru_prev != NULL) {
+		asset->lru_prev->lru_next = asset->lru_next;
+	} else {
+		bundle->lru_first = asset->lru_next;
+	}
+	if (asset->lru_next != NULL) {
+		asset->lru_next->lru_prev = asset->lru_prev;
+	} else {
+		bundle->lru_last = asset->lru_prev;
+	}
+
+	asset->lru_prev = NULL;
+	asset->lru_next = NULL;
+	asset->cached = false;
+	bundle->cache_size -= asset->cost;
+}
+
+// Returns false when the asset should be unloaded instead
+static bool
+bgame_asset_cache(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	// Only keep what can be reused as is
+	if (
+		bundle->cache_budget == 0
+		|| asset->status != BGAME_ASSET_READY
+		|| asset->job != NULL
+	) {
+		return false;
+	}
+
+	bgame_asset_type_t* type = asset->key.type;
+	size_t cost = type->measure != NULL ? type->measure(bundle, asset->data) : type->size;
+	if (cost > bundle->cache_budget) { return false; }
+
+	log_info("Caching %s: %s (%zu bytes)", type->name, asset->key.path.chars, cost);
+
+	asset->cached = true;
+	asset->cost = cost;
+	asset->lru_prev = bundle->lru_last;
+	asset->lru_next = NULL;
+	if (bundle->lru_last != NULL) {
+		bundle->lru_last->lru_next = asset;
+	} else {
+		bundle->lru_first = asset;
+	}
+	bundle->lru_last = asset;
+	bundle->cache_size += cost;
+
+	return true;
+}
+
 static inline void
-bgame_asset_destroy(bgame_asset_t* asset) {
+bgame_asset_destroy(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	if (asset->cached) {
+		bgame_asset_uncache(bundle, asset);
+	}
+
+	if (asset->job != NULL) {
+		// Let bgame_asset_finish_jobs discard the result
+		asset->job->asset = NULL;
+		--bundle->num_pending;
+	}
+
 #if BGAME_RELOADABLE
 	bresmon_unwatch(asset->watch);
 #endif
 
+	barray_free(asset->dependencies, bgame_asset);
 	bgame_asset_strfree(asset->key.path);
 	bgame_free(asset, bgame_asset);
 }
 
+static void
+bgame_asset_release(bgame_asset_bundle_t* bundle, bgame_asset_t* asset);
+
+static void
+bgame_asset_release_dependencies(
+	bgame_asset_bundle_t* bundle,
+	barray(bgame_asset_t*) dependencies
+) {
+	for (size_t i = 0; i < barray_len(dependencies); ++i) {
+		bgame_asset_release(bundle, dependencies[i]);
+	}
+}
+
+// Must not be called while iterating over the bundle unless loading
+static void
+bgame_asset_evict(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	asset->key.type->unload(bundle, asset->data);
+	bhash_remove(&bundle->assets, asset->key);
+	bgame_asset_release_dependencies(bundle, asset->dependencies);
+	bgame_asset_destroy(bundle, asset);
+}
+
+// Returns whether anything was evicted
+static bool
+bgame_asset_trim_cache(bgame_asset_bundle_t* bundle) {
+	bool evicted = false;
+	while (bundle->cache_size > bundle->cache_budget) {
+		bgame_asset_t* asset = bundle->lru_first;
+		log_info(
+			"Evicting %s: %s (%p)",
+			asset->key.type->name,
+			asset->key.path.chars,
+			(void*)asset->data
+		);
+
+		// Its dependencies may be cached in turn
+		bgame_asset_uncache(bundle, asset);
+		bgame_asset_evict(bundle, asset);
+		evicted = true;
+	}
+
+	return evicted;
+}
+
+static void
+bgame_asset_release(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	--asset->ref_count;
+	// While loading, bgame_asset_purge takes care of it
+	if (!bundle->loading && asset->ref_count <= 0) {
+		if (bgame_asset_cache(bundle, asset)) {
+			bgame_asset_trim_cache(bundle);
+		} else {
+			log_info("Unloading %s: %s", asset->key.type->name, asset->key.path.chars);
+			bgame_asset_evict(bundle, asset);
+		}
+	}
+}
+
+static void
+bgame_asset_acquire(bgame_asset_bundle_t* bundle, bgame_asset_t* asset) {
+	if (asset->cached) {
+		bgame_asset_uncache(bundle, asset);
+	}
+	asset->ref_count += 1;
+
+	if (bundle->loading_asset != NULL) {
+		barray_push(bundle->loading_asset->dependencies, asset, bgame_asset);
+	}
+}
+
+// Calls the type's `load` with `asset` as the parent of everything it loads
+static bgame_asset_load_result_t
+bgame_asset_run_load(
+	bgame_asset_bundle_t* bundle,
+	bgame_asset_t* asset,
+	const char* path,
+	const void* args
+) {
+	barray(bgame_asset_t*) old_dependencies = asset->dependencies;
+	asset->dependencies = NULL;
+
+	bgame_asset_t* parent = bundle->loading_asset;
+	bundle->loading_asset = asset;
+	bgame_asset_load_result_t result = asset->key.type->load(bundle, asset->data, path, args);
+	bundle->loading_asset = parent;
+
+	// An asset that did not load again still uses its old dependencies
+	bool keep_old_dependencies = result == BGAME_ASSET_ERROR
+		|| (result == BGAME_ASSET_UNCHANGED && barray_len(asset->dependencies) == 0);
+	if (keep_old_dependencies) {
+		barray(bgame_asset_t*) new_dependencies = asset->dependencies;
+		asset->dependencies = old_dependencies;
+		old_dependencies = new_dependencies;
+	}
+
+	// Shared dependencies were acquired again so they never reach 0 here
+	bgame_asset_release_dependencies(bundle, old_dependencies);
+	barray_free(old_dependencies, bgame_asset);
+
+	return result;
+}
+
 bool
 bgame_asset_source_changed(bgame_asset_bundle_t* bundle, void* asset_data) {
 	bgame_asset_t* asset = (void*)((char*)asset_data - offsetof(bgame_asset_t, data));
 	return asset->loaded_version != asset->source_version;
 }
 
+static void
+bgame_asset_decode_task(void* userdata) {
+	bgame_asset_job_t* job = userdata;
+	job->decoded = job->decode(job->bundle, job->path.chars, job->has_args ? job->args : NULL);
+
+	cf_mutex_lock(&bgame_asset_finished_jobs_mutex);
+	job->next = bgame_asset_finished_jobs;
+	bgame_asset_finished_jobs = job;
+	if (--bgame_asset_num_running_jobs == 0) {
+		cf_cv_wake_all(&bgame_asset_jobs_done);
+	}
+	cf_mutex_unlock(&bgame_asset_finished_jobs_mutex);
+}
+
+static void
+bgame_asset_submit_job(
+	bgame_asset_bundle_t* bundle,
+	bgame_asset_t* asset,
+	const void* args
+) {
+	if (bgame_asset_pool == NULL) {
+		// Leave one core for the main thread
+		int num_threads = cf_core_count() - 1;
+		bgame_asset_pool = cf_make_threadpool(num_threads > 0 ? num_threads : 1);
+		bgame_asset_finished_jobs_mutex = cf_make_mutex();
+		bgame_asset_jobs_done = cf_make_cv();
+	}
+
+	bgame_asset_type_t* type = asset->key.type;
+	bgame_asset_job_t* job = bgame_malloc(sizeof(bgame_asset_job_t) + type->args_size, bgame_asset);
+	*job = (bgame_asset_job_t){
+		.bundle = bundle,
+		.type = type,
+		.asset = asset,
+		.decode = type->decode,
+		.source_version = asset->source_version,
+		.path = bgame_asset_strcpy(asset->key.path.chars),
+		.has_args = args != NULL,
+	};
+	if (args != NULL) {
+		memcpy(job->args, args, type->args_size);
+	}
+
+	asset->job = job;
+	// A reloading asset stays usable
+	if (asset->status != BGAME_ASSET_READY) {
+		asset->status = BGAME_ASSET_PENDING;
+	}
+	++bundle->num_pending;
+
+	cf_mutex_lock(&bgame_asset_finished_jobs_mutex);
+	++bgame_asset_num_running_jobs;
+	cf_mutex_unlock(&bgame_asset_finished_jobs_mutex);
+
+	cf_threadpool_add_task(bgame_asset_pool, bgame_asset_decode_task, job);
+	cf_threadpool_kick(bgame_asset_pool);
+}
+
+static void
+bgame_asset_finish_job(bgame_asset_job_t* job) {
+	bgame_asset_type_t* type = job->type;
+	bgame_asset_bundle_t* bundle = job->bundle;
+	bgame_asset_t* asset = job->asset;
+	if (asset == NULL) {
+		if (job->decoded != NULL) {
+			type->free_decoded(bundle, job->decoded);
+		}
+		return;
+	}
+
+	asset->job = NULL;
+	--bundle->num_pending;
+
+	if (job->decoded == NULL) {
+		log_error("Could not load %s: %s", type->name, job->path.chars);
+		if (asset->status == BGAME_ASSET_PENDING) {
+			asset->status = BGAME_ASSET_FAILED;
+		}
+		return;
+	}
+
+	asset->decoded = job->decoded;
+	bgame_asset_load_result_t result = bgame_asset_run_load(
+		bundle,
+		asset,
+		job->path.chars,
+		job->has_args ? job->args : NULL
+	);
+	asset->decoded = NULL;
+	type->free_decoded(bundle, job->decoded);
+
+	if (result == BGAME_ASSET_ERROR) {
+		// The version stays behind so that the next load tries again
+		log_error("Could not load %s: %s", type->name, job->path.chars);
+		if (asset->status == BGAME_ASSET_PENDING) {
+			asset->status = BGAME_ASSET_FAILED;
+		}
+	} else {
+		log_info("Loaded %s: %s (%p)", type->name, job->path.chars, (void*)asset->data);
+		asset->status = BGAME_ASSET_READY;
+		asset->loaded_version = job->source_version;
+	}
+
+	// The file changed again while it was being decoded
+	if (asset->source_version != job->source_version) {
+		bgame_asset_submit_job(bundle, asset, job->has_args ? job->args : NULL);
+	}
+}
+
+static void
+bgame_asset_finish_jobs(void) {
+	if (bgame_asset_pool == NULL) { return; }
+
+	cf_mutex_lock(&bgame_asset_finished_jobs_mutex);
+	bgame_asset_job_t* jobs = bgame_asset_finished_jobs;
+	bgame_asset_finished_jobs = NULL;
+	cf_mutex_unlock(&bgame_asset_finished_jobs_mutex);
+
+	// Finish in submission order
+	bgame_asset_job_t* ordered_jobs = NULL;
+	while (jobs != NULL) {
+		bgame_asset_job_t* next = jobs->next;
+		jobs->next = ordered_jobs;
+		ordered_jobs = jobs;
+		jobs = next;
+	}
+
+	while (ordered_jobs != NULL) {
+		bgame_asset_job_t* next = ordered_jobs->next;
+		bgame_asset_finish_job(ordered_jobs);
+		bgame_asset_strfree(ordered_jobs->path);
+		bgame_free(ordered_jobs, bgame_asset);
+		ordered_jobs = next;
+	}
+}
+
 static void*
 bgame_asset_load_impl(
 	bgame_asset_bundle_t* bundle,
@@ -298,34 +673,56 @@ bgame_asset_load_impl(
 		log_debug("Created new %s for %s: %p", type->name, path, (void*)asset);
 	} else {
 		asset = bundle->assets.values[asset_index];
+
+		// The finished job will load it
+		if (asset->job != NULL) {
+			bgame_asset_acquire(bundle, asset);
+			return asset->data;
+		}
 	}
 
-	bgame_asset_load_result_t result = type->load(bundle, asset->data, path, args);
+	if (
+		bundle->async
+		&& type->decode != NULL
+		&& bgame_asset_source_changed(bundle, asset->data)
+	) {
+		bgame_asset_submit_job(bundle, asset, args);
+		if (is_new_asset) {
+			bhash_put(&bundle->assets, asset->key, asset);
+		}
+		bgame_asset_acquire(bundle, asset);
+		return asset->data;
+	}
+
+	bgame_asset_load_result_t result = bgame_asset_run_load(bundle, asset, path, args);
 	switch (result) {
 		case BGAME_ASSET_LOADED:
 			log_info("Loaded %s: %s (%p)", type->name, path, (void*)asset->data);
 			if (is_new_asset) {
 				bhash_put(&bundle->assets, asset->key, asset);
 			}
+			asset->status = BGAME_ASSET_READY;
 			break;
 		case BGAME_ASSET_UNCHANGED:
+			// A failed asset stays failed
 			log_info("Reused cache for %s: %s (%p)", type->name, path, (void*)asset->data);
 			if (is_new_asset) {
 				bhash_put(&bundle->assets, asset->key, asset);
 				log_warn("New asset is unchanged");
+				asset->status = BGAME_ASSET_READY;
 			}
 			break;
 		case BGAME_ASSET_ERROR:
 			log_error("Could not load %s: %s", type->name, path);
 			if (is_new_asset) {
-				bgame_asset_destroy(asset);
+				bgame_asset_destroy(bundle, asset);
 			}
 			asset = NULL;
 			break;
 	}
 
 	if (asset != NULL) {
-		asset->ref_count += 1;
+		bgame_asset_acquire(bundle, asset);
 
 		// Delay version increment so other dependending assets can use
 		// bgame_asset_source_changed to check.
@@ -361,41 +758,99 @@ bgame_asset_unload(bgame_asset_bundle_t* bundle, void* asset_data) {
 	bgame_asset_init();
 
 	bgame_asset_t* asset = (void*)((char*)asset_data - offsetof(bgame_asset_t, data));
+	bgame_asset_release(bundle, asset);
+}
 
-	--asset->ref_count;
-	if (!bundle->loading && asset->ref_count <= 0) {
-		log_info("Unloading %s: %s", asset->key.type->name, asset->key.path.chars);
+// Must be called while `bundle->loading` is set so that releasing dependencies
+// does not remove entries during the iteration
+static void
+bgame_asset_purge(bgame_asset_bundle_t* bundle) {
+	// Purging an asset can leave its dependencies unreferenced
+	bool purged;
+	do {
+		purged = false;
+
+		for (bhash_index_t i = 0; i < bhash_len(&bundle->assets);) {
+			bgame_asset_key_t asset_key = bundle->assets.keys[i];
+			bgame_asset_t* asset = bundle->assets.values[i];
 
-		asset->key.type->unload(bundle, asset->data);
-		bhash_remove(&bundle->assets, asset->key);
-		bgame_asset_destroy(asset);
-	}
+			if (asset->ref_count == 0 && !asset->cached && !bgame_asset_cache(bundle, asset)) {
+				log_info(
+					"Purging %s: %s (%p)",
+					asset_key.type->name,
+					bundle->assets.keys[i].path.chars,
+					(void*)asset->data
+				);
+
+				bgame_asset_evict(bundle, asset);
+				purged = true;
+			} else {
+				++i;
+			}
+		}
+
+		// Outside of the iteration since it removes any entry
+		purged |= bgame_asset_trim_cache(bundle);
+	} while (purged);
 }
 
 void
 bgame_asset_end_load(bgame_asset_bundle_t* bundle) {
-	bundle->loading = false;
+	bgame_asset_purge(bundle);
 
-	for (bhash_index_t i = 0; i < bhash_len(&bundle->assets);) {
-		bgame_asset_key_t asset_key = bundle->assets.keys[i];
+	bhash_index_t num_assets = bhash_len(&bundle->assets);
+	for (bhash_index_t i = 0; i < num_assets; ++i) {
 		bgame_asset_t* asset = bundle->assets.values[i];
-
-		if (asset->ref_count == 0) {
-			log_info(
-				"Purging %s: %s (%p)",
-				asset_key.type->name,
-				bundle->assets.keys[i].path.chars,
-				(void*)asset->data
-			);
-
-			asset->key.type->unload(bundle, asset->data);
-			bhash_remove(&bundle->assets, asset_key);
-			bgame_asset_destroy(asset);
-		} else {
+		// Pending and cached assets still need to see the change and failed
+		// ones need to try again
+		if (asset->job == NULL && !asset->cached && asset->status != BGAME_ASSET_FAILED) {
 			asset->loaded_version = asset->source_version;
-			++i;
 		}
 	}
+
+	bundle->loading = false;
+	bundle->async = false;
+}
+
+void
+bgame_asset_set_cache_budget(bgame_asset_bundle_t* bundle, size_t budget) {
+	bundle->cache_budget = budget;
+	// While loading, the dependencies of evicted assets are left to
+	// bgame_asset_end_load
+	bgame_asset_trim_cache(bundle);
+}
+
+bgame_asset_status_t
+bgame_asset_status(bgame_asset_bundle_t* bundle, const void* asset_data) {
+	const bgame_asset_t* asset = (const void*)((const char*)asset_data - offsetof(bgame_asset_t, data));
+	return asset->status;
+}
+
+int
+bgame_asset_num_pending(bgame_asset_bundle_t* bundle) {
+	return bundle->num_pending;
+}
+
+void
+bgame_asset_wait(void) {
+	if (bgame_asset_pool == NULL) { return; }
+
+	cf_threadpool_kick_and_wait(bgame_asset_pool);
+	// That only empties the queue, workers may still be decoding what they
+	// took from it
+	cf_mutex_lock(&bgame_asset_finished_jobs_mutex);
+	while (bgame_asset_num_running_jobs > 0) {
+		cf_cv_wait(&bgame_asset_jobs_done, &bgame_asset_finished_jobs_mutex);
+	}
+	cf_mutex_unlock(&bgame_asset_finished_jobs_mutex);
+
+	bgame_asset_finish_jobs();
+}
+
+void*
+bgame_asset_decoded(bgame_asset_bundle_t* bundle, void* asset_data) {
+	bgame_asset_t* asset = (void*)((char*)asset_data - offsetof(bgame_asset_t, data));
+	return asset->decoded;
 }
 
 void*
@@ -408,8 +863,79 @@ bgame_asset_free(bgame_asset_bundle_t* bundle, void* ptr) {
 	bgame_free(ptr, bgame_asset);
 }
 
+#if BGAME_RELOADABLE
+
+// Appends `asset` after its dependencies if it or any of them changed
+static void
+bgame_asset_sort_changed(
+	bgame_asset_bundle_t* bundle,
+	bgame_asset_t* asset,
+	barray(bgame_asset_t*)* changed_assets
+) {
+	if (asset->visit_mark == bundle->visit_mark) { return; }
+	asset->visit_mark = bundle->visit_mark;
+
+	bool dependency_changed = false;
+	for (size_t i = 0; i < barray_len(asset->dependencies); ++i) {
+		bgame_asset_t* dependency = asset->dependencies[i];
+		bgame_asset_sort_changed(bundle, dependency, changed_assets);
+		dependency_changed |= bgame_asset_source_changed(bundle, dependency->data);
+	}
+
+	if (dependency_changed && !bgame_asset_source_changed(bundle, asset->data)) {
+		// Make the type's `load` see it as changed too
+		++asset->source_version;
+	}
+
+	if (bgame_asset_source_changed(bundle, asset->data)) {
+		barray_push(*changed_assets, asset, bgame_asset);
+	}
+}
+
+static void
+bgame_asset_reload_changed(bgame_asset_bundle_t* bundle) {
+	barray(bgame_asset_t*) changed_assets = NULL;
+	++bundle->visit_mark;
+	bhash_index_t num_assets = bhash_len(&bundle->assets);
+	for (bhash_index_t i = 0; i < num_assets; ++i) {
+		bgame_asset_sort_changed(bundle, bundle->assets.values[i], &changed_assets);
+	}
+
+	// Dependencies come first so their dependents load the new version
+	bundle->loading = true;
+	for (size_t i = 0; i < barray_len(changed_assets); ++i) {
+		bgame_asset_t* asset = changed_assets[i];
+		// The job submits itself again once it sees the change and cached
+		// assets are loaded again once they are used
+		if (asset->job != NULL || asset->cached) { continue; }
+
+		const char* path = asset->key.path.chars;
+		bgame_asset_type_t* type = asset->key.type;
+		bgame_asset_load_result_t result = bgame_asset_run_load(bundle, asset, path, NULL);
+		if (result == BGAME_ASSET_ERROR) {
+			log_error("Could not reload %s: %s", type->name, path);
+			// Ready assets keep their old data, failed ones try again on
+			// their next load
+			if (asset->status == BGAME_ASSET_FAILED) { continue; }
+		} else {
+			log_info("Reloaded %s: %s (%p)", type->name, path, (void*)asset->data);
+			if (result == BGAME_ASSET_LOADED) {
+				asset->status = BGAME_ASSET_READY;
+			}
+		}
+		asset->loaded_version = asset->source_version;
+	}
+	bgame_asset_end_load(bundle);
+
+	barray_free(changed_assets, bgame_asset);
+}
+
+#endif
+
 void
 bgame_asset_check_bundle(bgame_asset_bundle_t* bundle) {
+	bgame_asset_finish_jobs();
+
 #if BGAME_RELOADABLE
 	bgame_asset_init();
 
@@ -424,19 +950,7 @@ bgame_asset_check_bundle(bgame_asset_bundle_t* bundle) {
 	}
 
 	if (bresmon_check(bundle->monitor, false) > 0) {
-		bgame_asset_begin_load(&bundle);
-
-		// Do this for all assets since we are not tracking asset dependency
-		bhash_index_t num_assets = bhash_len(&bundle->assets);
-		for (bhash_index_t i = 0; i < num_assets; ++i) {
-			bgame_asset_t* asset = bundle->assets.values[i];
-			bgame_asset_load_impl(bundle, asset->key.type, asset->key.path.chars, NULL);
-			if (asset->ref_count == 0) {
-				asset->ref_count = 1;  // Prevent purging due to failure
-			}
-		}
-
-		bgame_asset_end_load(bundle);
+		bgame_asset_reload_changed(bundle);
 	}
 #endif
 }
@@ -447,7 +961,7 @@ bgame_asset_destroy_bundle(bgame_asset_bundle_t* bundle) {
 	for (bhash_index_t i = 0; i < num_assets; ++i) {
 		bgame_asset_t* asset = bundle->assets.values[i];
 		asset->key.type->unload(bundle, asset->data);
-		bgame_asset_destroy(asset);
+		bgame_asset_destroy(bundle, asset);
 	}
 
 	bhash_cleanup(&bundle->assets);
@@ -1,5 +1,7 @@
 #include <bgame/asset/9patch.h>
 #include <bgame/asset.h>
+#include <bgame/asset/archive.h>
+#include <bgame/asset/atlas.h>
 #include <bgame/log.h>
 #include <cute_image.h>
 #include <cute_sprite.h>
@@ -8,6 +10,8 @@ struct bgame_9patch_s {
 	bgame_9patch_config_t config;
 	int center_width;
 	int center_height;
+	// The patches are regions of an atlas page
+	bool from_atlas;
 
 	// Sprite for each patch named after the direction + (c)enter
 	struct CF_Sprite nw, n, ne;
@@ -15,6 +19,12 @@ struct bgame_9patch_s {
 	struct CF_Sprite sw, s, se;
 };
 
+typedef struct {
+	CF_Image image;
+	// Points into the mounted archive
+	bool mapped;
+} bgame_9patch_decoded_t;
+
 static inline void
 bgame_9patch_init_patch(
 	CF_Sprite* sprite,
@@ -45,18 +55,21 @@ bgame_9patch_unload(
 	void* asset
 ) {
 	bgame_9patch_t* nine_patch = asset;
-	if (nine_patch->nw.name != NULL) {
-		cf_easy_sprite_unload(&nine_patch->nw);
-		cf_easy_sprite_unload(&nine_patch->n);
-		cf_easy_sprite_unload(&nine_patch->ne);
-
-		cf_easy_sprite_unload(&nine_patch->w);
-		cf_easy_sprite_unload(&nine_patch->c);
-		cf_easy_sprite_unload(&nine_patch->e);
-
-		cf_easy_sprite_unload(&nine_patch->sw);
-		cf_easy_sprite_unload(&nine_patch->s);
-		cf_easy_sprite_unload(&nine_patch->se);
+	if (nine_patch->nw.name != NULL || nine_patch->from_atlas) {
+		// Atlas regions have no texture of their own
+		if (!nine_patch->from_atlas) {
+			cf_easy_sprite_unload(&nine_patch->nw);
+			cf_easy_sprite_unload(&nine_patch->n);
+			cf_easy_sprite_unload(&nine_patch->ne);
+
+			cf_easy_sprite_unload(&nine_patch->w);
+			cf_easy_sprite_unload(&nine_patch->c);
+			cf_easy_sprite_unload(&nine_patch->e);
+
+			cf_easy_sprite_unload(&nine_patch->sw);
+			cf_easy_sprite_unload(&nine_patch->s);
+			cf_easy_sprite_unload(&nine_patch->se);
+		}
 
 		nine_patch->nw = cf_sprite_defaults();
 		nine_patch->n  = cf_sprite_defaults();
@@ -69,6 +82,8 @@ bgame_9patch_unload(
 		nine_patch->sw = cf_sprite_defaults();
 		nine_patch->s  = cf_sprite_defaults();
 		nine_patch->se = cf_sprite_defaults();
+
+		nine_patch->from_atlas = false;
 	}
 }
 
@@ -96,11 +111,48 @@ bgame_9patch_load(
 		return BGAME_ASSET_UNCHANGED;
 	}
 
+	// Baked 9-patches are drawn from their atlas page without any copy
+	CF_Sprite regions[9];
+	if (bgame_atlas_find_9patch(bundle, path, config.left, config.right, config.top, config.bottom, regions)) {
+		bgame_9patch_unload(bundle, nine_patch);
+
+		CF_Sprite* patches[9] = {
+			&nine_patch->nw, &nine_patch->n, &nine_patch->ne,
+			&nine_patch->w , &nine_patch->c, &nine_patch->e ,
+			&nine_patch->sw, &nine_patch->s, &nine_patch->se,
+		};
+		for (int i = 0; i < 9; ++i) {
+			CF_Sprite patch = regions[i];
+			patch.offset.x = patch.w * 0.5;
+			patch.offset.y = -patch.h * 0.5;
+			*patches[i] = patch;
+		}
+
+		nine_patch->config = config;
+		nine_patch->center_width = regions[4].w;
+		nine_patch->center_height = regions[4].h;
+		nine_patch->from_atlas = true;
+		return BGAME_ASSET_LOADED;
+	} else if (nine_patch->from_atlas) {
+		bgame_9patch_unload(bundle, nine_patch);
+	}
+
 	CF_Image src;
-	CF_Result result = cf_image_load_png(path, &src);
-	if (result.code != CF_RESULT_SUCCESS) {
-		log_error("Could not load image: %s", path);
-		return BGAME_ASSET_ERROR;
+	bool free_src = false;
+	bool mapped;
+	bgame_9patch_decoded_t* decoded = bgame_asset_decoded(bundle, nine_patch);
+	if (decoded != NULL) {
+		src = decoded->image;
+	} else if (bgame_archive_load_image(path, &src, &mapped)) {
+		// Patches are copied straight out of the mapping
+		free_src = !mapped;
+	} else {
+		CF_Result result = cf_image_load_png(path, &src);
+		if (result.code != CF_RESULT_SUCCESS) {
+			log_error("Could not load image: %s", path);
+			return BGAME_ASSET_ERROR;
+		}
+		free_src = true;
 	}
 
 	bool identical_config = true
@@ -144,16 +196,59 @@ bgame_9patch_load(
 	nine_patch->center_height = p_c_h;
 
 	bgame_asset_free(bundle, img_buf);
-	cf_image_free(&src);
+	if (free_src) {
+		cf_image_free(&src);
+	}
 
 	return BGAME_ASSET_LOADED;
 }
 
+static void*
+bgame_9patch_decode(
+	bgame_asset_bundle_t* bundle,
+	const char* path,
+	const void* args
+) {
+	bgame_9patch_decoded_t result = { 0 };
+	if (!bgame_archive_load_image(path, &result.image, &result.mapped)) {
+		result.mapped = false;
+		if (cf_image_load_png(path, &result.image).code != CF_RESULT_SUCCESS) { return NULL; }
+	}
+
+	bgame_9patch_decoded_t* decoded = bgame_asset_malloc(bundle, sizeof(bgame_9patch_decoded_t));
+	*decoded = result;
+	return decoded;
+}
+
+static void
+bgame_9patch_free_decoded(bgame_asset_bundle_t* bundle, void* ptr) {
+	bgame_9patch_decoded_t* decoded = ptr;
+	if (!decoded->mapped) {
+		cf_image_free(&decoded->image);
+	}
+	bgame_asset_free(bundle, decoded);
+}
+
+static size_t
+bgame_9patch_measure(bgame_asset_bundle_t* bundle, const void* asset) {
+	const bgame_9patch_t* nine_patch = asset;
+	if (nine_patch->from_atlas) { return sizeof(bgame_9patch_t); }
+
+	const bgame_9patch_config_t* config = &nine_patch->config;
+	size_t width = (size_t)(config->left + nine_patch->center_width + config->right);
+	size_t height = (size_t)(config->top + nine_patch->center_height + config->bottom);
+	return sizeof(bgame_9patch_t) + width * height * sizeof(CF_Pixel);
+}
+
 BGAME_ASSET_TYPE(nine_patch) = {
 	.name = "9patch",
 	.size = sizeof(bgame_9patch_t),
 	.load = bgame_9patch_load,
 	.unload = bgame_9patch_unload,
+	.args_size = sizeof(bgame_9patch_config_t),
+	.decode = bgame_9patch_decode,
+	.free_decoded = bgame_9patch_free_decoded,
+	.measure = bgame_9patch_measure,
 };
 
 bgame_9patch_t*
@@ -181,7 +276,7 @@ bgame_9patch_draw_patch(
 
 void
 bgame_draw_9patch(const bgame_9patch_t* nine_patch, CF_Aabb aabb) {
-	if (nine_patch->nw.name == NULL) { return; }
+	if (nine_patch->nw.name == NULL && !nine_patch->from_atlas) { return; }
 
 	float p_left   = (float)nine_patch->config.left;
 	float p_top    = (float)nine_patch->config.top;
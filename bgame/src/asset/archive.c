@@ -0,0 +1,197 @@
+#include <bgame/asset/archive.h>
+#include <bgame/reloadable.h>
+#include <bgame/allocator.h>
+#include <bgame/allocator/tracked.h>
+#include <bgame/log.h>
+#include <cute_image.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#	define BGAME_ARCHIVE_HAS_MMAP 0
+#else
+#	define BGAME_ARCHIVE_HAS_MMAP 1
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+BGAME_DECLARE_TRACKED_ALLOCATOR(bgame_archive)
+
+typedef struct {
+	const uint8_t* data;
+	size_t size;
+	uint32_t num_entries;
+	const bgame_archive_entry_t* entries;
+} bgame_archive_t;
+
+// The mapping outlives code reloads
+BGAME_VAR(bgame_archive_t, bgame_archive_mounted) = { 0 };
+
+static inline uint32_t
+bgame_archive_read_u32(const uint8_t* data) {
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static bool
+bgame_archive_validate(const uint8_t* data, size_t size) {
+	if (size < BGAME_ARCHIVE_HEADER_SIZE) { return false; }
+	if (
+		bgame_archive_read_u32(data) != BGAME_ARCHIVE_MAGIC
+		|| bgame_archive_read_u32(data + 4) != BGAME_ARCHIVE_VERSION
+	) {
+		return false;
+	}
+
+	uint32_t num_entries = bgame_archive_read_u32(data + 8);
+	if (num_entries > (size - BGAME_ARCHIVE_HEADER_SIZE) / sizeof(bgame_archive_entry_t)) {
+		return false;
+	}
+
+	// Check once so that lookups can trust the index
+	const bgame_archive_entry_t* entries = (const void*)(data + BGAME_ARCHIVE_HEADER_SIZE);
+	for (uint32_t i = 0; i < num_entries; ++i) {
+		const bgame_archive_entry_t* entry = &entries[i];
+		bool valid = (uint64_t)entry->path_offset + entry->path_len <= size
+			&& entry->offset <= size
+			&& entry->size <= size - entry->offset
+			&& entry->offset % BGAME_ARCHIVE_ALIGNMENT == 0
+			&& (entry->width == 0 || (uint64_t)entry->width * entry->height * sizeof(CF_Pixel) == entry->size);
+		if (!valid) { return false; }
+	}
+
+	return true;
+}
+
+static void
+bgame_archive_unmap(const uint8_t* data, size_t size) {
+#if BGAME_ARCHIVE_HAS_MMAP
+	munmap((void*)data, size);
+#else
+	bgame_free((void*)data, bgame_archive);
+#endif
+}
+
+bool
+bgame_archive_mount(const char* path) {
+	uint8_t* data = NULL;
+	size_t size = 0;
+
+#if BGAME_ARCHIVE_HAS_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+	size = (size_t)st.st_size;
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) { return false; }
+	data = mapping;
+#else
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return false; }
+	bool read_ok = fseek(file, 0, SEEK_END) == 0;
+	long file_size = read_ok ? ftell(file) : -1;
+	read_ok = file_size > 0 && fseek(file, 0, SEEK_SET) == 0;
+	if (read_ok) {
+		size = (size_t)file_size;
+		data = bgame_malloc(size, bgame_archive);
+		read_ok = fread(data, size, 1, file) == 1;
+	}
+	fclose(file);
+	if (!read_ok) {
+		bgame_free(data, bgame_archive);
+		return false;
+	}
+#endif
+
+	if (!bgame_archive_validate(data, size)) {
+		log_error("Invalid archive: %s", path);
+		bgame_archive_unmap(data, size);
+		return false;
+	}
+
+	bgame_archive_unmount();
+	bgame_archive_mounted = (bgame_archive_t){
+		.data = data,
+		.size = size,
+		.num_entries = bgame_archive_read_u32(data + 8),
+		.entries = (const void*)(data + BGAME_ARCHIVE_HEADER_SIZE),
+	};
+	log_info("Mounted archive %s with %u files", path, (unsigned)bgame_archive_mounted.num_entries);
+
+	return true;
+}
+
+void
+bgame_archive_unmount(void) {
+	if (bgame_archive_mounted.data == NULL) { return; }
+
+	bgame_archive_unmap(bgame_archive_mounted.data, bgame_archive_mounted.size);
+	bgame_archive_mounted = (bgame_archive_t){ 0 };
+}
+
+bool
+bgame_archive_find(const char* path, bgame_archive_file_t* file) {
+	const bgame_archive_t* archive = &bgame_archive_mounted;
+	size_t path_len = strlen(path);
+
+	// Entries are sorted by memcmp on the path with shorter paths first on a tie
+	uint32_t low = 0;
+	uint32_t high = archive->num_entries;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		const bgame_archive_entry_t* entry = &archive->entries[mid];
+		size_t min_len = entry->path_len < path_len ? entry->path_len : path_len;
+		int cmp = memcmp(archive->data + entry->path_offset, path, min_len);
+		if (cmp == 0) {
+			cmp = entry->path_len < path_len ? -1 : (entry->path_len > path_len ? 1 : 0);
+		}
+
+		if (cmp == 0) {
+			*file = (bgame_archive_file_t){
+				.data = archive->data + entry->offset,
+				.size = (size_t)entry->size,
+				.width = (int)entry->width,
+				.height = (int)entry->height,
+			};
+			return true;
+		} else if (cmp < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return false;
+}
+
+bool
+bgame_archive_load_image(const char* path, CF_Image* image, bool* mapped) {
+	bgame_archive_file_t file;
+	if (!bgame_archive_find(path, &file)) { return false; }
+
+	if (file.width > 0) {
+		*image = (CF_Image){
+			.w = file.width,
+			.h = file.height,
+			.pix = (CF_Pixel*)file.data,
+		};
+		*mapped = true;
+		return true;
+	} else {
+		CF_Result result = cf_image_load_png_from_memory(file.data, (int)file.size, image);
+		if (result.code != CF_RESULT_SUCCESS) {
+			log_error("Could not decode %s from archive: %s", path, result.details);
+			return false;
+		}
+		*mapped = false;
+		return true;
+	}
+}
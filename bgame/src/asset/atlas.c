@@ -0,0 +1,345 @@
+#include <bgame/asset/atlas.h>
+#include <bgame/asset.h>
+#include <bgame/reloadable.h>
+#include <bgame/allocator.h>
+#include <bgame/allocator/tracked.h>
+#include <bgame/log.h>
+#include <cute_alloc.h>
+#include <cute_draw.h>
+#include <cute_file_system.h>
+#include <cute_sprite.h>
+#include <string.h>
+
+// Far above the ids cute_framework hands out to easy sprites
+#define BGAME_ATLAS_FIRST_IMAGE_ID ((uint64_t)1 << 48)
+
+BGAME_DECLARE_TRACKED_ALLOCATOR(bgame_atlas)
+
+struct bgame_atlas_s {
+	void* data;
+	size_t size;
+	const bgame_atlas_image_t* images;
+	uint32_t num_images;
+	uint64_t first_image_id;
+};
+
+typedef struct {
+	int num_paths;
+	char* paths[BGAME_ATLAS_MAX_USED];
+} bgame_atlas_used_t;
+
+// Copied since the strings of the caller do not survive a reload
+BGAME_VAR(bgame_atlas_used_t, bgame_atlas_used) = { 0 };
+// Pages stay registered after unloading so ids are never reused
+BGAME_VAR(uint64_t, bgame_atlas_next_image_id) = BGAME_ATLAS_FIRST_IMAGE_ID;
+
+static inline uint32_t
+bgame_atlas_read_u32(const uint8_t* data) {
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static bool
+bgame_atlas_validate(const uint8_t* data, size_t size) {
+	if (size < BGAME_ATLAS_HEADER_SIZE) { return false; }
+	if (
+		bgame_atlas_read_u32(data) != BGAME_ATLAS_MAGIC
+		|| bgame_atlas_read_u32(data + 4) != BGAME_ATLAS_VERSION
+	) {
+		return false;
+	}
+
+	uint64_t num_pages = bgame_atlas_read_u32(data + 8);
+	uint64_t num_images = bgame_atlas_read_u32(data + 12);
+	uint64_t index_size = num_pages * sizeof(bgame_atlas_page_t) + num_images * sizeof(bgame_atlas_image_t);
+	if (index_size > size - BGAME_ATLAS_HEADER_SIZE) { return false; }
+
+	const bgame_atlas_page_t* pages = (const void*)(data + BGAME_ATLAS_HEADER_SIZE);
+	for (uint32_t i = 0; i < num_pages; ++i) {
+		const bgame_atlas_page_t* page = &pages[i];
+		bool valid = (uint64_t)page->path_offset + page->path_len <= size
+			&& page->path_len > 0
+			&& page->width > 0
+			&& page->height > 0;
+		if (!valid) { return false; }
+	}
+
+	const bgame_atlas_image_t* images = (const void*)(pages + num_pages);
+	for (uint32_t i = 0; i < num_images; ++i) {
+		const bgame_atlas_image_t* image = &images[i];
+		if (
+			(uint64_t)image->path_offset + image->path_len > size
+			|| image->page >= num_pages
+		) {
+			return false;
+		}
+
+		const bgame_atlas_page_t* page = &pages[image->page];
+		bool valid = image->width > 0
+			&& image->height > 0
+			&& (uint64_t)image->x + image->width <= page->width
+			&& (uint64_t)image->y + image->height <= page->height;
+		if (valid && (image->flags & BGAME_ATLAS_IMAGE_9PATCH)) {
+			valid = (uint64_t)image->left + image->right < image->width
+				&& (uint64_t)image->top + image->bottom < image->height;
+		}
+		if (!valid) { return false; }
+	}
+
+	return true;
+}
+
+static inline CF_AtlasSubImage
+bgame_atlas_sub_image(
+	const bgame_atlas_page_t* page,
+	uint64_t image_id,
+	uint32_t x, uint32_t y,
+	uint32_t w, uint32_t h
+) {
+	return (CF_AtlasSubImage){
+		.image_id = image_id,
+		.w = (int)w,
+		.h = (int)h,
+		.minx = (float)x / (float)page->width,
+		.miny = (float)y / (float)page->height,
+		.maxx = (float)(x + w) / (float)page->width,
+		.maxy = (float)(y + h) / (float)page->height,
+	};
+}
+
+static void
+bgame_atlas_register_page(
+	bgame_asset_bundle_t* bundle,
+	bgame_atlas_t* atlas,
+	const bgame_atlas_page_t* page,
+	uint32_t page_index
+) {
+	int num_sub_images = 0;
+	for (uint32_t i = 0; i < atlas->num_images; ++i) {
+		if (atlas->images[i].page == page_index) {
+			num_sub_images += (atlas->images[i].flags & BGAME_ATLAS_IMAGE_9PATCH) ? BGAME_ATLAS_IDS_PER_IMAGE : 1;
+		}
+	}
+	if (num_sub_images == 0) { return; }
+
+	CF_AtlasSubImage* sub_images = bgame_asset_malloc(bundle, sizeof(CF_AtlasSubImage) * num_sub_images);
+	int sub_image_index = 0;
+	for (uint32_t i = 0; i < atlas->num_images; ++i) {
+		const bgame_atlas_image_t* image = &atlas->images[i];
+		if (image->page != page_index) { continue; }
+
+		uint64_t id = atlas->first_image_id + (uint64_t)i * BGAME_ATLAS_IDS_PER_IMAGE;
+		sub_images[sub_image_index++] = bgame_atlas_sub_image(
+			page, id, image->x, image->y, image->width, image->height
+		);
+
+		if ((image->flags & BGAME_ATLAS_IMAGE_9PATCH) == 0) { continue; }
+
+		// Same layout as the pixel copies made by the 9-patch loader
+		uint32_t xs[3] = { image->x, image->x + image->left, image->x + image->width - image->right };
+		uint32_t ws[3] = { image->left, image->width - image->left - image->right, image->right };
+		uint32_t ys[3] = { image->y, image->y + image->top, image->y + image->height - image->bottom };
+		uint32_t hs[3] = { image->top, image->height - image->top - image->bottom, image->bottom };
+		for (int row = 0; row < 3; ++row) {
+			for (int col = 0; col < 3; ++col) {
+				sub_images[sub_image_index++] = bgame_atlas_sub_image(
+					page, id + 1 + row * 3 + col, xs[col], ys[row], ws[col], hs[row]
+				);
+			}
+		}
+	}
+
+	char* path = bgame_asset_malloc(bundle, page->path_len + 1);
+	memcpy(path, (const uint8_t*)atlas->data + page->path_offset, page->path_len);
+	path[page->path_len] = '\0';
+	cf_register_premade_atlas(path, num_sub_images, sub_images);
+	bgame_asset_free(bundle, path);
+	bgame_asset_free(bundle, sub_images);
+}
+
+static void
+bgame_atlas_unload(
+	bgame_asset_bundle_t* bundle,
+	void* asset
+) {
+	bgame_atlas_t* atlas = asset;
+	if (atlas->data == NULL) { return; }
+
+	cf_free(atlas->data);
+	*atlas = (bgame_atlas_t){ 0 };
+}
+
+static bgame_asset_load_result_t
+bgame_atlas_load(
+	bgame_asset_bundle_t* bundle,
+	void* asset,
+	const char* path,
+	const void* args
+) {
+	bgame_atlas_t* atlas = asset;
+	if (!bgame_asset_source_changed(bundle, atlas)) {
+		return BGAME_ASSET_UNCHANGED;
+	}
+
+	size_t size;
+	void* data = cf_fs_read_entire_file_to_memory(path, &size);
+	if (data == NULL) {
+		log_error("Could not read atlas: %s", path);
+		return BGAME_ASSET_ERROR;
+	}
+
+	if (!bgame_atlas_validate(data, size)) {
+		log_error("Invalid atlas: %s", path);
+		cf_free(data);
+		return BGAME_ASSET_ERROR;
+	}
+
+	bgame_atlas_unload(bundle, atlas);
+
+	uint32_t num_pages = bgame_atlas_read_u32((const uint8_t*)data + 8);
+	const bgame_atlas_page_t* pages = (const void*)((const uint8_t*)data + BGAME_ATLAS_HEADER_SIZE);
+	*atlas = (bgame_atlas_t){
+		.data = data,
+		.size = size,
+		.images = (const void*)(pages + num_pages),
+		.num_images = bgame_atlas_read_u32((const uint8_t*)data + 12),
+		.first_image_id = bgame_atlas_next_image_id,
+	};
+	bgame_atlas_next_image_id += (uint64_t)atlas->num_images * BGAME_ATLAS_IDS_PER_IMAGE;
+
+	for (uint32_t i = 0; i < num_pages; ++i) {
+		bgame_atlas_register_page(bundle, atlas, &pages[i], i);
+	}
+
+	return BGAME_ASSET_LOADED;
+}
+
+// Pages stay registered after unloading so only the index counts
+static size_t
+bgame_atlas_measure(bgame_asset_bundle_t* bundle, const void* asset) {
+	const bgame_atlas_t* atlas = asset;
+	return sizeof(bgame_atlas_t) + atlas->size;
+}
+
+BGAME_ASSET_TYPE(atlas) = {
+	.name = "atlas",
+	.size = sizeof(bgame_atlas_t),
+	.load = bgame_atlas_load,
+	.unload = bgame_atlas_unload,
+	.measure = bgame_atlas_measure,
+};
+
+bgame_atlas_t*
+bgame_load_atlas(struct bgame_asset_bundle_s* bundle, const char* path) {
+	return bgame_asset_load(bundle, &atlas, path, NULL);
+}
+
+void
+bgame_use_atlas(const char* path) {
+	for (int i = 0; i < bgame_atlas_used.num_paths; ++i) {
+		if (strcmp(bgame_atlas_used.paths[i], path) == 0) { return; }
+	}
+
+	if (bgame_atlas_used.num_paths >= BGAME_ATLAS_MAX_USED) {
+		log_error("Too many atlases, not using: %s", path);
+		return;
+	}
+
+	size_t path_len = strlen(path);
+	char* copy = bgame_malloc(path_len + 1, bgame_atlas);
+	memcpy(copy, path, path_len + 1);
+	bgame_atlas_used.paths[bgame_atlas_used.num_paths++] = copy;
+}
+
+static bool
+bgame_atlas_find_in(
+	const bgame_atlas_t* atlas,
+	const char* path,
+	const bgame_atlas_image_t** image_out,
+	uint64_t* id_out
+) {
+	size_t path_len = strlen(path);
+
+	// Images are sorted by memcmp on the path with shorter paths first on a tie
+	uint32_t low = 0;
+	uint32_t high = atlas->num_images;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		const bgame_atlas_image_t* image = &atlas->images[mid];
+		size_t min_len = image->path_len < path_len ? image->path_len : path_len;
+		int cmp = memcmp((const uint8_t*)atlas->data + image->path_offset, path, min_len);
+		if (cmp == 0) {
+			cmp = image->path_len < path_len ? -1 : (image->path_len > path_len ? 1 : 0);
+		}
+
+		if (cmp == 0) {
+			*image_out = image;
+			*id_out = atlas->first_image_id + (uint64_t)mid * BGAME_ATLAS_IDS_PER_IMAGE;
+			return true;
+		} else if (cmp < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return false;
+}
+
+// Every atlas it goes through becomes a dependency of the asset being loaded
+static bool
+bgame_atlas_find(
+	struct bgame_asset_bundle_s* bundle,
+	const char* path,
+	const bgame_atlas_image_t** image_out,
+	uint64_t* id_out
+) {
+	for (int i = 0; i < bgame_atlas_used.num_paths; ++i) {
+		const bgame_atlas_t* atlas = bgame_load_atlas(bundle, bgame_atlas_used.paths[i]);
+		if (atlas != NULL && bgame_atlas_find_in(atlas, path, image_out, id_out)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+bgame_atlas_find_sprite(struct bgame_asset_bundle_s* bundle, const char* path, CF_Sprite* sprite) {
+	const bgame_atlas_image_t* image;
+	uint64_t id;
+	if (!bgame_atlas_find(bundle, path, &image, &id)) { return false; }
+
+	*sprite = cf_make_premade_sprite(id);
+	return true;
+}
+
+bool
+bgame_atlas_find_9patch(
+	struct bgame_asset_bundle_s* bundle,
+	const char* path,
+	int left, int right, int top, int bottom,
+	CF_Sprite* patches
+) {
+	const bgame_atlas_image_t* image;
+	uint64_t id;
+	if (!bgame_atlas_find(bundle, path, &image, &id)) { return false; }
+
+	bool same_borders = (image->flags & BGAME_ATLAS_IMAGE_9PATCH)
+		&& image->left == (uint32_t)left
+		&& image->right == (uint32_t)right
+		&& image->top == (uint32_t)top
+		&& image->bottom == (uint32_t)bottom;
+	if (!same_borders) { return false; }
+
+	for (int i = 0; i < 9; ++i) {
+		patches[i] = cf_make_premade_sprite(id + 1 + i);
+	}
+	return true;
+}
+
+bool
+bgame_atlas_is_region(const CF_Sprite* sprite) {
+	return sprite->easy_sprite_id >= BGAME_ATLAS_FIRST_IMAGE_ID;
+}
@@ -1,10 +1,26 @@
 #include <bgame/log.h>
 #include <bgame/asset.h>
 #include <bgame/asset/sprite.h>
+#include <bgame/asset/archive.h>
+#include <bgame/asset/atlas.h>
+#include <cute_alloc.h>
+#include <cute_file_system.h>
 #include <cute_image.h>
 #include <cute_sprite.h>
 #include <string.h>
 
+typedef struct {
+	bool is_png;
+	CF_Image png;
+
+	// cute_aseprite decodes and uploads in one go so only reading is async
+	const void* aseprite;
+	size_t aseprite_size;
+
+	// Points into the mounted archive
+	bool mapped;
+} bgame_sprite_decoded_t;
+
 static inline bool
 has_extension(const char* filename, const char* extension) {
     const char* dot = strrchr(filename, '.');
@@ -15,6 +31,50 @@ has_extension(const char* filename, const char* extension) {
     return strcmp(dot + 1, extension) == 0;
 }
 
+static bool
+bgame_sprite_read_packed(const char* path, bgame_sprite_decoded_t* decoded) {
+	*decoded = (bgame_sprite_decoded_t){ 0 };
+	if (has_extension(path, "png")) {
+		decoded->is_png = true;
+		return bgame_archive_load_image(path, &decoded->png, &decoded->mapped);
+	}
+
+	bgame_archive_file_t file;
+	if (!bgame_archive_find(path, &file)) { return false; }
+
+	decoded->aseprite = file.data;
+	decoded->aseprite_size = file.size;
+	decoded->mapped = true;
+	return true;
+}
+
+static void
+bgame_sprite_cleanup_decoded(bgame_sprite_decoded_t* decoded) {
+	if (decoded->mapped) { return; }
+
+	if (decoded->is_png) {
+		cf_image_free(&decoded->png);
+	} else {
+		cf_free((void*)decoded->aseprite);
+	}
+}
+
+static void
+bgame_sprite_unload(
+	bgame_asset_bundle_t* bundle,
+	void* asset
+) {
+	CF_Sprite* sprite = asset;
+	// The page belongs to the atlas
+	if (bgame_atlas_is_region(sprite)) { return; }
+
+	if (sprite->easy_sprite_id > 0) {
+		cf_easy_sprite_unload(sprite);
+	} else if (sprite->name != NULL) {
+		cf_sprite_unload(sprite->name);
+	}
+}
+
 static bgame_asset_load_result_t
 bgame_sprite_load(
 	bgame_asset_bundle_t* bundle,
@@ -27,6 +87,38 @@ bgame_sprite_load(
 		return BGAME_ASSET_UNCHANGED;
 	}
 
+	// Baked images share the texture of their atlas page
+	CF_Sprite region;
+	if (has_extension(path, "png") && bgame_atlas_find_sprite(bundle, path, &region)) {
+		bgame_sprite_unload(bundle, sprite);
+		*sprite = region;
+		return BGAME_ASSET_LOADED;
+	} else if (bgame_atlas_is_region(sprite)) {
+		// The atlas is gone, load it on its own
+		*sprite = cf_sprite_defaults();
+	}
+
+	// Packed assets skip the file system and are uploaded from the mapping
+	bgame_sprite_decoded_t* decoded = bgame_asset_decoded(bundle, sprite);
+	bgame_sprite_decoded_t packed;
+	if (decoded == NULL && bgame_sprite_read_packed(path, &packed)) {
+		decoded = &packed;
+	}
+
+	if (decoded != NULL && decoded->is_png) {
+		if (sprite->easy_sprite_id == 0) {
+			*sprite = cf_make_easy_sprite_from_pixels(decoded->png.pix, decoded->png.w, decoded->png.h);
+		} else {
+			cf_easy_sprite_update_pixels(sprite, decoded->png.pix);
+		}
+		if (decoded == &packed) { bgame_sprite_cleanup_decoded(&packed); }
+		return BGAME_ASSET_LOADED;
+	} else if (decoded != NULL && sprite->name == NULL) {
+		*sprite = cf_make_sprite_from_memory(path, decoded->aseprite, (int)decoded->aseprite_size);
+		if (decoded == &packed) { bgame_sprite_cleanup_decoded(&packed); }
+		return BGAME_ASSET_LOADED;
+	}
+
 	if (has_extension(path, "png")) {
 		if (sprite->easy_sprite_id == 0) {
 			CF_Result result;
@@ -65,17 +157,48 @@ bgame_sprite_load(
 	}
 }
 
-static void
-bgame_sprite_unload(
+static void*
+bgame_sprite_decode(
 	bgame_asset_bundle_t* bundle,
-	void* asset
+	const char* path,
+	const void* args
 ) {
-	CF_Sprite* sprite = asset;
-	if (sprite->easy_sprite_id > 0) {
-		cf_easy_sprite_unload(sprite);
-	} else if (sprite->name != NULL) {
-		cf_sprite_unload(sprite->name);
+	bgame_sprite_decoded_t decoded;
+	if (!bgame_sprite_read_packed(path, &decoded)) {
+		decoded = (bgame_sprite_decoded_t){ 0 };
+
+		if (has_extension(path, "png")) {
+			CF_Result result = cf_image_load_png(path, &decoded.png);
+			if (result.code != CF_RESULT_SUCCESS) { return NULL; }
+			decoded.is_png = true;
+		} else if (has_extension(path, "ase") || has_extension(path, "aseprite")) {
+			decoded.aseprite = cf_fs_read_entire_file_to_memory(path, &decoded.aseprite_size);
+			if (decoded.aseprite == NULL) { return NULL; }
+		} else {
+			return NULL;
+		}
 	}
+
+	bgame_sprite_decoded_t* result = bgame_asset_malloc(bundle, sizeof(bgame_sprite_decoded_t));
+	*result = decoded;
+	return result;
+}
+
+static void
+bgame_sprite_free_decoded(bgame_asset_bundle_t* bundle, void* ptr) {
+	bgame_sprite_decoded_t* decoded = ptr;
+	bgame_sprite_cleanup_decoded(decoded);
+	bgame_asset_free(bundle, decoded);
+}
+
+static size_t
+bgame_sprite_measure(bgame_asset_bundle_t* bundle, const void* asset) {
+	const CF_Sprite* sprite = asset;
+	// The page belongs to the atlas
+	if (bgame_atlas_is_region(sprite)) { return sizeof(CF_Sprite); }
+
+	// Animations only count their first frame
+	return sizeof(CF_Sprite) + (size_t)sprite->w * (size_t)sprite->h * sizeof(CF_Pixel);
 }
 
 BGAME_ASSET_TYPE(sprite) = {
@@ -83,6 +206,9 @@ BGAME_ASSET_TYPE(sprite) = {
 	.size = sizeof(CF_Sprite),
 	.load = bgame_sprite_load,
 	.unload = bgame_sprite_unload,
+	.decode = bgame_sprite_decode,
+	.free_decoded = bgame_sprite_free_decoded,
+	.measure = bgame_sprite_measure,
 };
 
 CF_Sprite*
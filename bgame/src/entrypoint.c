@@ -1,6 +1,7 @@
 #include "internal.h"
 #include <bgame/reloadable.h>
 #include <bgame/log.h>
+#include <bgame/asset.h>
 #include "loader_interface.h"
 
 extern void
@@ -27,9 +28,12 @@ bgame_remodule(bgame_app_t app, remodule_op_t op, void* userdata) {
 			break;
 		case REMODULE_OP_UNLOAD:
 			log_info("Unloading app");
+			// Queued asset jobs call into the code being unloaded
+			bgame_asset_wait();
 			break;
 		case REMODULE_OP_BEFORE_RELOAD:
 			log_info("Reloading app");
+			bgame_asset_wait();
 			if (app.before_reload != NULL) {
 				app.before_reload();
 			}
@@ -0,0 +1,449 @@
+// Bakes PNG images into atlas pages for bgame_load_atlas.
+//
+// Usage: bgame-atlas [-s size] [-P padding] [-C dir] [-p prefix] [-a page_prefix]
+//   [-9 file:left,right,top,bottom]... -o output file...
+//
+// -s: Width and maximum height of a page (default: 1024)
+// -P: Transparent pixels between images (default: 1)
+// -C: Directory the files are relative to (default: .)
+// -p: Prefix of the virtual paths of the images (default: /)
+// -a: Prefix of the virtual paths of the pages (default: same as -p)
+// -9: Also slice a file as a 9-patch with these borders
+// -o: Output path without extension
+//
+// Writes output.atlas and the pages as output_0.png, output_1.png... into the
+// directory mounted at page_prefix: "-C assets -p /assets -a /atlas -o out/ui"
+// makes "out/ui.atlas" with pages named "/atlas/ui_<n>.png" and images named
+// like "/assets/icon.png".
+
+#include <bgame/asset/atlas.h>
+#include <cute_image.h>
+// cute_framework does not export its own copy
+#define CUTE_PNG_IMPLEMENTATION
+#include <cute/cute_png.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	char* path;
+	size_t path_len;
+	CF_Image image;
+	uint32_t page, x, y;
+	bool is_9patch;
+	int left, right, top, bottom;
+} atlas_file_t;
+
+typedef struct {
+	const char* name;
+	int left, right, top, bottom;
+} atlas_9patch_spec_t;
+
+typedef struct {
+	int height;
+	// Shelves are rows as tall as the first image placed in them
+	int shelf_y, shelf_height, shelf_x;
+} atlas_page_t;
+
+static int
+atlas_compare_paths(const void* lhs, const void* rhs) {
+	const atlas_file_t* lhs_file = lhs;
+	const atlas_file_t* rhs_file = rhs;
+	size_t min_len = lhs_file->path_len < rhs_file->path_len ? lhs_file->path_len : rhs_file->path_len;
+	int cmp = memcmp(lhs_file->path, rhs_file->path, min_len);
+	if (cmp != 0) { return cmp; }
+	return lhs_file->path_len < rhs_file->path_len ? -1 : (lhs_file->path_len > rhs_file->path_len ? 1 : 0);
+}
+
+// Tallest first so that shelves waste little space
+static int
+atlas_compare_heights(const void* lhs, const void* rhs) {
+	const atlas_file_t* lhs_file = *(const atlas_file_t* const*)lhs;
+	const atlas_file_t* rhs_file = *(const atlas_file_t* const*)rhs;
+	if (lhs_file->image.h != rhs_file->image.h) {
+		return lhs_file->image.h > rhs_file->image.h ? -1 : 1;
+	}
+	return atlas_compare_paths(lhs_file, rhs_file);
+}
+
+static void*
+atlas_read_file(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return NULL; }
+
+	void* data = NULL;
+	long file_size = -1;
+	if (fseek(file, 0, SEEK_END) == 0) { file_size = ftell(file); }
+	if (file_size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+		data = malloc((size_t)file_size);
+		if (data != NULL && fread(data, (size_t)file_size, 1, file) != 1) {
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(file);
+
+	*size = (size_t)file_size;
+	return data;
+}
+
+static bool
+atlas_load_file(
+	atlas_file_t* file,
+	const char* dir,
+	const char* prefix,
+	const char* name,
+	const atlas_9patch_spec_t* specs,
+	int num_specs
+) {
+	size_t prefix_len = strlen(prefix);
+	// Avoid a double slash with the default prefix
+	bool add_slash = prefix_len == 0 || prefix[prefix_len - 1] != '/';
+	size_t name_len = strlen(name);
+	file->path_len = prefix_len + (add_slash ? 1 : 0) + name_len;
+	file->path = malloc(file->path_len + 1);
+	sprintf(file->path, "%s%s%s", prefix, add_slash ? "/" : "", name);
+
+	size_t dir_len = strlen(dir);
+	char* fs_path = malloc(dir_len + 1 + name_len + 1);
+	sprintf(fs_path, "%s/%s", dir, name);
+	size_t size;
+	void* data = atlas_read_file(fs_path, &size);
+	if (data == NULL) {
+		fprintf(stderr, "Could not read %s\n", fs_path);
+		free(fs_path);
+		return false;
+	}
+
+	CF_Result result = cf_image_load_png_from_memory(data, (int)size, &file->image);
+	free(data);
+	if (result.code != CF_RESULT_SUCCESS) {
+		fprintf(stderr, "Could not decode %s: %s\n", fs_path, result.details);
+		free(fs_path);
+		return false;
+	}
+
+	for (int i = 0; i < num_specs; ++i) {
+		if (strcmp(specs[i].name, name) != 0) { continue; }
+
+		file->is_9patch = true;
+		file->left = specs[i].left;
+		file->right = specs[i].right;
+		file->top = specs[i].top;
+		file->bottom = specs[i].bottom;
+		if (file->left + file->right >= file->image.w || file->top + file->bottom >= file->image.h) {
+			fprintf(stderr, "9-patch borders do not fit in %s\n", fs_path);
+			free(fs_path);
+			return false;
+		}
+	}
+
+	free(fs_path);
+	return true;
+}
+
+static bool
+atlas_place_files(
+	atlas_file_t* files,
+	int num_files,
+	int page_size,
+	int padding,
+	atlas_page_t** pages_out,
+	int* num_pages_out
+) {
+	atlas_file_t** order = malloc(sizeof(atlas_file_t*) * (num_files > 0 ? (size_t)num_files : 1));
+	for (int i = 0; i < num_files; ++i) { order[i] = &files[i]; }
+	qsort(order, (size_t)num_files, sizeof(atlas_file_t*), atlas_compare_heights);
+
+	atlas_page_t* pages = NULL;
+	int num_pages = 0;
+	bool ok = true;
+	for (int i = 0; i < num_files && ok; ++i) {
+		atlas_file_t* file = order[i];
+		int w = file->image.w;
+		int h = file->image.h;
+		if (w > page_size || h > page_size) {
+			fprintf(stderr, "%s is larger than a page\n", file->path);
+			ok = false;
+			break;
+		}
+
+		// First fit in the current shelf of each page, then in a new shelf
+		int page_index = -1;
+		for (int j = 0; j < num_pages && page_index < 0; ++j) {
+			atlas_page_t* page = &pages[j];
+			if (h <= page->shelf_height && page->shelf_x + w <= page_size) {
+				page_index = j;
+			} else if (page->shelf_y + page->shelf_height + h <= page_size) {
+				page->shelf_y += page->shelf_height;
+				page->shelf_height = h + padding;
+				page->shelf_x = 0;
+				page_index = j;
+			}
+		}
+
+		if (page_index < 0) {
+			pages = realloc(pages, sizeof(atlas_page_t) * (size_t)(num_pages + 1));
+			pages[num_pages] = (atlas_page_t){ .shelf_height = h + padding };
+			page_index = num_pages++;
+		}
+
+		atlas_page_t* page = &pages[page_index];
+		file->page = (uint32_t)page_index;
+		file->x = (uint32_t)page->shelf_x;
+		file->y = (uint32_t)page->shelf_y;
+		page->shelf_x += w + padding;
+		if (page->shelf_y + h > page->height) { page->height = page->shelf_y + h; }
+	}
+
+	free(order);
+	*pages_out = pages;
+	*num_pages_out = num_pages;
+	return ok;
+}
+
+static bool
+atlas_write_png(const char* path, const CF_Pixel* pixels, int width, int height) {
+	cp_image_t image = {
+		.w = width,
+		.h = height,
+		.pix = (cp_pixel_t*)pixels,
+	};
+	// Returns 0 on success
+	bool write_ok = cp_save_png(path, &image) == 0;
+	if (!write_ok) {
+		fprintf(stderr, "Could not write %s\n", path);
+	}
+	return write_ok;
+}
+
+static bool
+atlas_write_pages(
+	const char* output_path,
+	const atlas_file_t* files,
+	int num_files,
+	const atlas_page_t* pages,
+	int num_pages,
+	int page_size
+) {
+	bool ok = true;
+	char* page_path = malloc(strlen(output_path) + 32);
+	for (int i = 0; i < num_pages && ok; ++i) {
+		CF_Pixel* pixels = calloc((size_t)page_size * (size_t)pages[i].height, sizeof(CF_Pixel));
+		for (int j = 0; j < num_files; ++j) {
+			const atlas_file_t* file = &files[j];
+			if (file->page != (uint32_t)i) { continue; }
+
+			for (int y = 0; y < file->image.h; ++y) {
+				memcpy(
+					&pixels[(file->y + y) * (size_t)page_size + file->x],
+					&file->image.pix[y * (size_t)file->image.w],
+					(size_t)file->image.w * sizeof(CF_Pixel)
+				);
+			}
+		}
+
+		sprintf(page_path, "%s_%d.png", output_path, i);
+		ok = atlas_write_png(page_path, pixels, page_size, pages[i].height);
+		free(pixels);
+	}
+	free(page_path);
+	return ok;
+}
+
+static bool
+atlas_write_index(
+	const char* output_path,
+	const char* page_prefix,
+	const atlas_file_t* files,
+	int num_files,
+	const atlas_page_t* pages,
+	int num_pages,
+	int page_size
+) {
+	// Pages are named after the output file
+	const char* basename = strrchr(output_path, '/');
+	basename = basename != NULL ? basename + 1 : output_path;
+	size_t prefix_len = strlen(page_prefix);
+	bool add_slash = prefix_len == 0 || page_prefix[prefix_len - 1] != '/';
+	char** page_paths = malloc(sizeof(char*) * (num_pages > 0 ? (size_t)num_pages : 1));
+	for (int i = 0; i < num_pages; ++i) {
+		page_paths[i] = malloc(prefix_len + 1 + strlen(basename) + 32);
+		sprintf(page_paths[i], "%s%s%s_%d.png", page_prefix, add_slash ? "/" : "", basename, i);
+	}
+
+	char* index_path = malloc(strlen(output_path) + sizeof(".atlas"));
+	sprintf(index_path, "%s.atlas", output_path);
+	FILE* output = fopen(index_path, "wb");
+	bool write_ok = output != NULL;
+
+	uint32_t header[4] = { BGAME_ATLAS_MAGIC, BGAME_ATLAS_VERSION, (uint32_t)num_pages, (uint32_t)num_files };
+	write_ok = write_ok && fwrite(header, sizeof(header), 1, output) == 1;
+
+	uint32_t path_offset = BGAME_ATLAS_HEADER_SIZE
+		+ (uint32_t)num_pages * sizeof(bgame_atlas_page_t)
+		+ (uint32_t)num_files * sizeof(bgame_atlas_image_t);
+	for (int i = 0; i < num_pages && write_ok; ++i) {
+		bgame_atlas_page_t page = {
+			.path_offset = path_offset,
+			.path_len = (uint32_t)strlen(page_paths[i]),
+			.width = (uint32_t)page_size,
+			.height = (uint32_t)pages[i].height,
+		};
+		write_ok = fwrite(&page, sizeof(page), 1, output) == 1;
+		path_offset += page.path_len;
+	}
+
+	for (int i = 0; i < num_files && write_ok; ++i) {
+		const atlas_file_t* file = &files[i];
+		bgame_atlas_image_t image = {
+			.path_offset = path_offset,
+			.path_len = (uint32_t)file->path_len,
+			.page = file->page,
+			.x = file->x,
+			.y = file->y,
+			.width = (uint32_t)file->image.w,
+			.height = (uint32_t)file->image.h,
+			.flags = file->is_9patch ? BGAME_ATLAS_IMAGE_9PATCH : 0,
+			.left = (uint32_t)file->left,
+			.right = (uint32_t)file->right,
+			.top = (uint32_t)file->top,
+			.bottom = (uint32_t)file->bottom,
+		};
+		write_ok = fwrite(&image, sizeof(image), 1, output) == 1;
+		path_offset += image.path_len;
+	}
+
+	for (int i = 0; i < num_pages && write_ok; ++i) {
+		write_ok = fwrite(page_paths[i], strlen(page_paths[i]), 1, output) == 1;
+	}
+	for (int i = 0; i < num_files && write_ok; ++i) {
+		write_ok = fwrite(files[i].path, files[i].path_len, 1, output) == 1;
+	}
+
+	if (output != NULL) {
+		write_ok = fclose(output) == 0 && write_ok;
+	}
+	if (!write_ok) {
+		fprintf(stderr, "Could not write %s\n", index_path);
+	}
+
+	free(index_path);
+	for (int i = 0; i < num_pages; ++i) {
+		free(page_paths[i]);
+	}
+	free(page_paths);
+	return write_ok;
+}
+
+int
+main(int argc, const char** argv) {
+	int page_size = 1024;
+	int padding = 1;
+	const char* dir = ".";
+	const char* prefix = "/";
+	const char* page_prefix = NULL;
+	const char* output_path = NULL;
+	atlas_9patch_spec_t* specs = malloc(sizeof(atlas_9patch_spec_t) * (size_t)argc);
+	int num_specs = 0;
+
+	int first_file = argc;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			page_size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+			padding = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+			dir = argv[++i];
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			prefix = argv[++i];
+		} else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			page_prefix = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (strcmp(argv[i], "-9") == 0 && i + 1 < argc) {
+			// The name itself may contain ':' so split on the last one
+			const char* spec = argv[++i];
+			const char* colon = strrchr(spec, ':');
+			atlas_9patch_spec_t* nine_patch = &specs[num_specs];
+			if (
+				colon == NULL
+				|| sscanf(colon + 1, "%d,%d,%d,%d", &nine_patch->left, &nine_patch->right, &nine_patch->top, &nine_patch->bottom) != 4
+				|| nine_patch->left < 0 || nine_patch->right < 0 || nine_patch->top < 0 || nine_patch->bottom < 0
+			) {
+				output_path = NULL;
+				break;
+			}
+			char* name = malloc((size_t)(colon - spec) + 1);
+			memcpy(name, spec, (size_t)(colon - spec));
+			name[colon - spec] = '\0';
+			nine_patch->name = name;
+			++num_specs;
+		} else if (argv[i][0] == '-') {
+			output_path = NULL;
+			break;
+		} else {
+			first_file = i;
+			break;
+		}
+	}
+
+	if (output_path == NULL || page_size <= 0 || padding < 0) {
+		fprintf(
+			stderr,
+			"Usage: %s [-s size] [-P padding] [-C dir] [-p prefix] [-a page_prefix] [-9 file:left,right,top,bottom]... -o output file...\n",
+			argv[0]
+		);
+		return 1;
+	}
+
+	if (page_prefix == NULL) { page_prefix = prefix; }
+
+	int num_files = argc - first_file;
+	atlas_file_t* files = calloc(num_files > 0 ? (size_t)num_files : 1, sizeof(atlas_file_t));
+	bool ok = true;
+	for (int i = 0; i < num_files && ok; ++i) {
+		ok = atlas_load_file(&files[i], dir, prefix, argv[first_file + i], specs, num_specs);
+	}
+
+	if (ok) {
+		qsort(files, (size_t)num_files, sizeof(atlas_file_t), atlas_compare_paths);
+		for (int i = 1; i < num_files && ok; ++i) {
+			if (atlas_compare_paths(&files[i - 1], &files[i]) == 0) {
+				fprintf(stderr, "Duplicate path: %s\n", files[i].path);
+				ok = false;
+			}
+		}
+	}
+
+	atlas_page_t* pages = NULL;
+	int num_pages = 0;
+	if (ok) {
+		ok = atlas_place_files(files, num_files, page_size, padding, &pages, &num_pages);
+	}
+
+	if (ok) {
+		ok = atlas_write_pages(output_path, files, num_files, pages, num_pages, page_size)
+			&& atlas_write_index(output_path, page_prefix, files, num_files, pages, num_pages, page_size);
+	}
+
+	if (ok) {
+		fprintf(stderr, "Baked %d images into %d pages for %s.atlas\n", num_files, num_pages, output_path);
+	}
+
+	for (int i = 0; i < num_files; ++i) {
+		free(files[i].path);
+		if (files[i].image.pix != NULL) {
+			cf_image_free(&files[i].image);
+		}
+	}
+	free(files);
+	free(pages);
+	for (int i = 0; i < num_specs; ++i) {
+		free((void*)specs[i].name);
+	}
+	free(specs);
+
+	return ok ? 0 : 1;
+}
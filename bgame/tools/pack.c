@@ -0,0 +1,236 @@
+// Packs asset files into an archive for bgame_archive_mount.
+//
+// Usage: bgame-pack [-d] [-C dir] [-p prefix] -o output file...
+//
+// -d: Store PNG files as decoded pixels so that loading them is only a lookup
+// -C: Directory the files are relative to (default: .)
+// -p: Prefix of the paths in the archive (default: /)
+// -o: Output file
+//
+// Each file is stored under prefix + its path, "-C assets -p /assets icon.png"
+// becomes "/assets/icon.png".
+
+#include <bgame/asset/archive.h>
+#include <cute_image.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	char* path;
+	size_t path_len;
+	void* data;
+	size_t size;
+	int width;
+	int height;
+} pack_file_t;
+
+static int
+pack_compare_files(const void* lhs, const void* rhs) {
+	const pack_file_t* lhs_file = lhs;
+	const pack_file_t* rhs_file = rhs;
+	size_t min_len = lhs_file->path_len < rhs_file->path_len ? lhs_file->path_len : rhs_file->path_len;
+	int cmp = memcmp(lhs_file->path, rhs_file->path, min_len);
+	if (cmp != 0) { return cmp; }
+	return lhs_file->path_len < rhs_file->path_len ? -1 : (lhs_file->path_len > rhs_file->path_len ? 1 : 0);
+}
+
+static bool
+pack_has_extension(const char* filename, const char* extension) {
+	const char* dot = strrchr(filename, '.');
+	return dot != NULL && dot != filename && strcmp(dot + 1, extension) == 0;
+}
+
+static void*
+pack_read_file(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return NULL; }
+
+	void* data = NULL;
+	long file_size = -1;
+	if (fseek(file, 0, SEEK_END) == 0) { file_size = ftell(file); }
+	if (file_size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+		// Never malloc(0) so that empty files are not mistaken for errors
+		data = malloc((size_t)file_size + 1);
+		if (data != NULL && file_size > 0 && fread(data, (size_t)file_size, 1, file) != 1) {
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(file);
+
+	*size = (size_t)file_size;
+	return data;
+}
+
+static bool
+pack_load_file(
+	pack_file_t* file,
+	const char* dir,
+	const char* prefix,
+	const char* name,
+	bool decode_png
+) {
+	size_t prefix_len = strlen(prefix);
+	// Avoid a double slash with the default prefix
+	bool add_slash = prefix_len == 0 || prefix[prefix_len - 1] != '/';
+	size_t name_len = strlen(name);
+	file->path_len = prefix_len + (add_slash ? 1 : 0) + name_len;
+	file->path = malloc(file->path_len + 1);
+	sprintf(file->path, "%s%s%s", prefix, add_slash ? "/" : "", name);
+
+	size_t dir_len = strlen(dir);
+	char* fs_path = malloc(dir_len + 1 + name_len + 1);
+	sprintf(fs_path, "%s/%s", dir, name);
+	file->data = pack_read_file(fs_path, &file->size);
+	if (file->data == NULL) {
+		fprintf(stderr, "Could not read %s\n", fs_path);
+		free(fs_path);
+		return false;
+	}
+
+	if (decode_png && pack_has_extension(name, "png")) {
+		CF_Image image;
+		CF_Result result = cf_image_load_png_from_memory(file->data, (int)file->size, &image);
+		if (result.code != CF_RESULT_SUCCESS) {
+			fprintf(stderr, "Could not decode %s: %s\n", fs_path, result.details);
+			free(fs_path);
+			return false;
+		}
+
+		free(file->data);
+		file->size = (size_t)image.w * (size_t)image.h * sizeof(CF_Pixel);
+		file->data = malloc(file->size);
+		memcpy(file->data, image.pix, file->size);
+		file->width = image.w;
+		file->height = image.h;
+		cf_image_free(&image);
+	}
+
+	free(fs_path);
+	return true;
+}
+
+static inline uint64_t
+pack_align(uint64_t offset) {
+	return (offset + BGAME_ARCHIVE_ALIGNMENT - 1) / BGAME_ARCHIVE_ALIGNMENT * BGAME_ARCHIVE_ALIGNMENT;
+}
+
+static bool
+pack_write(const char* output_path, pack_file_t* files, int num_files) {
+	FILE* output = fopen(output_path, "wb");
+	if (output == NULL) {
+		fprintf(stderr, "Could not open %s\n", output_path);
+		return false;
+	}
+
+	uint32_t header[4] = { BGAME_ARCHIVE_MAGIC, BGAME_ARCHIVE_VERSION, (uint32_t)num_files, 0 };
+	bool write_ok = fwrite(header, sizeof(header), 1, output) == 1;
+
+	uint64_t path_offset = BGAME_ARCHIVE_HEADER_SIZE + (uint64_t)num_files * sizeof(bgame_archive_entry_t);
+	uint64_t data_offset = path_offset;
+	for (int i = 0; i < num_files; ++i) {
+		data_offset += files[i].path_len;
+	}
+
+	for (int i = 0; i < num_files && write_ok; ++i) {
+		data_offset = pack_align(data_offset);
+		bgame_archive_entry_t entry = {
+			.offset = data_offset,
+			.size = files[i].size,
+			.path_offset = (uint32_t)path_offset,
+			.path_len = (uint32_t)files[i].path_len,
+			.width = (uint32_t)files[i].width,
+			.height = (uint32_t)files[i].height,
+		};
+		write_ok = fwrite(&entry, sizeof(entry), 1, output) == 1;
+
+		path_offset += files[i].path_len;
+		data_offset += files[i].size;
+	}
+
+	for (int i = 0; i < num_files && write_ok; ++i) {
+		write_ok = fwrite(files[i].path, files[i].path_len, 1, output) == 1;
+	}
+
+	static const uint8_t padding[BGAME_ARCHIVE_ALIGNMENT] = { 0 };
+	for (int i = 0; i < num_files && write_ok; ++i) {
+		long position = ftell(output);
+		size_t padding_size = (size_t)(pack_align((uint64_t)position) - (uint64_t)position);
+		write_ok = position >= 0
+			&& (padding_size == 0 || fwrite(padding, padding_size, 1, output) == 1)
+			&& (files[i].size == 0 || fwrite(files[i].data, files[i].size, 1, output) == 1);
+	}
+
+	write_ok = fclose(output) == 0 && write_ok;
+	if (!write_ok) {
+		fprintf(stderr, "Could not write %s\n", output_path);
+	}
+	return write_ok;
+}
+
+int
+main(int argc, const char** argv) {
+	bool decode_png = false;
+	const char* dir = ".";
+	const char* prefix = "/";
+	const char* output_path = NULL;
+
+	int first_file = argc;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-d") == 0) {
+			decode_png = true;
+		} else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+			dir = argv[++i];
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			prefix = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (argv[i][0] == '-') {
+			output_path = NULL;
+			break;
+		} else {
+			first_file = i;
+			break;
+		}
+	}
+
+	if (output_path == NULL) {
+		fprintf(stderr, "Usage: %s [-d] [-C dir] [-p prefix] -o output file...\n", argv[0]);
+		return 1;
+	}
+
+	int num_files = argc - first_file;
+	pack_file_t* files = calloc(num_files > 0 ? (size_t)num_files : 1, sizeof(pack_file_t));
+	bool ok = true;
+	for (int i = 0; i < num_files && ok; ++i) {
+		ok = pack_load_file(&files[i], dir, prefix, argv[first_file + i], decode_png);
+	}
+
+	if (ok) {
+		qsort(files, (size_t)num_files, sizeof(pack_file_t), pack_compare_files);
+		for (int i = 1; i < num_files && ok; ++i) {
+			if (pack_compare_files(&files[i - 1], &files[i]) == 0) {
+				fprintf(stderr, "Duplicate path: %s\n", files[i].path);
+				ok = false;
+			}
+		}
+	}
+
+	if (ok) {
+		ok = pack_write(output_path, files, num_files);
+	}
+
+	if (ok) {
+		fprintf(stderr, "Packed %d files into %s\n", num_files, output_path);
+	}
+
+	for (int i = 0; i < num_files; ++i) {
+		free(files[i].path);
+		free(files[i].data);
+	}
+	free(files);
+
+	return ok ? 0 : 1;
+}
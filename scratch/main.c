@@ -3,6 +3,7 @@
 #include <bgame/allocator/tracked.h>
 #include <bgame/scene.h>
 #include <bgame/log.h>
+#include <bgame/asset/atlas.h>
 #include <cute_graphics.h>
 #include <stdbool.h>
 #include <inttypes.h>
@@ -29,6 +30,15 @@ init(int argc, const char** argv) {
 			log_warn("Could not mount %s: %s", ".", result.details);
 		}
 
+#if !BGAME_RELOADABLE
+		// Baked by scratch-atlas
+		result = cf_fs_mount("./atlas", "/atlas", true);
+		if (result.code != CF_RESULT_SUCCESS) {
+			log_warn("Could not mount %s: %s", "./atlas", result.details);
+		}
+		bgame_use_atlas("/atlas/scratch.atlas");
+#endif
+
 		cf_app_init_imgui();
 		cf_shader_directory("/assets");
 
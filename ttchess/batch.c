@@ -0,0 +1,755 @@
+#include "batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TTCHESS_BATCH_OFF_BOARD 0x80
+#define TTCHESS_BATCH_POS_MASK 0x0f
+#define TTCHESS_BATCH_STATUS_SHIFT 4
+#define TTCHESS_BATCH_STATUS_MASK 0x07
+
+typedef struct {
+	uint16_t* storage;
+	int max_len;
+	int len;
+} ttchess_batch_move_list_t;
+
+static inline void
+ttchess_batch_add_move(ttchess_batch_move_list_t* list, ttchess_move_t move) {
+	int index = list->len++;
+	if (index < list->max_len) {
+		list->storage[index] = ttchess_move_pack(move);
+	}
+}
+
+static inline ttchess_color_t
+ttchess_batch_opponent(ttchess_color_t color) {
+	return color == TTCHESS_COLOR_WHITE ? TTCHESS_COLOR_BLACK : TTCHESS_COLOR_WHITE;
+}
+
+static inline int
+ttchess_batch_status(uint8_t packed_pawn) {
+	return (packed_pawn >> TTCHESS_BATCH_STATUS_SHIFT) & TTCHESS_BATCH_STATUS_MASK;
+}
+
+static inline uint8_t
+ttchess_batch_with_status(uint8_t packed_pawn, int status) {
+	return (uint8_t)(
+		(packed_pawn & ~(TTCHESS_BATCH_STATUS_MASK << TTCHESS_BATCH_STATUS_SHIFT))
+		| (status << TTCHESS_BATCH_STATUS_SHIFT)
+	);
+}
+
+// Returns -1 when the pawn is not on any board
+static inline int
+ttchess_batch_pawn_era(uint8_t packed_pawn) {
+	int status = ttchess_batch_status(packed_pawn);
+	return TTCHESS_PAWN_PAST <= status && status <= TTCHESS_PAWN_FUTURE
+		? status - TTCHESS_PAWN_PAST
+		: -1;
+}
+
+static inline int
+ttchess_batch_first_pawn(ttchess_color_t color) {
+	return color == TTCHESS_COLOR_WHITE ? TTCHESS_FIRST_WHITE_PAWN : TTCHESS_FIRST_BLACK_PAWN;
+}
+
+static inline int
+ttchess_batch_first_cell(ttchess_bitboard_t bitboard) {
+	int cell = 0;
+	while (!(bitboard & (1u << cell))) { ++cell; }
+	return cell;
+}
+
+static inline bool
+ttchess_batch_has_reserve(const ttchess_batch_t* batch, int game, ttchess_color_t color) {
+	int pawn_min = ttchess_batch_first_pawn(color);
+	for (int pawn_index = pawn_min; pawn_index < pawn_min + TTCHESS_NUM_PAWNS / 2; ++pawn_index) {
+		if (ttchess_batch_status(batch->pawns[pawn_index][game]) == TTCHESS_PAWN_RESERVE) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline int8_t
+ttchess_batch_pawn_at(
+	const ttchess_batch_t* batch,
+	int game,
+	ttchess_color_t color,
+	int era,
+	int cell
+) {
+	int pawn_min = ttchess_batch_first_pawn(color);
+	for (int pawn_index = pawn_min; pawn_index < pawn_min + TTCHESS_NUM_PAWNS / 2; ++pawn_index) {
+		uint8_t packed_pawn = batch->pawns[pawn_index][game];
+		if (
+			ttchess_batch_pawn_era(packed_pawn) == era
+			&& (packed_pawn & TTCHESS_BATCH_POS_MASK) == cell
+		) {
+			return (int8_t)pawn_index;
+		}
+	}
+
+	return -1;
+}
+
+static inline ttchess_bitboard_t
+ttchess_batch_pawns(const ttchess_batch_t* batch, int game, int era) {
+	return (ttchess_bitboard_t)(
+		batch->boards[era][TTCHESS_COLOR_WHITE][game]
+		| batch->boards[era][TTCHESS_COLOR_BLACK][game]
+	);
+}
+
+// Batches without statues never touch their column
+static inline ttchess_bitboard_t
+ttchess_batch_statues(const ttchess_batch_t* batch, int game, int era) {
+	return batch->config.with_statues ? batch->statue_boards[era][game] : 0;
+}
+
+static inline ttchess_bitboard_t
+ttchess_batch_occupied(const ttchess_batch_t* batch, int game, int era) {
+	return (ttchess_bitboard_t)(ttchess_batch_pawns(batch, game, era) | ttchess_batch_statues(batch, game, era));
+}
+
+// Same as ttchess_pos_bit
+static inline ttchess_bitboard_t
+ttchess_batch_cell_bit(int x, int y) {
+	if (!(0 <= x && x < TTCHESS_BOARD_WIDTH && 0 <= y && y < TTCHESS_BOARD_HEIGHT)) {
+		return 0;
+	}
+
+	return (ttchess_bitboard_t)(1u << (y * TTCHESS_BOARD_WIDTH + x));
+}
+
+static inline int8_t
+ttchess_batch_statue_at(const ttchess_batch_t* batch, int game, int era, int cell) {
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		if (batch->statues[statue_index][era][game] == cell) {
+			return (int8_t)statue_index;
+		}
+	}
+
+	return -1;
+}
+
+// Statues can't be pushed off the board so a statue that was built is on at
+// least one of them
+static inline bool
+ttchess_batch_statue_built(const ttchess_batch_t* batch, int game, int statue_index) {
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		if (!(batch->statues[statue_index][era][game] & TTCHESS_BATCH_OFF_BOARD)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Same as ttchess_piece_can_move
+static bool
+ttchess_batch_piece_can_move(
+	const ttchess_batch_t* batch,
+	int game,
+	int era,
+	int from_x, int from_y,
+	int to_x, int to_y,
+	int depth
+) {
+	if (depth > TTCHESS_BOARD_WIDTH) { return false; }
+	ttchess_bitboard_t from_bit = ttchess_batch_cell_bit(from_x, from_y);
+	ttchess_bitboard_t to_bit = ttchess_batch_cell_bit(to_x, to_y);
+	if (from_bit == 0) { return false; }
+
+	ttchess_bitboard_t statues = ttchess_batch_statues(batch, game, era);
+	if (statues & from_bit) {
+		if (to_bit == 0) { return false; }
+	} else if (ttchess_batch_pawns(batch, game, era) & from_bit) {
+		if (to_bit == 0) { return depth > 0; }
+	} else {
+		return depth > 0;
+	}
+
+	if (!(statues & to_bit)) { return true; }
+
+	return ttchess_batch_piece_can_move(
+		batch, game, era,
+		to_x, to_y,
+		to_x + (to_x - from_x), to_y + (to_y - from_y),
+		depth + 1
+	);
+}
+
+// Same as ttchess_last_pawn_era, returns -1 instead of false
+static inline int
+ttchess_batch_last_pawn_era(const ttchess_batch_t* batch, int game) {
+	int8_t pawn_id = batch->last_pawn[game];
+	if (!(0 <= pawn_id && pawn_id < TTCHESS_NUM_PAWNS)) { return -1; }
+	if (ttchess_pawn_color(pawn_id) != batch->color[game]) { return -1; }
+
+	return ttchess_batch_pawn_era(batch->pawns[pawn_id][game]);
+}
+
+static inline void
+ttchess_batch_gen_pawn_moves(
+	ttchess_batch_move_list_t* move_list,
+	const ttchess_batch_t* batch,
+	int game,
+	int8_t pawn_id,
+	int pawn_era,
+	bool has_reserve
+) {
+	int cell = batch->pawns[pawn_id][game] & TTCHESS_BATCH_POS_MASK;
+	ttchess_bitboard_t pawn_bit = (ttchess_bitboard_t)(1u << cell);
+	int x = cell % TTCHESS_BOARD_WIDTH;
+	int y = cell / TTCHESS_BOARD_WIDTH;
+
+	if (has_reserve) {
+		for (int era = 0; era < pawn_era; ++era) {
+			if (!(ttchess_batch_occupied(batch, game, era) & pawn_bit)) {
+				ttchess_batch_add_move(move_list, (ttchess_move_t){
+					.type = TTCHESS_MOVE_TIME_TRAVEL,
+					.pawn_id = pawn_id,
+					.era = (ttchess_era_t)era,
+				});
+			}
+		}
+	}
+
+	// Same order as ttchess_gen_cardinal_positions.
+	// A pawn can always step onto the board unless there is a statue in the way.
+	const int deltas[][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	ttchess_bitboard_t statues = ttchess_batch_statues(batch, game, pawn_era);
+	for (int i = 0; i < (int)(sizeof(deltas) / sizeof(deltas[0])); ++i) {
+		int target_x = x + deltas[i][0];
+		int target_y = y + deltas[i][1];
+		ttchess_bitboard_t target_bit = ttchess_batch_cell_bit(target_x, target_y);
+		if (
+			target_bit
+			&& (
+				!(statues & target_bit)
+				|| ttchess_batch_piece_can_move(batch, game, pawn_era, x, y, target_x, target_y, 0)
+			)
+		) {
+			ttchess_batch_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_PAWN,
+				.pawn_id = pawn_id,
+				.pos = { .x = (int8_t)target_x, .y = (int8_t)target_y },
+			});
+		}
+	}
+
+	if (!batch->config.with_statues) { return; }
+
+	bool can_build = !ttchess_batch_statue_built(batch, game, ttchess_pawn_color(pawn_id));
+	ttchess_bitboard_t occupied = ttchess_batch_occupied(batch, game, pawn_era);
+	for (int i = 0; i < (int)(sizeof(deltas) / sizeof(deltas[0])); ++i) {
+		int target_x = x + deltas[i][0];
+		int target_y = y + deltas[i][1];
+		ttchess_bitboard_t target_bit = ttchess_batch_cell_bit(target_x, target_y);
+		if (!target_bit) { continue; }
+
+		if (can_build && !(occupied & target_bit)) {
+			ttchess_batch_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_BUILD_STATUE,
+				.pawn_id = pawn_id,
+				.pos = { .x = (int8_t)target_x, .y = (int8_t)target_y },
+			});
+		}
+
+		// Directions come in opposite pairs
+		int statue_x = x + deltas[i ^ 1][0];
+		int statue_y = y + deltas[i ^ 1][1];
+		if (
+			(statues & ttchess_batch_cell_bit(statue_x, statue_y))
+			&& ttchess_batch_piece_can_move(batch, game, pawn_era, x, y, target_x, target_y, 1)
+		) {
+			ttchess_batch_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_PULL_STATUE,
+				.pawn_id = pawn_id,
+				.subject_id = ttchess_batch_statue_at(
+					batch, game, pawn_era, statue_y * TTCHESS_BOARD_WIDTH + statue_x
+				),
+				.pos = { .x = (int8_t)target_x, .y = (int8_t)target_y },
+			});
+		}
+	}
+}
+
+static int
+ttchess_batch_gen_moves(const ttchess_batch_t* batch, int game, uint16_t* moves, int moves_len) {
+	ttchess_batch_move_list_t move_list = {
+		.storage = moves,
+		.max_len = moves_len,
+	};
+	ttchess_color_t color = (ttchess_color_t)batch->color[game];
+	switch ((ttchess_player_action_t)batch->action[game]) {
+		case TTCHESS_ACTION_FIRST: {
+			int focused_era = batch->focuses[color][game];
+			bool has_reserve = false;
+			// Pawns are visited in cell order like ttchess_list_moves
+			int8_t cell_pawns[TTCHESS_BOARD_WIDTH * TTCHESS_BOARD_HEIGHT];
+			int pawn_min = ttchess_batch_first_pawn(color);
+			for (int pawn_index = pawn_min; pawn_index < pawn_min + TTCHESS_NUM_PAWNS / 2; ++pawn_index) {
+				uint8_t packed_pawn = batch->pawns[pawn_index][game];
+				has_reserve |= ttchess_batch_status(packed_pawn) == TTCHESS_PAWN_RESERVE;
+				if (ttchess_batch_pawn_era(packed_pawn) == focused_era) {
+					cell_pawns[packed_pawn & TTCHESS_BATCH_POS_MASK] = (int8_t)pawn_index;
+				}
+			}
+
+			for (
+				ttchess_bitboard_t pawns = batch->boards[focused_era][color][game];
+				pawns != 0;
+				pawns = (ttchess_bitboard_t)(pawns & (pawns - 1))
+			) {
+				int8_t pawn_id = cell_pawns[ttchess_batch_first_cell(pawns)];
+				ttchess_batch_gen_pawn_moves(&move_list, batch, game, pawn_id, focused_era, has_reserve);
+			}
+		} break;
+		case TTCHESS_ACTION_SECOND: {
+			int pawn_era = ttchess_batch_last_pawn_era(batch, game);
+			if (pawn_era >= 0) {
+				ttchess_batch_gen_pawn_moves(
+					&move_list, batch, game,
+					batch->last_pawn[game], pawn_era,
+					ttchess_batch_has_reserve(batch, game, color)
+				);
+			}
+		} break;
+		case TTCHESS_ACTION_SHIFT_FOCUS: {
+			if (ttchess_batch_last_pawn_era(batch, game) >= 0) {
+				int focused_era = batch->focuses[color][game];
+				for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+					if (era != focused_era) {
+						ttchess_batch_add_move(&move_list, (ttchess_move_t){
+							.type = TTCHESS_MOVE_SHIFT_FOCUS,
+							.era = (ttchess_era_t)era,
+						});
+					}
+				}
+			}
+		} break;
+		case TTCHESS_ACTION_WON:
+			break;
+	}
+
+	return move_list.len;
+}
+
+// Cells next to `cell` that are on the board
+static inline ttchess_bitboard_t
+ttchess_batch_neighbors(int cell) {
+	int x = cell % TTCHESS_BOARD_WIDTH;
+	int y = cell / TTCHESS_BOARD_WIDTH;
+	unsigned bit = 1u << cell;
+	return (ttchess_bitboard_t)(
+		  (x > 0 ? bit >> 1 : 0)
+		| (x < TTCHESS_BOARD_WIDTH - 1 ? bit << 1 : 0)
+		| (y > 0 ? bit >> TTCHESS_BOARD_WIDTH : 0)
+		| (y < TTCHESS_BOARD_HEIGHT - 1 ? bit << TTCHESS_BOARD_WIDTH : 0)
+	);
+}
+
+static inline bool
+ttchess_batch_has_moves(const ttchess_batch_t* batch, int game) {
+	ttchess_color_t color = (ttchess_color_t)batch->color[game];
+	int era;
+	ttchess_bitboard_t pawns;
+	switch ((ttchess_player_action_t)batch->action[game]) {
+		case TTCHESS_ACTION_FIRST:
+			era = batch->focuses[color][game];
+			pawns = batch->boards[era][color][game];
+			break;
+		case TTCHESS_ACTION_SECOND:
+			era = ttchess_batch_last_pawn_era(batch, game);
+			if (era < 0) { return false; }
+			pawns = (ttchess_bitboard_t)(1u << (batch->pawns[batch->last_pawn[game]][game] & TTCHESS_BATCH_POS_MASK));
+			break;
+		case TTCHESS_ACTION_SHIFT_FOCUS:
+			return ttchess_batch_last_pawn_era(batch, game) >= 0;
+		default:
+			return false;
+	}
+
+	// A pawn on a 4x4 board always has somewhere to step to unless statues
+	// surround it so this is much cheaper than counting the moves
+	if (!batch->config.with_statues) { return pawns != 0; }
+
+	ttchess_bitboard_t statues = batch->statue_boards[era][game];
+	for (ttchess_bitboard_t rest = pawns; rest != 0; rest = (ttchess_bitboard_t)(rest & (rest - 1))) {
+		if (ttchess_batch_neighbors(ttchess_batch_first_cell(rest)) & ~statues) {
+			return true;
+		}
+	}
+
+	return pawns != 0 && ttchess_batch_gen_moves(batch, game, NULL, 0) > 0;
+}
+
+static inline void
+ttchess_batch_kill_pawn(ttchess_batch_t* batch, int game, int8_t pawn_id) {
+	uint8_t* packed_pawn = &batch->pawns[pawn_id][game];
+	int era = ttchess_batch_pawn_era(*packed_pawn);
+	if (era >= 0) {
+		batch->boards[era][ttchess_pawn_color(pawn_id)][game] &=
+			(ttchess_bitboard_t)~(1u << (*packed_pawn & TTCHESS_BATCH_POS_MASK));
+	}
+	*packed_pawn = ttchess_batch_with_status(*packed_pawn, TTCHESS_PAWN_DEAD);
+}
+
+static void
+ttchess_batch_push_piece(ttchess_batch_t* batch, int game, int era, int cell, int delta_x, int delta_y);
+
+// Same as ttchess_push_piece for a pawn
+static void
+ttchess_batch_push_pawn(ttchess_batch_t* batch, int game, int era, int8_t pawn_id, int delta_x, int delta_y) {
+	uint8_t* packed_pawn = &batch->pawns[pawn_id][game];
+	int from = *packed_pawn & TTCHESS_BATCH_POS_MASK;
+	int to_x = from % TTCHESS_BOARD_WIDTH + delta_x;
+	int to_y = from / TTCHESS_BOARD_WIDTH + delta_y;
+	ttchess_bitboard_t to_bit = ttchess_batch_cell_bit(to_x, to_y);
+	if (to_bit == 0) {  // Pushed off board
+		ttchess_batch_kill_pawn(batch, game, pawn_id);
+		*packed_pawn = TTCHESS_BATCH_OFF_BOARD | (TTCHESS_PAWN_DEAD << TTCHESS_BATCH_STATUS_SHIFT);
+		return;
+	}
+
+	int to = to_y * TTCHESS_BOARD_WIDTH + to_x;
+	ttchess_color_t color = ttchess_pawn_color(pawn_id);
+	ttchess_color_t opposing_color = ttchess_batch_opponent(color);
+	if (batch->boards[era][color][game] & to_bit) {  // Paradox
+		int8_t target_id = ttchess_batch_pawn_at(batch, game, color, era, to);
+		ttchess_batch_kill_pawn(batch, game, pawn_id);
+		ttchess_batch_kill_pawn(batch, game, target_id);
+		return;
+	} else if (batch->boards[era][opposing_color][game] & to_bit) {  // Push opponent
+		int8_t target_id = ttchess_batch_pawn_at(batch, game, opposing_color, era, to);
+		ttchess_batch_push_pawn(batch, game, era, target_id, delta_x, delta_y);
+	} else if (ttchess_batch_statues(batch, game, era) & to_bit) {
+		// Try to push the statue away
+		if (!ttchess_batch_piece_can_move(batch, game, era, to_x, to_y, to_x + delta_x, to_y + delta_y, 1)) {
+			ttchess_batch_kill_pawn(batch, game, pawn_id);
+			return;
+		}
+		ttchess_batch_push_piece(batch, game, era, to, delta_x, delta_y);
+	}
+
+	batch->boards[era][color][game] ^= (ttchess_bitboard_t)((1u << from) | to_bit);
+	*packed_pawn = (uint8_t)((*packed_pawn & ~TTCHESS_BATCH_POS_MASK) | to);
+}
+
+// Same as ttchess_push_piece for a statue
+static void
+ttchess_batch_push_statue(ttchess_batch_t* batch, int game, int era, int8_t statue_id, int delta_x, int delta_y) {
+	// Propagate move through time
+	for (int statue_era = era; statue_era < TTCHESS_NUM_ERAS; ++statue_era) {
+		uint8_t* statue_cell = &batch->statues[statue_id][statue_era][game];
+		if (*statue_cell & TTCHESS_BATCH_OFF_BOARD) { break; }
+
+		int to_x = *statue_cell % TTCHESS_BOARD_WIDTH + delta_x;
+		int to_y = *statue_cell / TTCHESS_BOARD_WIDTH + delta_y;
+		int to = to_y * TTCHESS_BOARD_WIDTH + to_x;
+		ttchess_bitboard_t to_bit = ttchess_batch_cell_bit(to_x, to_y);
+		if (ttchess_batch_piece_can_move(batch, game, statue_era, to_x, to_y, to_x + delta_x, to_y + delta_y, 1)) {
+			ttchess_batch_push_piece(batch, game, statue_era, to, delta_x, delta_y);
+		} else if (ttchess_batch_pawns(batch, game, statue_era) & to_bit) {
+			// Squish a pawn that cannot be pushed away
+			ttchess_color_t color = (batch->boards[statue_era][TTCHESS_COLOR_WHITE][game] & to_bit)
+				? TTCHESS_COLOR_WHITE
+				: TTCHESS_COLOR_BLACK;
+			ttchess_batch_kill_pawn(batch, game, ttchess_batch_pawn_at(batch, game, color, statue_era, to));
+		} else {
+			break;
+		}
+
+		batch->statue_boards[statue_era][game] ^= (ttchess_bitboard_t)((1u << *statue_cell) | to_bit);
+		*statue_cell = (uint8_t)to;
+	}
+}
+
+// Pushes whatever is on `cell`, which must be on the board
+static void
+ttchess_batch_push_piece(ttchess_batch_t* batch, int game, int era, int cell, int delta_x, int delta_y) {
+	ttchess_bitboard_t bit = (ttchess_bitboard_t)(1u << cell);
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		if (batch->boards[era][color][game] & bit) {
+			int8_t pawn_id = ttchess_batch_pawn_at(batch, game, (ttchess_color_t)color, era, cell);
+			ttchess_batch_push_pawn(batch, game, era, pawn_id, delta_x, delta_y);
+			return;
+		}
+	}
+
+	if (ttchess_batch_statues(batch, game, era) & bit) {
+		int8_t statue_id = ttchess_batch_statue_at(batch, game, era, cell);
+		ttchess_batch_push_statue(batch, game, era, statue_id, delta_x, delta_y);
+	}
+}
+
+static void
+ttchess_batch_apply_core(ttchess_batch_t* batch, int game, ttchess_move_t move) {
+	ttchess_color_t color = (ttchess_color_t)batch->color[game];
+	ttchess_player_action_t action = (ttchess_player_action_t)batch->action[game];
+	if (action == TTCHESS_ACTION_FIRST) {
+		batch->last_pawn[game] = move.pawn_id;
+	}
+	int8_t pawn_id = batch->last_pawn[game];
+	uint8_t* packed_pawn = &batch->pawns[pawn_id][game];
+	int pawn_era = ttchess_batch_pawn_era(*packed_pawn);
+	int pawn_cell = *packed_pawn & TTCHESS_BATCH_POS_MASK;
+	int pawn_x = pawn_cell % TTCHESS_BOARD_WIDTH;
+	int pawn_y = pawn_cell / TTCHESS_BOARD_WIDTH;
+
+	switch (move.type) {
+		case TTCHESS_MOVE_PAWN:
+			ttchess_batch_push_pawn(batch, game, pawn_era, pawn_id, move.pos.x - pawn_x, move.pos.y - pawn_y);
+			break;
+		case TTCHESS_MOVE_TIME_TRAVEL: {
+			ttchess_bitboard_t pawn_bit = (ttchess_bitboard_t)(1u << pawn_cell);
+			int pawn_status = ttchess_batch_status(*packed_pawn);
+			*packed_pawn = ttchess_batch_with_status(*packed_pawn, TTCHESS_PAWN_PAST + (int)move.era);
+			batch->boards[pawn_era][color][game] &= (ttchess_bitboard_t)~pawn_bit;
+			batch->boards[move.era][color][game] |= pawn_bit;
+
+			// Leave clone behind
+			if ((int)move.era < pawn_era) {
+				int pawn_min = ttchess_batch_first_pawn(color);
+				for (int new_pawn_index = pawn_min; new_pawn_index < pawn_min + TTCHESS_NUM_PAWNS / 2; ++new_pawn_index) {
+					uint8_t* new_pawn = &batch->pawns[new_pawn_index][game];
+					if (ttchess_batch_status(*new_pawn) == TTCHESS_PAWN_RESERVE) {
+						*new_pawn = (uint8_t)(pawn_cell | (pawn_status << TTCHESS_BATCH_STATUS_SHIFT));
+						batch->boards[pawn_era][color][game] |= pawn_bit;
+						break;
+					}
+				}
+			}
+		} break;
+		case TTCHESS_MOVE_SHIFT_FOCUS:
+			batch->focuses[color][game] = (uint8_t)move.era;
+			break;
+		case TTCHESS_MOVE_BUILD_STATUE: {
+			// Statues are numbered after the player who can build them
+			int move_cell = move.pos.y * TTCHESS_BOARD_WIDTH + move.pos.x;
+			ttchess_bitboard_t move_bit = (ttchess_bitboard_t)(1u << move_cell);
+			batch->statues[color][pawn_era][game] = (uint8_t)move_cell;
+			batch->statue_boards[pawn_era][game] |= move_bit;
+
+			// Propagate to later eras as long as whatever is in the way can be
+			// pushed away
+			int delta_x = move.pos.x - pawn_x;
+			int delta_y = move.pos.y - pawn_y;
+			for (int era = pawn_era + 1; era < TTCHESS_NUM_ERAS; ++era) {
+				if (!ttchess_batch_piece_can_move(
+					batch, game, era,
+					move.pos.x, move.pos.y,
+					move.pos.x + delta_x, move.pos.y + delta_y,
+					1
+				)) {
+					break;
+				}
+
+				ttchess_batch_push_piece(batch, game, era, move_cell, delta_x, delta_y);
+				batch->statues[color][era][game] = (uint8_t)move_cell;
+				batch->statue_boards[era][game] |= move_bit;
+			}
+		} break;
+		case TTCHESS_MOVE_PULL_STATUE: {
+			int delta_x = move.pos.x - pawn_x;
+			int delta_y = move.pos.y - pawn_y;
+			ttchess_batch_push_pawn(batch, game, pawn_era, pawn_id, delta_x, delta_y);
+			// The statue is opposite of where the pawn went
+			int statue_cell = (pawn_y - delta_y) * TTCHESS_BOARD_WIDTH + (pawn_x - delta_x);
+			ttchess_batch_push_piece(batch, game, pawn_era, statue_cell, delta_x, delta_y);
+		} break;
+	}
+
+	switch (action) {
+		case TTCHESS_ACTION_FIRST:
+			batch->action[game] = TTCHESS_ACTION_SECOND;
+			break;
+		case TTCHESS_ACTION_SECOND:
+			batch->action[game] = TTCHESS_ACTION_SHIFT_FOCUS;
+			break;
+		case TTCHESS_ACTION_SHIFT_FOCUS: {
+			ttchess_color_t opposing_color = ttchess_batch_opponent(color);
+			int num_dominant_eras = 0;
+			for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+				if (batch->boards[era][opposing_color][game] == 0) {
+					++num_dominant_eras;
+				}
+			}
+			if (num_dominant_eras >= 2) {
+				batch->action[game] = TTCHESS_ACTION_WON;
+				return;
+			}
+
+			batch->action[game] = TTCHESS_ACTION_FIRST;
+			batch->color[game] = (uint8_t)opposing_color;
+		} break;
+		case TTCHESS_ACTION_WON:
+			return;
+	}
+
+	if (!ttchess_batch_has_moves(batch, game)) {
+		batch->action[game] = TTCHESS_ACTION_FIRST;
+		batch->color[game] = (uint8_t)ttchess_batch_opponent((ttchess_color_t)batch->color[game]);
+	}
+}
+
+static void
+ttchess_batch_gather(const ttchess_batch_t* batch, int game, uint8_t packed[TTCHESS_PACKED_SIZE]) {
+	uint8_t* out = packed;
+	*out++ = TTCHESS_PACKED_VERSION;
+	*out++ = (uint8_t)(
+		  (batch->config.with_statues ? 0x01 : 0)
+		| ((unsigned)batch->action[game] << 1)
+		| ((unsigned)batch->color[game] << 3)
+		| ((unsigned)batch->focuses[TTCHESS_COLOR_WHITE][game] << 4)
+		| ((unsigned)batch->focuses[TTCHESS_COLOR_BLACK][game] << 6)
+	);
+	*out++ = (uint8_t)batch->last_pawn[game];
+
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		*out++ = batch->pawns[pawn_index][game];
+	}
+
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			*out++ = batch->statues[statue_index][era][game];
+		}
+	}
+}
+
+static void
+ttchess_batch_scatter(ttchess_batch_t* batch, int game, const ttchess_state_t* state) {
+	uint8_t packed[TTCHESS_PACKED_SIZE];
+	ttchess_state_pack(state, packed);
+
+	const uint8_t* in = packed + 1;
+	uint8_t flags = *in++;
+	batch->action[game] = (flags >> 1) & 0x03;
+	batch->color[game] = (flags >> 3) & 0x01;
+	batch->focuses[TTCHESS_COLOR_WHITE][game] = (flags >> 4) & 0x03;
+	batch->focuses[TTCHESS_COLOR_BLACK][game] = (flags >> 6) & 0x03;
+	batch->last_pawn[game] = (int8_t)*in++;
+
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		batch->pawns[pawn_index][game] = *in++;
+	}
+
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			batch->statues[statue_index][era][game] = *in++;
+		}
+	}
+
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+			batch->boards[era][color][game] = state->boards[era].pawns[color];
+		}
+		batch->statue_boards[era][game] = state->boards[era].statues;
+	}
+}
+
+bool
+ttchess_batch_init(ttchess_batch_t* batch, ttchess_config_t config, int capacity) {
+	size_t num_games = (size_t)(capacity > 0 ? capacity : 1);
+	size_t num_bitboards = TTCHESS_NUM_ERAS * (TTCHESS_NUM_PLAYERS + 1);
+	size_t num_bytes = 2 + TTCHESS_NUM_PLAYERS + TTCHESS_NUM_PAWNS + TTCHESS_NUM_STATUES * TTCHESS_NUM_ERAS;
+	size_t bytes_per_game = num_bitboards * sizeof(ttchess_bitboard_t)
+		+ num_bytes
+		+ sizeof(int8_t);
+
+	void* memory = malloc(bytes_per_game * num_games);
+	if (memory == NULL) { return false; }
+
+	*batch = (ttchess_batch_t){
+		.config = config,
+		.capacity = capacity,
+		.memory = memory,
+	};
+
+	// Widest columns first so every column stays aligned
+	char* column = memory;
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+			batch->boards[era][color] = (ttchess_bitboard_t*)column;
+			column += sizeof(ttchess_bitboard_t) * num_games;
+		}
+		batch->statue_boards[era] = (ttchess_bitboard_t*)column;
+		column += sizeof(ttchess_bitboard_t) * num_games;
+	}
+
+	batch->action = (uint8_t*)column;
+	column += num_games;
+	batch->color = (uint8_t*)column;
+	column += num_games;
+	batch->last_pawn = (int8_t*)column;
+	column += num_games;
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		batch->focuses[color] = (uint8_t*)column;
+		column += num_games;
+	}
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		batch->pawns[pawn_index] = (uint8_t*)column;
+		column += num_games;
+	}
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			batch->statues[statue_index][era] = (uint8_t*)column;
+			column += num_games;
+		}
+	}
+
+	return true;
+}
+
+void
+ttchess_batch_cleanup(ttchess_batch_t* batch) {
+	free(batch->memory);
+	batch->memory = NULL;
+}
+
+int
+ttchess_batch_add(ttchess_batch_t* batch, const ttchess_state_t* state) {
+	if (batch->count >= batch->capacity) { return -1; }
+	if (state->config.with_statues != batch->config.with_statues) { return -1; }
+
+	int index = batch->count++;
+	ttchess_batch_scatter(batch, index, state);
+	return index;
+}
+
+void
+ttchess_batch_set(ttchess_batch_t* batch, int index, const ttchess_state_t* state) {
+	ttchess_batch_scatter(batch, index, state);
+}
+
+void
+ttchess_batch_get(const ttchess_batch_t* batch, int index, ttchess_state_t* state) {
+	uint8_t packed[TTCHESS_PACKED_SIZE];
+	ttchess_batch_gather(batch, index, packed);
+	// Only fails on a version mismatch or corrupted data, neither can happen
+	// from ttchess_state_pack
+	ttchess_state_unpack(state, packed);
+}
+
+void
+ttchess_batch_list_moves(const ttchess_batch_t* batch, uint16_t* moves, int* num_moves) {
+	for (int game = 0; game < batch->count; ++game) {
+		num_moves[game] = ttchess_batch_gen_moves(
+			batch, game,
+			moves + (size_t)game * TTCHESS_MAX_MOVES, TTCHESS_MAX_MOVES
+		);
+	}
+}
+
+void
+ttchess_batch_apply_moves(ttchess_batch_t* batch, const uint16_t* moves, const bool* active) {
+	for (int game = 0; game < batch->count; ++game) {
+		if (active != NULL && !active[game]) { continue; }
+		if (batch->action[game] == TTCHESS_ACTION_WON) { continue; }
+
+		ttchess_batch_apply_core(batch, game, ttchess_move_unpack(moves[game]));
+	}
+}
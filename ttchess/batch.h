@@ -0,0 +1,61 @@
+#ifndef TTCHESS_BATCH_H
+#define TTCHESS_BATCH_H
+
+#include "ttchess.h"
+
+// Many games with the same config stored one column per field so that stepping
+// them all in lockstep only touches what the rules need.
+//
+// Pawns and statues use the byte layout of ttchess_state_pack.
+// Boards are kept as bitboards only and hashes are not kept at all,
+// ttchess_batch_get rebuilds both.
+typedef struct {
+	ttchess_config_t config;
+	int count;
+	int capacity;
+
+	// Base states, indexed by game
+	uint8_t* action;
+	uint8_t* color;
+	int8_t* last_pawn;
+	uint8_t* focuses[TTCHESS_NUM_PLAYERS];
+	uint8_t* pawns[TTCHESS_NUM_PAWNS];
+	uint8_t* statues[TTCHESS_NUM_STATUES][TTCHESS_NUM_ERAS];
+
+	// Derived states
+	ttchess_bitboard_t* boards[TTCHESS_NUM_ERAS][TTCHESS_NUM_PLAYERS];
+	ttchess_bitboard_t* statue_boards[TTCHESS_NUM_ERAS];
+
+	void* memory;
+} ttchess_batch_t;
+
+bool
+ttchess_batch_init(ttchess_batch_t* batch, ttchess_config_t config, int capacity);
+
+void
+ttchess_batch_cleanup(ttchess_batch_t* batch);
+
+// Returns the index of the new game or -1 when the batch is full or the config
+// of `state` differs
+int
+ttchess_batch_add(ttchess_batch_t* batch, const ttchess_state_t* state);
+
+void
+ttchess_batch_set(ttchess_batch_t* batch, int index, const ttchess_state_t* state);
+
+void
+ttchess_batch_get(const ttchess_batch_t* batch, int index, ttchess_state_t* state);
+
+// Same as ttchess_list_moves on every game, in the same order.
+// Moves are packed with ttchess_move_pack to keep the output small and the
+// moves of game `i` are written to `moves + i * TTCHESS_MAX_MOVES`.
+void
+ttchess_batch_list_moves(const ttchess_batch_t* batch, uint16_t* moves, int* num_moves);
+
+// Same as ttchess_apply_move with the packed `moves[i]` on game `i`, except
+// that moves are not validated: they must come from ttchess_batch_list_moves.
+// Games with `active[i]` false are left alone, a NULL `active` means every game.
+void
+ttchess_batch_apply_moves(ttchess_batch_t* batch, const uint16_t* moves, const bool* active);
+
+#endif
@@ -0,0 +1,116 @@
+#include "book.h"
+#include <string.h>
+
+#define TTCHESS_BOOK_MAGIC "TTOB"
+// Keeps the two configs apart since `state->hash` does not include them
+#define TTCHESS_BOOK_STATUES_SALT 0x6a09e667f3bcc909ull
+
+static inline uint64_t
+ttchess_book_read_u64(const uint8_t* in) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i) {
+		value |= (uint64_t)in[i] << (i * 8);
+	}
+	return value;
+}
+
+static inline void
+ttchess_book_write_u64(uint8_t* out, uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		out[i] = (uint8_t)((value >> (i * 8)) & 0xff);
+	}
+}
+
+uint64_t
+ttchess_book_key(const ttchess_state_t* state) {
+	return state->hash ^ (state->config.with_statues ? TTCHESS_BOOK_STATUES_SALT : 0);
+}
+
+size_t
+ttchess_book_encoded_size(uint32_t num_entries) {
+	return TTCHESS_BOOK_HEADER_SIZE + TTCHESS_BOOK_ENTRY_SIZE * (size_t)num_entries;
+}
+
+void
+ttchess_book_encode(const ttchess_book_entry_t* entries, uint32_t num_entries, uint8_t* out) {
+	memcpy(out, TTCHESS_BOOK_MAGIC, 4);
+	out[4] = TTCHESS_BOOK_VERSION;
+	out[5] = out[6] = out[7] = 0;
+	for (int i = 0; i < 4; ++i) {
+		out[8 + i] = (uint8_t)((num_entries >> (i * 8)) & 0xff);
+	}
+	out += TTCHESS_BOOK_HEADER_SIZE;
+
+	for (uint32_t i = 0; i < num_entries; ++i) {
+		const ttchess_book_entry_t* entry = &entries[i];
+		uint16_t move = ttchess_move_pack(entry->move);
+		uint16_t score = (uint16_t)(int16_t)entry->score;
+
+		ttchess_book_write_u64(out, entry->key);
+		out[8] = (uint8_t)(move & 0xff);
+		out[9] = (uint8_t)(move >> 8);
+		out[10] = (uint8_t)(score & 0xff);
+		out[11] = (uint8_t)(score >> 8);
+		out += TTCHESS_BOOK_ENTRY_SIZE;
+	}
+}
+
+bool
+ttchess_book_open(ttchess_book_t* book, const void* data, size_t size) {
+	const uint8_t* in = data;
+	if (
+		size < TTCHESS_BOOK_HEADER_SIZE
+		|| memcmp(in, TTCHESS_BOOK_MAGIC, 4) != 0
+		|| in[4] != TTCHESS_BOOK_VERSION
+	) {
+		return false;
+	}
+
+	uint32_t num_entries = (uint32_t)in[8]
+		| ((uint32_t)in[9] << 8)
+		| ((uint32_t)in[10] << 16)
+		| ((uint32_t)in[11] << 24);
+	if (size != ttchess_book_encoded_size(num_entries)) { return false; }
+
+	*book = (ttchess_book_t){
+		.num_entries = num_entries,
+		.entries = in + TTCHESS_BOOK_HEADER_SIZE,
+	};
+	return true;
+}
+
+bool
+ttchess_book_lookup(const ttchess_book_t* book, const ttchess_state_t* state, ttchess_book_entry_t* entry) {
+	uint64_t key = ttchess_book_key(state);
+
+	uint32_t low = 0;
+	uint32_t high = book->num_entries;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (ttchess_book_read_u64(book->entries + (size_t)mid * TTCHESS_BOOK_ENTRY_SIZE) < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (low == book->num_entries) { return false; }
+
+	const uint8_t* in = book->entries + (size_t)low * TTCHESS_BOOK_ENTRY_SIZE;
+	if (ttchess_book_read_u64(in) != key) { return false; }
+
+	ttchess_move_t move = ttchess_move_unpack((uint16_t)(in[8] | (in[9] << 8)));
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	bool is_legal = false;
+	for (int i = 0; i < num_moves && !is_legal; ++i) {
+		is_legal = ttchess_move_equal(moves[i], move);
+	}
+	if (!is_legal) { return false; }
+
+	*entry = (ttchess_book_entry_t){
+		.key = key,
+		.move = move,
+		.score = (int16_t)(uint16_t)(in[10] | (in[11] << 8)),
+	};
+	return true;
+}
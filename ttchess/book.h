@@ -0,0 +1,58 @@
+#ifndef TTCHESS_BOOK_H
+#define TTCHESS_BOOK_H
+
+#include "ttchess.h"
+#include <stddef.h>
+
+#define TTCHESS_BOOK_VERSION 1
+#define TTCHESS_BOOK_HEADER_SIZE 12
+#define TTCHESS_BOOK_ENTRY_SIZE 12
+
+// Best moves for early positions, sorted by ttchess_book_key.
+//
+// Encoded as:
+//
+// - 4 bytes: "TTOB"
+// - u8: TTCHESS_BOOK_VERSION
+// - 3 bytes: unused, 0
+// - u32: number of entries
+// - Per entry, in increasing key order:
+//   - u64: ttchess_book_key
+//   - u16: ttchess_move_pack
+//   - i16: score for the player to move
+//
+// All integers are little endian.
+// The file is meant to be memory mapped and searched in place.
+typedef struct {
+	uint32_t num_entries;
+	const uint8_t* entries;
+} ttchess_book_t;
+
+typedef struct {
+	uint64_t key;
+	ttchess_move_t move;
+	int score;
+} ttchess_book_entry_t;
+
+// Unlike `state->hash`, this also covers the config
+uint64_t
+ttchess_book_key(const ttchess_state_t* state);
+
+size_t
+ttchess_book_encoded_size(uint32_t num_entries);
+
+// `entries` must be sorted by key without duplicates
+void
+ttchess_book_encode(const ttchess_book_entry_t* entries, uint32_t num_entries, uint8_t* out);
+
+// Validates the header, `data` must outlive `book`
+bool
+ttchess_book_open(ttchess_book_t* book, const void* data, size_t size);
+
+// Binary search for the position.
+// Returns false when it is not in the book or the stored move is not legal,
+// which can only happen on a key collision.
+bool
+ttchess_book_lookup(const ttchess_book_t* book, const ttchess_state_t* state, ttchess_book_entry_t* entry);
+
+#endif
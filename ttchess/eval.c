@@ -0,0 +1,194 @@
+#include "eval.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+const char* const ttchess_feature_names[TTCHESS_NUM_FEATURES] = {
+	[TTCHESS_FEATURE_MATERIAL_PAST] = "material_past",
+	[TTCHESS_FEATURE_MATERIAL_PRESENT] = "material_present",
+	[TTCHESS_FEATURE_MATERIAL_FUTURE] = "material_future",
+	[TTCHESS_FEATURE_DOMINANCE] = "dominance",
+	[TTCHESS_FEATURE_THREAT] = "threat",
+	[TTCHESS_FEATURE_RESERVE] = "reserve",
+	[TTCHESS_FEATURE_STATUE] = "statue",
+	[TTCHESS_FEATURE_FOCUS] = "focus",
+};
+
+void
+ttchess_eval_default_weights(ttchess_eval_weights_t* weights) {
+	*weights = (ttchess_eval_weights_t){
+		.weights = {
+			[TTCHESS_FEATURE_MATERIAL_PAST] = 100.f,
+			[TTCHESS_FEATURE_MATERIAL_PRESENT] = 100.f,
+			[TTCHESS_FEATURE_MATERIAL_FUTURE] = 100.f,
+			[TTCHESS_FEATURE_DOMINANCE] = 150.f,
+			[TTCHESS_FEATURE_THREAT] = 40.f,
+			[TTCHESS_FEATURE_RESERVE] = 20.f,
+			[TTCHESS_FEATURE_STATUE] = 30.f,
+			[TTCHESS_FEATURE_FOCUS] = 10.f,
+		},
+	};
+}
+
+bool
+ttchess_eval_load_weights(ttchess_eval_weights_t* weights, const char* path) {
+	FILE* file = fopen(path, "r");
+	if (file == NULL) { return false; }
+
+	ttchess_eval_weights_t loaded;
+	ttchess_eval_default_weights(&loaded);
+
+	bool ok = true;
+	char line[256];
+	while (ok && fgets(line, sizeof(line), file) != NULL) {
+		char name[64];
+		float weight;
+		if (line[0] == '#' || sscanf(line, "%63s", name) != 1) { continue; }
+
+		ok = sscanf(line, "%63s %f", name, &weight) == 2;
+		bool found = false;
+		for (int i = 0; ok && i < TTCHESS_NUM_FEATURES && !found; ++i) {
+			if (strcmp(name, ttchess_feature_names[i]) == 0) {
+				loaded.weights[i] = weight;
+				found = true;
+			}
+		}
+		ok = ok && found;
+	}
+	fclose(file);
+
+	if (ok) { *weights = loaded; }
+	return ok;
+}
+
+bool
+ttchess_eval_save_weights(const ttchess_eval_weights_t* weights, const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) { return false; }
+
+	bool ok = true;
+	for (int i = 0; i < TTCHESS_NUM_FEATURES; ++i) {
+		ok &= fprintf(file, "%s %.6g\n", ttchess_feature_names[i], weights->weights[i]) > 0;
+	}
+
+	return (fclose(file) == 0) && ok;
+}
+
+void
+ttchess_extract_features(const ttchess_state_t* state, float features[TTCHESS_NUM_FEATURES]) {
+	ttchess_color_t color = state->phase.color;
+	ttchess_color_t opposing_color = color == TTCHESS_COLOR_WHITE
+		? TTCHESS_COLOR_BLACK
+		: TTCHESS_COLOR_WHITE;
+
+	int dominance = 0;
+	int threat = 0;
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		const ttchess_board_t* board = &state->boards[era];
+		int num_pawns = board->num_pawns[color];
+		int num_opposing_pawns = board->num_pawns[opposing_color];
+
+		features[TTCHESS_FEATURE_MATERIAL_PAST + era] = (float)(num_pawns - num_opposing_pawns);
+		dominance += (num_opposing_pawns == 0) - (num_pawns == 0);
+		threat += (num_opposing_pawns == 1) - (num_pawns == 1);
+	}
+	features[TTCHESS_FEATURE_DOMINANCE] = (float)dominance;
+	features[TTCHESS_FEATURE_THREAT] = (float)threat;
+
+	int reserve = 0;
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		if (state->pawns[pawn_index].status == TTCHESS_PAWN_RESERVE) {
+			reserve += ttchess_pawn_color((int8_t)pawn_index) == color ? 1 : -1;
+		}
+	}
+	features[TTCHESS_FEATURE_RESERVE] = (float)reserve;
+
+	// Statues are numbered after the player who can build them
+	features[TTCHESS_FEATURE_STATUE] = state->config.with_statues
+		? (float)(state->statue_built[color] - state->statue_built[opposing_color])
+		: 0.f;
+
+	features[TTCHESS_FEATURE_FOCUS] = (float)(
+		state->boards[state->focuses[color]].num_pawns[color]
+		- state->boards[state->focuses[opposing_color]].num_pawns[opposing_color]
+	);
+}
+
+// lroundf is undefined when the result does not fit a long.
+// Written so that NaN also ends up on a bound.
+static inline int
+ttchess_eval_round(float score) {
+	if (!(score > (float)-TTCHESS_EVAL_MAX_SCORE)) { return -TTCHESS_EVAL_MAX_SCORE; }
+	if (!(score < (float)TTCHESS_EVAL_MAX_SCORE)) { return TTCHESS_EVAL_MAX_SCORE; }
+	return (int)lroundf(score);
+}
+
+int
+ttchess_evaluate(const ttchess_state_t* state, const ttchess_eval_weights_t* weights) {
+	float features[TTCHESS_NUM_FEATURES];
+	ttchess_extract_features(state, features);
+
+	// Same summation order as ttchess_evaluate_features so both agree exactly
+	float score = 0.f;
+	for (int i = 0; i < TTCHESS_NUM_FEATURES; ++i) {
+		score += weights->weights[i] * features[i];
+	}
+
+	return ttchess_eval_round(score);
+}
+
+void
+ttchess_evaluate_features(
+	const ttchess_eval_weights_t* weights,
+	const float* const features[TTCHESS_NUM_FEATURES],
+	int count,
+	float* scores
+) {
+	for (int i = 0; i < count; ++i) {
+		scores[i] = 0.f;
+	}
+
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		const float* restrict values = features[feature];
+		float* restrict out = scores;
+		float weight = weights->weights[feature];
+		for (int i = 0; i < count; ++i) {
+			out[i] += weight * values[i];
+		}
+	}
+}
+
+void
+ttchess_evaluate_batch(
+	const ttchess_eval_weights_t* weights,
+	const ttchess_state_t* states,
+	int count,
+	int* scores
+) {
+	float block[TTCHESS_NUM_FEATURES][TTCHESS_EVAL_BLOCK_SIZE];
+	const float* columns[TTCHESS_NUM_FEATURES];
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		columns[feature] = block[feature];
+	}
+
+	for (int start = 0; start < count; start += TTCHESS_EVAL_BLOCK_SIZE) {
+		int block_size = count - start < TTCHESS_EVAL_BLOCK_SIZE
+			? count - start
+			: TTCHESS_EVAL_BLOCK_SIZE;
+
+		// Transpose into one column per feature
+		for (int i = 0; i < block_size; ++i) {
+			float features[TTCHESS_NUM_FEATURES];
+			ttchess_extract_features(&states[start + i], features);
+			for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+				block[feature][i] = features[feature];
+			}
+		}
+
+		float block_scores[TTCHESS_EVAL_BLOCK_SIZE];
+		ttchess_evaluate_features(weights, columns, block_size, block_scores);
+		for (int i = 0; i < block_size; ++i) {
+			scores[start + i] = ttchess_eval_round(block_scores[i]);
+		}
+	}
+}
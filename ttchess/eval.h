@@ -0,0 +1,76 @@
+#ifndef TTCHESS_EVAL_H
+#define TTCHESS_EVAL_H
+
+#include "ttchess.h"
+
+// States are scored in blocks of this many by ttchess_evaluate_batch
+#define TTCHESS_EVAL_BLOCK_SIZE 64
+// Scores are clamped to this so that they stay below the win scores of the
+// search, whatever the weights
+#define TTCHESS_EVAL_MAX_SCORE 20000
+
+// Every feature is "player to move" minus "opponent"
+typedef enum {
+	// Pawns on each board
+	TTCHESS_FEATURE_MATERIAL_PAST,
+	TTCHESS_FEATURE_MATERIAL_PRESENT,
+	TTCHESS_FEATURE_MATERIAL_FUTURE,
+	// Eras without any opposing pawn, two of them win the game
+	TTCHESS_FEATURE_DOMINANCE,
+	// Eras with a single opposing pawn left
+	TTCHESS_FEATURE_THREAT,
+	TTCHESS_FEATURE_RESERVE,
+	TTCHESS_FEATURE_STATUE,
+	// Pawns on the focused board, those are the ones that can move
+	TTCHESS_FEATURE_FOCUS,
+
+	TTCHESS_NUM_FEATURES,
+} ttchess_feature_t;
+
+typedef struct {
+	float weights[TTCHESS_NUM_FEATURES];
+} ttchess_eval_weights_t;
+
+extern const char* const ttchess_feature_names[TTCHESS_NUM_FEATURES];
+
+void
+ttchess_eval_default_weights(ttchess_eval_weights_t* weights);
+
+// The file has one "<feature name> <weight>" pair per line, features that are
+// not listed keep their default weight and lines starting with '#' are
+// ignored.
+bool
+ttchess_eval_load_weights(ttchess_eval_weights_t* weights, const char* path);
+
+bool
+ttchess_eval_save_weights(const ttchess_eval_weights_t* weights, const char* path);
+
+void
+ttchess_extract_features(const ttchess_state_t* state, float features[TTCHESS_NUM_FEATURES]);
+
+// From the point of view of the player to move
+int
+ttchess_evaluate(const ttchess_state_t* state, const ttchess_eval_weights_t* weights);
+
+// Scores `count` positions given as one array per feature:
+// `features[f][i]` is feature `f` of position `i`.
+// The loop runs over positions so the compiler can vectorize it.
+void
+ttchess_evaluate_features(
+	const ttchess_eval_weights_t* weights,
+	const float* const features[TTCHESS_NUM_FEATURES],
+	int count,
+	float* scores
+);
+
+// Same as calling ttchess_evaluate on every state, but features are packed
+// into blocks and scored with ttchess_evaluate_features
+void
+ttchess_evaluate_batch(
+	const ttchess_eval_weights_t* weights,
+	const ttchess_state_t* states,
+	int count,
+	int* scores
+);
+
+#endif
@@ -2,6 +2,7 @@
 #include <bgame/scene.h>
 #include <bgame/log.h>
 #include <bgame/allocator/tracked.h>
+#include <bgame/asset/archive.h>
 #include <cute_app.h>
 #include <cute_file_system.h>
 #include <cute_graphics.h>
@@ -25,6 +26,13 @@ init(int argc, const char** argv) {
 			log_warn("Could not mount %s: %s", ".", result.details);
 		}
 
+#if !BGAME_RELOADABLE
+		// Built by ttchess-assets, sprites found in it skip the assets dir
+		if (!bgame_archive_mount("./assets.bgpak")) {
+			log_warn("Could not mount %s", "./assets.bgpak");
+		}
+#endif
+
 		cf_app_set_icon("/assets/icon.png");
 		cf_app_init_imgui();
 
@@ -0,0 +1,330 @@
+#include "mcts.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <threads.h>
+#include <time.h>
+
+// Deeper nodes are not expanded and longer playouts are draws
+#define TTCHESS_MCTS_MAX_DEPTH 256
+#define TTCHESS_MCTS_MAX_PLAYOUT_LENGTH 512
+// Candidate moves considered at every playout step
+#define TTCHESS_MCTS_PLAYOUT_SAMPLES 4
+// How often the clock is read
+#define TTCHESS_MCTS_CHECK_INTERVAL 64
+#define TTCHESS_MCTS_DRAW -1
+
+typedef struct {
+	// 0 until expanded, the root can never be a child
+	uint32_t first_child;
+	uint16_t num_children;
+	uint16_t move;
+	uint32_t num_visits;
+	// From the point of view of the player who made `move`
+	float reward;
+} ttchess_mcts_node_t;
+
+typedef struct {
+	const ttchess_state_t* root_state;
+	float exploration;
+	double deadline;
+	uint64_t max_playouts;
+	uint64_t rng;
+
+	ttchess_mcts_node_t* nodes;
+	uint32_t num_nodes;
+	uint32_t max_nodes;
+	uint64_t num_playouts;
+} ttchess_mcts_tree_t;
+
+static inline double
+ttchess_mcts_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline uint32_t
+ttchess_mcts_random(ttchess_mcts_tree_t* tree, uint32_t bound) {
+	// xorshift64*
+	tree->rng ^= tree->rng >> 12;
+	tree->rng ^= tree->rng << 25;
+	tree->rng ^= tree->rng >> 27;
+	uint64_t value = tree->rng * 0x2545f4914f6cdd1dull;
+	return (uint32_t)(((value >> 32) * bound) >> 32);
+}
+
+// Takes all children of a node in one contiguous block
+static bool
+ttchess_mcts_expand(ttchess_mcts_tree_t* tree, uint32_t node_index, const ttchess_state_t* state) {
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	if (num_moves == 0 || tree->num_nodes + (uint32_t)num_moves > tree->max_nodes) {
+		return false;
+	}
+
+	ttchess_mcts_node_t* node = &tree->nodes[node_index];
+	node->first_child = tree->num_nodes;
+	node->num_children = (uint16_t)num_moves;
+	for (int i = 0; i < num_moves; ++i) {
+		tree->nodes[tree->num_nodes++] = (ttchess_mcts_node_t){
+			.move = ttchess_move_pack(moves[i]),
+		};
+	}
+
+	return true;
+}
+
+static uint32_t
+ttchess_mcts_select(ttchess_mcts_tree_t* tree, const ttchess_mcts_node_t* node) {
+	float log_visits = logf((float)node->num_visits);
+	uint32_t best_child = node->first_child;
+	float best_score = -1.f;
+	for (uint32_t i = 0; i < node->num_children; ++i) {
+		uint32_t child_index = node->first_child + i;
+		const ttchess_mcts_node_t* child = &tree->nodes[child_index];
+		// Unvisited children are tried first
+		if (child->num_visits == 0) { return child_index; }
+
+		float visits = (float)child->num_visits;
+		float score = child->reward / visits + tree->exploration * sqrtf(log_visits / visits);
+		if (score > best_score) {
+			best_score = score;
+			best_child = child_index;
+		}
+	}
+
+	return best_child;
+}
+
+static inline int
+ttchess_mcts_num_dead_pawns(const ttchess_state_t* state, ttchess_color_t color) {
+	int first_pawn = color == TTCHESS_COLOR_WHITE ? TTCHESS_FIRST_WHITE_PAWN : TTCHESS_FIRST_BLACK_PAWN;
+	int num_dead_pawns = 0;
+	for (int i = first_pawn; i < first_pawn + TTCHESS_NUM_PAWNS / 2; ++i) {
+		num_dead_pawns += state->pawns[i].status == TTCHESS_PAWN_DEAD;
+	}
+
+	return num_dead_pawns;
+}
+
+// Samples a few random moves and plays the one that trades pawns best.
+// Purely random games rarely end: most of them go past
+// TTCHESS_MCTS_MAX_PLAYOUT_LENGTH and tell nothing.
+// Returns the winning color or TTCHESS_MCTS_DRAW.
+static int
+ttchess_mcts_playout(ttchess_mcts_tree_t* tree, ttchess_state_t* state) {
+	for (int i = 0; i < TTCHESS_MCTS_MAX_PLAYOUT_LENGTH; ++i) {
+		if (state->phase.action == TTCHESS_ACTION_WON) {
+			return (int)state->phase.color;
+		}
+
+		ttchess_move_t moves[TTCHESS_MAX_MOVES];
+		int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+		if (num_moves == 0) { return TTCHESS_MCTS_DRAW; }
+
+		ttchess_color_t color = state->phase.color;
+		ttchess_color_t opposing_color = color == TTCHESS_COLOR_WHITE
+			? TTCHESS_COLOR_BLACK
+			: TTCHESS_COLOR_WHITE;
+		int num_dead_pawns = ttchess_mcts_num_dead_pawns(state, color);
+		int num_dead_opposing_pawns = ttchess_mcts_num_dead_pawns(state, opposing_color);
+
+		ttchess_state_t best_state;
+		int best_score = INT_MIN;
+		for (int j = 0; j < TTCHESS_MCTS_PLAYOUT_SAMPLES; ++j) {
+			ttchess_state_t next_state = *state;
+			ttchess_apply_move(&next_state, moves[ttchess_mcts_random(tree, (uint32_t)num_moves)]);
+
+			int score = next_state.phase.action == TTCHESS_ACTION_WON
+				? INT_MAX
+				: (ttchess_mcts_num_dead_pawns(&next_state, opposing_color) - num_dead_opposing_pawns)
+				- (ttchess_mcts_num_dead_pawns(&next_state, color) - num_dead_pawns);
+			if (score > best_score) {
+				best_score = score;
+				best_state = next_state;
+			}
+		}
+
+		*state = best_state;
+	}
+
+	return state->phase.action == TTCHESS_ACTION_WON
+		? (int)state->phase.color
+		: TTCHESS_MCTS_DRAW;
+}
+
+static void
+ttchess_mcts_iterate(ttchess_mcts_tree_t* tree) {
+	uint32_t path[TTCHESS_MCTS_MAX_DEPTH + 1];
+	// Color of the player who made the move into path[i + 1]
+	int8_t movers[TTCHESS_MCTS_MAX_DEPTH];
+	int depth = 0;
+
+	ttchess_state_t state = *tree->root_state;
+	uint32_t node_index = 0;
+	path[0] = node_index;
+
+	// Selection
+	while (tree->nodes[node_index].first_child != 0 && depth < TTCHESS_MCTS_MAX_DEPTH) {
+		node_index = ttchess_mcts_select(tree, &tree->nodes[node_index]);
+		movers[depth] = (int8_t)state.phase.color;
+		ttchess_apply_move(&state, ttchess_move_unpack(tree->nodes[node_index].move));
+		path[++depth] = node_index;
+	}
+
+	// Expansion, a leaf is only worth expanding on its second visit
+	if (
+		depth < TTCHESS_MCTS_MAX_DEPTH
+		&& state.phase.action != TTCHESS_ACTION_WON
+		&& (node_index == 0 || tree->nodes[node_index].num_visits > 0)
+		&& ttchess_mcts_expand(tree, node_index, &state)
+	) {
+		const ttchess_mcts_node_t* node = &tree->nodes[node_index];
+		node_index = node->first_child + ttchess_mcts_random(tree, node->num_children);
+		movers[depth] = (int8_t)state.phase.color;
+		ttchess_apply_move(&state, ttchess_move_unpack(tree->nodes[node_index].move));
+		path[++depth] = node_index;
+	}
+
+	// Simulation
+	int winner = ttchess_mcts_playout(tree, &state);
+	++tree->num_playouts;
+
+	// Backpropagation
+	++tree->nodes[path[0]].num_visits;
+	for (int i = 1; i <= depth; ++i) {
+		ttchess_mcts_node_t* node = &tree->nodes[path[i]];
+		++node->num_visits;
+		if (winner == TTCHESS_MCTS_DRAW) {
+			node->reward += 0.5f;
+		} else if (winner == movers[i - 1]) {
+			node->reward += 1.f;
+		}
+	}
+}
+
+static int
+ttchess_mcts_grow(void* userdata) {
+	ttchess_mcts_tree_t* tree = userdata;
+	tree->nodes[0] = (ttchess_mcts_node_t){ 0 };
+	tree->num_nodes = 1;
+	// The root is always expanded so every tree has the same root children
+	ttchess_mcts_expand(tree, 0, tree->root_state);
+
+	while (
+		(tree->max_playouts == 0 || tree->num_playouts < tree->max_playouts)
+		&& (
+			tree->deadline <= 0.0
+			|| (tree->num_playouts % TTCHESS_MCTS_CHECK_INTERVAL) != 0
+			|| ttchess_mcts_now() < tree->deadline
+		)
+	) {
+		ttchess_mcts_iterate(tree);
+	}
+
+	return 0;
+}
+
+bool
+ttchess_mcts_search(
+	const ttchess_state_t* state,
+	ttchess_mcts_config_t config,
+	ttchess_mcts_result_t* result
+) {
+	*result = (ttchess_mcts_result_t){ 0 };
+
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	if (num_moves == 0 || (config.time_limit <= 0.0 && config.max_playouts == 0)) {
+		return false;
+	}
+
+	int num_threads = config.num_threads > 0 ? config.num_threads : 1;
+	uint32_t max_nodes = config.max_nodes > (uint32_t)num_moves
+		? config.max_nodes
+		: TTCHESS_MCTS_DEFAULT_MAX_NODES;
+	float exploration = config.exploration > 0.f ? config.exploration : 1.41421356f;
+
+	ttchess_mcts_tree_t* trees = calloc((size_t)num_threads, sizeof(ttchess_mcts_tree_t));
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (trees == NULL || threads == NULL) {
+		free(trees);
+		free(threads);
+		return false;
+	}
+
+	double start = ttchess_mcts_now();
+	int num_trees = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		ttchess_mcts_node_t* nodes = malloc(sizeof(ttchess_mcts_node_t) * max_nodes);
+		if (nodes == NULL) { break; }
+
+		uint64_t max_playouts = 0;
+		if (config.max_playouts > 0) {
+			max_playouts = config.max_playouts / (uint64_t)num_threads
+				+ ((uint64_t)i < config.max_playouts % (uint64_t)num_threads ? 1 : 0);
+			if (max_playouts == 0) { max_playouts = 1; }
+		}
+
+		trees[i] = (ttchess_mcts_tree_t){
+			.root_state = state,
+			.exploration = exploration,
+			.deadline = config.time_limit > 0.0 ? start + config.time_limit : 0.0,
+			.max_playouts = max_playouts,
+			// xorshift must not start at 0
+			.rng = (config.seed + (uint64_t)(i + 1)) * 0x9e3779b97f4a7c15ull | 1,
+			.nodes = nodes,
+			.max_nodes = max_nodes,
+		};
+		++num_trees;
+	}
+
+	// The calling thread grows the first tree
+	int num_started = num_trees > 0 ? 1 : 0;
+	for (int i = 1; i < num_trees; ++i) {
+		if (thrd_create(&threads[i], ttchess_mcts_grow, &trees[i]) != thrd_success) { break; }
+		++num_started;
+	}
+	if (num_started > 0) { ttchess_mcts_grow(&trees[0]); }
+	for (int i = 1; i < num_started; ++i) {
+		thrd_join(threads[i], NULL);
+	}
+
+	// All trees expand the root from the same move list so children line up
+	for (int i = 0; i < num_moves; ++i) {
+		uint64_t num_visits = 0;
+		double reward = 0.0;
+		for (int j = 0; j < num_started; ++j) {
+			const ttchess_mcts_node_t* root = &trees[j].nodes[0];
+			if (root->first_child == 0) { continue; }
+
+			const ttchess_mcts_node_t* child = &trees[j].nodes[root->first_child + i];
+			num_visits += child->num_visits;
+			reward += child->reward;
+		}
+
+		if (i == 0 || num_visits > result->num_visits) {
+			result->best_move = moves[i];
+			result->num_visits = num_visits;
+			result->win_rate = num_visits > 0 ? (float)(reward / (double)num_visits) : 0.f;
+		}
+	}
+
+	for (int i = 0; i < num_started; ++i) {
+		result->num_playouts += trees[i].num_playouts;
+		result->num_nodes += trees[i].num_nodes;
+	}
+	result->time = ttchess_mcts_now() - start;
+	result->playouts_per_second = result->time > 0.0
+		? (double)result->num_playouts / result->time
+		: 0.0;
+
+	for (int i = 0; i < num_trees; ++i) {
+		free(trees[i].nodes);
+	}
+	free(threads);
+	free(trees);
+
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TTCHESS_MCTS_H
+#define TTCHESS_MCTS_H
+
+#include "ttchess.h"
+
+#define TTCHESS_MCTS_DEFAULT_MAX_NODES (1u << 20)
+
+typedef struct {
+	// Each thread grows its own tree, the root statistics are merged at the
+	// end. 0 means 1.
+	int num_threads;
+	// In seconds, 0 means no limit
+	double time_limit;
+	// Across all threads, 0 means no limit.
+	// At least one limit must be set.
+	uint64_t max_playouts;
+	// Per tree, 0 means TTCHESS_MCTS_DEFAULT_MAX_NODES.
+	// Once the pool is full, leaves are no longer expanded.
+	uint32_t max_nodes;
+	// UCT exploration constant, 0 means sqrt(2)
+	float exploration;
+	uint64_t seed;
+} ttchess_mcts_config_t;
+
+typedef struct {
+	ttchess_move_t best_move;
+	// Of the best move, from the point of view of the player to move.
+	// Draws count as half a win.
+	float win_rate;
+	uint64_t num_visits;
+
+	uint64_t num_playouts;
+	uint64_t num_nodes;
+	double time;
+	double playouts_per_second;
+} ttchess_mcts_result_t;
+
+// Returns false when there is no legal move or no limit is set
+bool
+ttchess_mcts_search(
+	const ttchess_state_t* state,
+	ttchess_mcts_config_t config,
+	ttchess_mcts_result_t* result
+);
+
+#endif
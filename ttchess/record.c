@@ -0,0 +1,234 @@
+#include "record.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TTCHESS_RECORD_MAGIC "TTGR"
+#define TTCHESS_RECORD_HEADER_SIZE 12
+
+static inline void
+ttchess_record_write_u16(uint8_t* out, uint16_t value) {
+	out[0] = (uint8_t)(value & 0xff);
+	out[1] = (uint8_t)(value >> 8);
+}
+
+static inline void
+ttchess_record_write_u32(uint8_t* out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = (uint8_t)((value >> (i * 8)) & 0xff);
+	}
+}
+
+static inline uint16_t
+ttchess_record_read_u16(const uint8_t* in) {
+	return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static inline uint32_t
+ttchess_record_read_u32(const uint8_t* in) {
+	return (uint32_t)in[0]
+		| ((uint32_t)in[1] << 8)
+		| ((uint32_t)in[2] << 16)
+		| ((uint32_t)in[3] << 24);
+}
+
+static bool
+ttchess_record_reserve(void** items, int* capacity, int required, size_t item_size) {
+	if (required <= *capacity) { return true; }
+
+	int new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+	if (new_capacity < required) { new_capacity = required; }
+
+	void* new_items = realloc(*items, item_size * (size_t)new_capacity);
+	if (new_items == NULL) { return false; }
+
+	*items = new_items;
+	*capacity = new_capacity;
+	return true;
+}
+
+static bool
+ttchess_record_add_keyframe(ttchess_record_t* record, const ttchess_state_t* state) {
+	if (!ttchess_record_reserve(
+		(void**)&record->keyframes,
+		&record->keyframes_capacity,
+		record->num_keyframes + 1,
+		sizeof(record->keyframes[0])
+	)) {
+		return false;
+	}
+
+	ttchess_state_pack(state, record->keyframes[record->num_keyframes++]);
+	return true;
+}
+
+bool
+ttchess_record_init(ttchess_record_t* record, ttchess_config_t config, int keyframe_interval) {
+	// Encoded in a u16
+	if (keyframe_interval > UINT16_MAX) { return false; }
+
+	*record = (ttchess_record_t){
+		.config = config,
+		.keyframe_interval = keyframe_interval > 0
+			? keyframe_interval
+			: TTCHESS_RECORD_DEFAULT_KEYFRAME_INTERVAL,
+	};
+	ttchess_init(&record->head, config);
+	if (!ttchess_record_add_keyframe(record, &record->head)) {
+		ttchess_record_cleanup(record);
+		return false;
+	}
+
+	return true;
+}
+
+void
+ttchess_record_cleanup(ttchess_record_t* record) {
+	free(record->moves);
+	free(record->keyframes);
+	*record = (ttchess_record_t){ 0 };
+}
+
+bool
+ttchess_record_append(ttchess_record_t* record, ttchess_move_t move) {
+	if (!ttchess_record_reserve(
+		(void**)&record->moves,
+		&record->moves_capacity,
+		record->num_moves + 1,
+		sizeof(record->moves[0])
+	)) {
+		return false;
+	}
+
+	ttchess_state_t next_state = record->head;
+	if (!ttchess_apply_move(&next_state, move)) { return false; }
+
+	// Keyframes must stay in step with the moves or seeking would land on
+	// the wrong state
+	int num_moves = record->num_moves + 1;
+	bool needs_keyframe = num_moves % record->keyframe_interval == 0
+		&& num_moves / record->keyframe_interval == record->num_keyframes;
+	if (needs_keyframe && !ttchess_record_add_keyframe(record, &next_state)) {
+		return false;
+	}
+
+	record->moves[record->num_moves] = ttchess_move_pack(move);
+	record->num_moves = num_moves;
+	record->head = next_state;
+	return true;
+}
+
+static bool
+ttchess_record_restore(const ttchess_record_t* record, int move_index, ttchess_state_t* state) {
+	int keyframe_index = move_index / record->keyframe_interval;
+	if (keyframe_index >= record->num_keyframes) {
+		keyframe_index = record->num_keyframes - 1;
+	}
+
+	if (keyframe_index < 0) {
+		keyframe_index = 0;
+		ttchess_init(state, record->config);
+	} else if (!ttchess_state_unpack(state, record->keyframes[keyframe_index])) {
+		return false;
+	}
+
+	for (int i = keyframe_index * record->keyframe_interval; i < move_index; ++i) {
+		if (!ttchess_apply_move(state, ttchess_move_unpack(record->moves[i]))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+ttchess_record_seek(const ttchess_record_t* record, int move_index, ttchess_state_t* state) {
+	if (move_index < 0 || move_index > record->num_moves) { return false; }
+
+	if (move_index == record->num_moves) {
+		*state = record->head;
+		return true;
+	}
+
+	return ttchess_record_restore(record, move_index, state);
+}
+
+size_t
+ttchess_record_encoded_size(const ttchess_record_t* record) {
+	return TTCHESS_RECORD_HEADER_SIZE
+		+ sizeof(uint16_t) * (size_t)record->num_moves
+		+ TTCHESS_PACKED_SIZE * (size_t)record->num_keyframes;
+}
+
+void
+ttchess_record_encode(const ttchess_record_t* record, uint8_t* out) {
+	memcpy(out, TTCHESS_RECORD_MAGIC, 4);
+	out[4] = TTCHESS_RECORD_VERSION;
+	out[5] = record->config.with_statues ? 1 : 0;
+	ttchess_record_write_u16(out + 6, (uint16_t)record->keyframe_interval);
+	ttchess_record_write_u32(out + 8, (uint32_t)record->num_moves);
+	out += TTCHESS_RECORD_HEADER_SIZE;
+
+	for (int i = 0; i < record->num_moves; ++i) {
+		ttchess_record_write_u16(out, record->moves[i]);
+		out += sizeof(uint16_t);
+	}
+
+	memcpy(out, record->keyframes, TTCHESS_PACKED_SIZE * (size_t)record->num_keyframes);
+}
+
+bool
+ttchess_record_decode(ttchess_record_t* record, const uint8_t* data, size_t size) {
+	if (
+		size < TTCHESS_RECORD_HEADER_SIZE
+		|| memcmp(data, TTCHESS_RECORD_MAGIC, 4) != 0
+		|| data[4] != TTCHESS_RECORD_VERSION
+		|| data[5] > 1
+	) {
+		return false;
+	}
+
+	ttchess_config_t config = { .with_statues = data[5] != 0 };
+	int keyframe_interval = ttchess_record_read_u16(data + 6);
+	uint32_t num_moves = ttchess_record_read_u32(data + 8);
+	if (keyframe_interval == 0 || num_moves > INT32_MAX / 2) { return false; }
+
+	int num_keyframes = (int)(num_moves / (uint32_t)keyframe_interval) + 1;
+	size_t moves_size = sizeof(uint16_t) * num_moves;
+	size_t keyframes_size = TTCHESS_PACKED_SIZE * (size_t)num_keyframes;
+	if (size != TTCHESS_RECORD_HEADER_SIZE + moves_size + keyframes_size) { return false; }
+
+	*record = (ttchess_record_t){
+		.config = config,
+		.keyframe_interval = keyframe_interval,
+		.num_moves = (int)num_moves,
+		.moves_capacity = (int)num_moves,
+		.moves = malloc(moves_size > 0 ? moves_size : 1),
+		.num_keyframes = num_keyframes,
+		.keyframes_capacity = num_keyframes,
+		.keyframes = malloc(keyframes_size),
+	};
+	if (record->moves == NULL || record->keyframes == NULL) {
+		ttchess_record_cleanup(record);
+		return false;
+	}
+
+	const uint8_t* in = data + TTCHESS_RECORD_HEADER_SIZE;
+	for (uint32_t i = 0; i < num_moves; ++i) {
+		record->moves[i] = ttchess_record_read_u16(in);
+		in += sizeof(uint16_t);
+	}
+	memcpy(record->keyframes, in, keyframes_size);
+
+	// Only the tail after the last keyframe is replayed
+	ttchess_state_t head;
+	if (
+		!ttchess_record_restore(record, (int)num_moves, &head)
+		|| head.config.with_statues != config.with_statues
+	) {
+		ttchess_record_cleanup(record);
+		return false;
+	}
+
+	record->head = head;
+	return true;
+}
@@ -0,0 +1,70 @@
+#ifndef TTCHESS_RECORD_H
+#define TTCHESS_RECORD_H
+
+#include "ttchess.h"
+#include <stddef.h>
+
+// A keyframe is stored every this many moves
+#define TTCHESS_RECORD_DEFAULT_KEYFRAME_INTERVAL 32
+#define TTCHESS_RECORD_VERSION 1
+
+// The moves of one game with periodic snapshots so any point of the game can
+// be restored without replaying it from the start.
+//
+// Encoded as:
+//
+// - 4 bytes: "TTGR"
+// - u8: TTCHESS_RECORD_VERSION
+// - u8: with_statues
+// - u16: keyframe interval
+// - u32: number of moves
+// - u16 per move: ttchess_move_pack
+// - ttchess_state_pack per keyframe, the first one is the initial state
+//
+// All integers are little endian.
+typedef struct {
+	ttchess_config_t config;
+	int keyframe_interval;
+
+	int num_moves;
+	int moves_capacity;
+	uint16_t* moves;
+
+	// Keyframe `i` is the state after `i * keyframe_interval` moves
+	int num_keyframes;
+	int keyframes_capacity;
+	uint8_t (*keyframes)[TTCHESS_PACKED_SIZE];
+
+	// After the last move, new moves are validated against it
+	ttchess_state_t head;
+} ttchess_record_t;
+
+// A keyframe interval of 0 means TTCHESS_RECORD_DEFAULT_KEYFRAME_INTERVAL.
+// Returns false when the interval does not fit the encoding or out of memory.
+bool
+ttchess_record_init(ttchess_record_t* record, ttchess_config_t config, int keyframe_interval);
+
+void
+ttchess_record_cleanup(ttchess_record_t* record);
+
+// Returns false when the move is illegal or out of memory
+bool
+ttchess_record_append(ttchess_record_t* record, ttchess_move_t move);
+
+// Restores the state after the first `move_index` moves from the nearest
+// keyframe before it
+bool
+ttchess_record_seek(const ttchess_record_t* record, int move_index, ttchess_state_t* state);
+
+size_t
+ttchess_record_encoded_size(const ttchess_record_t* record);
+
+void
+ttchess_record_encode(const ttchess_record_t* record, uint8_t* out);
+
+// `record` must not be initialized.
+// Moves are only checked when seeking over them.
+bool
+ttchess_record_decode(ttchess_record_t* record, const uint8_t* data, size_t size);
+
+#endif
@@ -25,7 +25,11 @@ static const float BOARD_Y_SCALE = 0.85f;
 static const CF_Color CELL_WHITE = { 1.f, 1.f, 1.f, 1.f };
 static const CF_Color CELL_BLACK = { 0.3f, 0.3f, 0.3f, 1.f };
 static const CF_Color SELECTION_GLOW = { 1.0f, 1.0f, 0.0f, 1.f };
+static const CF_Color MOVE_TARGET = { 0.2f, 0.8f, 0.2f, 1.f };
 static const float GLOW_THICKNESS = 3.f;
+// Keeps assets that the scene stops loading around for a hot reload that
+// brings them back
+static const size_t ASSET_CACHE_BUDGET = 16 * 1024 * 1024;
 
 typedef enum {
 	RENDER_LAYER_GLOW_PREPARE = 1,
@@ -36,6 +40,9 @@ typedef enum {
 } render_layer_t;
 
 static ttchess_state_t g_state;
+// Hover highlights query this every frame so the moves of a position are only
+// generated once
+static ttchess_move_cache_t g_move_cache;
 
 BGAME_VAR(bserial_mem_out_t, g_saved_state) = { 0 };
 
@@ -46,23 +53,20 @@ BGAME_VAR(CF_Shader, shd_glow) = { 0 };
 CF_Sprite* spr_white_pawn = NULL;
 CF_Sprite* spr_black_pawn = NULL;
 CF_Sprite* spr_statue = NULL;
+// Sprites are decoded in the background and only set up once they are all in
+static bool g_sprites_ready = false;
+static bool g_sprites_failed = false;
 
 static void
 init(int argc, const char** argv) {
-	bgame_asset_begin_load(&assets_game);
-
+	bgame_asset_begin_async_load(&assets_game);
+	bgame_asset_set_cache_budget(assets_game, ASSET_CACHE_BUDGET);
 	spr_white_pawn = bgame_load_sprite(assets_game, "/assets/white-pawn.aseprite");
-	spr_white_pawn->scale = (CF_V2) { 0.25f, 0.25f };
-	cf_sprite_set_loop(spr_white_pawn, true);
-
 	spr_black_pawn = bgame_load_sprite(assets_game, "/assets/black-pawn.aseprite");
-	spr_black_pawn->scale = (CF_V2) { 0.25f, 0.25f };
-	cf_sprite_set_loop(spr_black_pawn, true);
-
 	spr_statue = bgame_load_sprite(assets_game, "/assets/statue.aseprite");
-	spr_statue->scale = (CF_V2) { 1.5f, 1.5f };
-
 	bgame_asset_end_load(assets_game);
+	g_sprites_ready = false;
+	g_sprites_failed = false;
 
 	if (shd_glow.id != 0) {
 		cf_destroy_shader(shd_glow);
@@ -118,32 +122,95 @@ after_reload(void) {
 	g_saved_state.mem = NULL;
 }
 
-static void
-draw_board(const ttchess_state_t* state, ttchess_era_t era) {
-	const ttchess_board_t* board = &state->boards[era];
-	CF_V2 mouse_pos = cf_screen_to_world((CF_V2){
+static CF_Aabb
+cell_aabb(int x, int y) {
+	CF_V2 top_left = {
+		 (float)x * CELL_SIZE,
+		-(float)y * CELL_SIZE * BOARD_Y_SCALE,
+	};
+	CF_V2 bottom_left = {
+		top_left.x,
+		top_left.y - CELL_SIZE * BOARD_Y_SCALE,
+	};
+	CF_V2 top_right = {
+		top_left.x + CELL_SIZE,
+		top_left.y
+	};
+	return (CF_Aabb){
+		.min = bottom_left,
+		.max = top_right,
+	};
+}
+
+static CF_V2
+mouse_world_pos(void) {
+	return cf_screen_to_world((CF_V2){
 		.x = (float)cf_mouse_x(),
 		.y = (float)cf_mouse_y(),
 	});
+}
+
+// Must be called with the same transform as draw_board
+static int8_t
+find_hovered_pawn(const ttchess_state_t* state, ttchess_era_t era) {
+	const ttchess_board_t* board = &state->boards[era];
+	CF_V2 mouse_pos = mouse_world_pos();
+	for (int x = 0; x < TTCHESS_BOARD_WIDTH; ++x) {
+		for (int y = 0; y < TTCHESS_BOARD_HEIGHT; ++y) {
+			const ttchess_cell_t* cell = &board->cells[x][y];
+			if (
+				cell->piece_type == TTCHESS_PIECE_PAWN
+				&& cf_contains_point(cell_aabb(x, y), mouse_pos)
+			) {
+				return cell->piece_id;
+			}
+		}
+	}
+
+	return -1;
+}
+
+// Cells the pawn can reach in each era with any of its legal moves
+static void
+find_move_targets(
+	const ttchess_state_t* state,
+	int8_t pawn_id,
+	ttchess_era_t pawn_era,
+	ttchess_bitboard_t targets[TTCHESS_NUM_ERAS]
+) {
+	const ttchess_pawn_t* pawn = &state->pawns[pawn_id];
+	const ttchess_move_t* moves;
+	int num_moves = ttchess_move_cache_get(&g_move_cache, state, &moves);
+	for (int i = 0; i < num_moves; ++i) {
+		ttchess_move_t move = moves[i];
+		if (move.pawn_id != pawn_id) { continue; }
+
+		switch (move.type) {
+			case TTCHESS_MOVE_TIME_TRAVEL:
+				targets[move.era] |= ttchess_pos_bit(pawn->pos);
+				break;
+			case TTCHESS_MOVE_SHIFT_FOCUS:
+				break;
+			default:
+				targets[pawn_era] |= ttchess_pos_bit(move.pos);
+				break;
+		}
+	}
+}
+
+static void
+draw_board(const ttchess_state_t* state, ttchess_era_t era, ttchess_bitboard_t targets) {
+	const ttchess_board_t* board = &state->boards[era];
+	CF_V2 mouse_pos = mouse_world_pos();
 	for (int x = 0; x < TTCHESS_BOARD_WIDTH; ++x) {
 		for (int y = 0; y < TTCHESS_BOARD_HEIGHT; ++y) {
 			CF_V2 top_left = {
 				 (float)x * CELL_SIZE,
 				-(float)y * CELL_SIZE * BOARD_Y_SCALE,
 			};
-			CF_V2 bottom_left = {
-				top_left.x,
-				top_left.y - CELL_SIZE * BOARD_Y_SCALE,
-			};
-			CF_V2 top_right = {
-				top_left.x + CELL_SIZE,
-				top_left.y
-			};
-			CF_Aabb aabb = {
-				.min = bottom_left,
-				.max = top_right,
-			};
+			CF_Aabb aabb = cell_aabb(x, y);
 			bool hovered = cf_contains_point(aabb, mouse_pos);
+			bool is_target = (targets & ttchess_pos_bit((ttchess_pos_t){ .x = (int8_t)x, .y = (int8_t)y })) != 0;
 
 			BGAME_SCOPE(
 				cf_draw_push_layer(RENDER_LAYER_BOARD),
@@ -160,6 +227,15 @@ draw_board(const ttchess_state_t* state, ttchess_era_t era) {
 				) {
 					cf_draw_box_fill(aabb, 1.f);
 				}
+
+				if (is_target) {
+					BGAME_SCOPE(
+						cf_draw_push_color(MOVE_TARGET),
+						cf_draw_pop_color()
+					) {
+						cf_draw_box(aabb, GLOW_THICKNESS, 0.f);
+					}
+				}
 			}
 
 			const ttchess_cell_t* cell = &board->cells[x][y];
@@ -195,10 +271,48 @@ static void
 fixed_update(void* arg) {
 }
 
+// Finishing a load replaces the whole sprite so this has to wait for it
+static bool
+setup_sprites(void) {
+	if (bgame_asset_num_pending(assets_game) > 0) { return false; }
+
+	CF_Sprite* sprites[] = { spr_white_pawn, spr_black_pawn, spr_statue };
+	for (size_t i = 0; i < sizeof(sprites) / sizeof(sprites[0]); ++i) {
+		// Sprites with nothing in them can't be drawn, a hot reload of the
+		// file can still fix them
+		if (bgame_asset_status(assets_game, sprites[i]) != BGAME_ASSET_READY) {
+			if (!g_sprites_failed) {
+				log_error("Could not load the pieces");
+				g_sprites_failed = true;
+			}
+			return false;
+		}
+	}
+
+	spr_white_pawn->scale = (CF_V2) { 0.25f, 0.25f };
+	cf_sprite_set_loop(spr_white_pawn, true);
+
+	spr_black_pawn->scale = (CF_V2) { 0.25f, 0.25f };
+	cf_sprite_set_loop(spr_black_pawn, true);
+
+	spr_statue->scale = (CF_V2) { 1.5f, 1.5f };
+
+	return true;
+}
+
 static void
 update(void) {
 	bgame_asset_check_bundle(assets_game);
 
+	if (!g_sprites_ready) {
+		g_sprites_ready = setup_sprites();
+		if (!g_sprites_ready) {
+			cf_clear_color(0.5f, 0.5f, 0.5f, 1.f);
+			cf_app_draw_onto_screen(true);
+			return;
+		}
+	}
+
 	cf_sprite_update(spr_white_pawn);
 	cf_sprite_update(spr_black_pawn);
 
@@ -207,13 +321,29 @@ update(void) {
 	float board_size = CELL_SIZE * TTCHESS_BOARD_WIDTH;
 	float start_x = -board_size * 1.5f - BOARD_GAP;
 	float start_y = board_size * 0.5f;
+	ttchess_bitboard_t move_targets[TTCHESS_NUM_ERAS] = { 0 };
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		cf_draw_push();
+		cf_draw_translate(
+			start_x + (board_size + BOARD_GAP) * era,
+			start_y
+		);
+		int8_t hovered_pawn = find_hovered_pawn(&g_state, era);
+		cf_draw_pop();
+
+		if (hovered_pawn >= 0) {
+			find_move_targets(&g_state, hovered_pawn, era, move_targets);
+			break;
+		}
+	}
+
 	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
 		cf_draw_push();
 		cf_draw_translate(
 			start_x + (board_size + BOARD_GAP) * era,
 			start_y
 		);
-		draw_board(&g_state, era);
+		draw_board(&g_state, era, move_targets[era]);
 		cf_draw_pop();
 	}
 
@@ -0,0 +1,396 @@
+#include "search.h"
+#include <stdatomic.h>
+#include <time.h>
+
+#define TTCHESS_SEARCH_INF (TTCHESS_SEARCH_WIN + 1)
+// How often the clock is read
+#define TTCHESS_SEARCH_CHECK_INTERVAL 1024
+#define TTCHESS_SEARCH_NUM_KILLERS 2
+// (move type, pawn, target cell or era)
+#define TTCHESS_SEARCH_HISTORY_SIZE (5 * TTCHESS_NUM_PAWNS * TTCHESS_BOARD_WIDTH * TTCHESS_BOARD_HEIGHT)
+
+// Move ordering priorities, history scores stay below these
+#define TTCHESS_SEARCH_ORDER_TT 0x7fffffff
+#define TTCHESS_SEARCH_ORDER_KILLER 0x40000000
+
+typedef enum {
+	TTCHESS_BOUND_NONE,
+	TTCHESS_BOUND_UPPER,
+	TTCHESS_BOUND_LOWER,
+	TTCHESS_BOUND_EXACT,
+} ttchess_bound_t;
+
+// The key is stored xor-ed with the data.
+// A torn write from another thread makes the entry fail the key check instead
+// of returning a mix of two entries.
+typedef struct {
+	_Atomic uint64_t check;
+	_Atomic uint64_t data;
+} ttchess_tt_entry_t;
+
+struct ttchess_tt_s {
+	uint64_t mask;
+	ttchess_tt_entry_t entries[];
+};
+
+typedef struct {
+	uint16_t move;
+	int16_t score;
+	uint8_t depth;
+	uint8_t bound;
+} ttchess_tt_data_t;
+
+typedef struct {
+	ttchess_state_t state;
+	ttchess_tt_t* tt;
+	ttchess_search_config_t config;
+	ttchess_eval_weights_t weights;
+
+	double start_time;
+	uint64_t num_nodes;
+	bool can_abort;
+	bool aborted;
+
+	ttchess_move_t root_best_move;
+	uint16_t killers[TTCHESS_SEARCH_MAX_DEPTH][TTCHESS_SEARCH_NUM_KILLERS];
+	int32_t history[TTCHESS_SEARCH_HISTORY_SIZE];
+} ttchess_search_ctx_t;
+
+static inline double
+ttchess_search_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+size_t
+ttchess_tt_mem_size(int num_entries_log2) {
+	return sizeof(ttchess_tt_t) + sizeof(ttchess_tt_entry_t) * ((size_t)1 << num_entries_log2);
+}
+
+ttchess_tt_t*
+ttchess_tt_init(void* mem, int num_entries_log2) {
+	ttchess_tt_t* tt = mem;
+	tt->mask = ((uint64_t)1 << num_entries_log2) - 1;
+	ttchess_tt_clear(tt);
+	return tt;
+}
+
+void
+ttchess_tt_clear(ttchess_tt_t* tt) {
+	for (uint64_t i = 0; i <= tt->mask; ++i) {
+		atomic_store_explicit(&tt->entries[i].check, 0, memory_order_relaxed);
+		atomic_store_explicit(&tt->entries[i].data, 0, memory_order_relaxed);
+	}
+}
+
+static inline uint64_t
+ttchess_tt_pack(ttchess_tt_data_t data) {
+	return (uint64_t)data.move
+		| ((uint64_t)(uint16_t)data.score << 16)
+		| ((uint64_t)data.depth << 32)
+		| ((uint64_t)data.bound << 40);
+}
+
+static inline ttchess_tt_data_t
+ttchess_tt_unpack(uint64_t data) {
+	return (ttchess_tt_data_t){
+		.move = (uint16_t)data,
+		.score = (int16_t)(uint16_t)(data >> 16),
+		.depth = (uint8_t)(data >> 32),
+		.bound = (uint8_t)(data >> 40),
+	};
+}
+
+static inline bool
+ttchess_tt_probe(ttchess_tt_t* tt, uint64_t key, ttchess_tt_data_t* data) {
+	ttchess_tt_entry_t* entry = &tt->entries[key & tt->mask];
+	uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+	uint64_t packed = atomic_load_explicit(&entry->data, memory_order_relaxed);
+	if ((check ^ packed) != key) { return false; }
+
+	*data = ttchess_tt_unpack(packed);
+	return data->bound != TTCHESS_BOUND_NONE;
+}
+
+static inline void
+ttchess_tt_store(ttchess_tt_t* tt, uint64_t key, ttchess_tt_data_t data) {
+	ttchess_tt_entry_t* entry = &tt->entries[key & tt->mask];
+
+	// Keep a deeper result for the same position, anything else is replaced
+	uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+	uint64_t old_packed = atomic_load_explicit(&entry->data, memory_order_relaxed);
+	if ((check ^ old_packed) == key) {
+		ttchess_tt_data_t old_data = ttchess_tt_unpack(old_packed);
+		if (old_data.depth > data.depth && old_data.bound != TTCHESS_BOUND_NONE) {
+			return;
+		}
+	}
+
+	uint64_t packed = ttchess_tt_pack(data);
+	atomic_store_explicit(&entry->check, key ^ packed, memory_order_relaxed);
+	atomic_store_explicit(&entry->data, packed, memory_order_relaxed);
+}
+
+// Wins are stored relative to the node so they stay valid at any ply
+static inline int
+ttchess_score_to_tt(int score, int ply) {
+	if (score >= TTCHESS_SEARCH_WIN_BOUND) { return score + ply; }
+	if (score <= -TTCHESS_SEARCH_WIN_BOUND) { return score - ply; }
+	return score;
+}
+
+static inline int
+ttchess_score_from_tt(int score, int ply) {
+	if (score >= TTCHESS_SEARCH_WIN_BOUND) { return score - ply; }
+	if (score <= -TTCHESS_SEARCH_WIN_BOUND) { return score + ply; }
+	return score;
+}
+
+static inline int
+ttchess_search_history_index(ttchess_move_t move) {
+	int target;
+	switch (move.type) {
+		case TTCHESS_MOVE_SHIFT_FOCUS:
+		case TTCHESS_MOVE_TIME_TRAVEL:
+			target = move.era;
+			break;
+		default:
+			target = move.pos.y * TTCHESS_BOARD_WIDTH + move.pos.x;
+			break;
+	}
+
+	return ((int)move.type * TTCHESS_NUM_PAWNS + move.pawn_id) * TTCHESS_BOARD_WIDTH * TTCHESS_BOARD_HEIGHT
+		+ target;
+}
+
+static inline bool
+ttchess_search_should_stop(ttchess_search_ctx_t* ctx) {
+	if (ctx->aborted) { return true; }
+	if (!ctx->can_abort) { return false; }
+
+	if (ctx->config.node_limit > 0 && ctx->num_nodes >= ctx->config.node_limit) {
+		ctx->aborted = true;
+	} else if (
+		ctx->config.time_limit > 0.0
+		&& (ctx->num_nodes % TTCHESS_SEARCH_CHECK_INTERVAL) == 0
+		&& ttchess_search_now() - ctx->start_time >= ctx->config.time_limit
+	) {
+		ctx->aborted = true;
+	}
+
+	return ctx->aborted;
+}
+
+static int
+ttchess_search_node(ttchess_search_ctx_t* ctx, int depth, int ply, int alpha, int beta) {
+	ttchess_state_t* state = &ctx->state;
+
+	// The winner keeps the turn so this is from their point of view
+	if (state->phase.action == TTCHESS_ACTION_WON) {
+		return TTCHESS_SEARCH_WIN - ply;
+	}
+
+	++ctx->num_nodes;
+	if (ttchess_search_should_stop(ctx)) { return 0; }
+
+	if (depth <= 0 || ply >= TTCHESS_SEARCH_MAX_DEPTH) {
+		// Weights loaded from a file must not make a position look won
+		int score = ttchess_evaluate(state, &ctx->weights);
+		if (score >= TTCHESS_SEARCH_WIN_BOUND) { return TTCHESS_SEARCH_WIN_BOUND - 1; }
+		if (score <= -TTCHESS_SEARCH_WIN_BOUND) { return -(TTCHESS_SEARCH_WIN_BOUND - 1); }
+		return score;
+	}
+
+	uint16_t tt_move = 0;
+	bool has_tt_move = false;
+	ttchess_tt_data_t tt_data;
+	if (ttchess_tt_probe(ctx->tt, state->hash, &tt_data)) {
+		tt_move = tt_data.move;
+		has_tt_move = true;
+
+		if (ply > 0 && tt_data.depth >= depth) {
+			int score = ttchess_score_from_tt(tt_data.score, ply);
+			if (
+				tt_data.bound == TTCHESS_BOUND_EXACT
+				|| (tt_data.bound == TTCHESS_BOUND_LOWER && score >= beta)
+				|| (tt_data.bound == TTCHESS_BOUND_UPPER && score <= alpha)
+			) {
+				return score;
+			}
+		}
+	}
+
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	// Only happens when neither player can move
+	if (num_moves == 0) { return 0; }
+
+	int32_t order[TTCHESS_MAX_MOVES];
+	for (int i = 0; i < num_moves; ++i) {
+		uint16_t packed = ttchess_move_pack(moves[i]);
+		if (has_tt_move && packed == tt_move) {
+			order[i] = TTCHESS_SEARCH_ORDER_TT;
+		} else if (
+			packed == ctx->killers[ply][0]
+			|| packed == ctx->killers[ply][1]
+		) {
+			order[i] = TTCHESS_SEARCH_ORDER_KILLER;
+		} else {
+			order[i] = ctx->history[ttchess_search_history_index(moves[i])];
+		}
+	}
+
+	ttchess_color_t color = state->phase.color;
+	int original_alpha = alpha;
+	int best_score = -TTCHESS_SEARCH_INF;
+	ttchess_move_t best_move = moves[0];
+	for (int i = 0; i < num_moves; ++i) {
+		// Selection sort, a cutoff usually happens within the first few moves
+		int best_index = i;
+		for (int j = i + 1; j < num_moves; ++j) {
+			if (order[j] > order[best_index]) { best_index = j; }
+		}
+		ttchess_move_t move = moves[best_index];
+		moves[best_index] = moves[i];
+		order[best_index] = order[i];
+
+		ttchess_undo_t undo;
+		if (!ttchess_make_move(state, move, &undo)) { continue; }
+
+		// A player makes several moves in a row so the sign only flips when
+		// the turn passes
+		int score;
+		if (state->phase.color == color) {
+			score = ttchess_search_node(ctx, depth - 1, ply + 1, alpha, beta);
+		} else {
+			score = -ttchess_search_node(ctx, depth - 1, ply + 1, -beta, -alpha);
+		}
+		ttchess_unmake_move(state, &undo);
+
+		if (ctx->aborted) { return 0; }
+
+		if (score > best_score) {
+			best_score = score;
+			best_move = move;
+			if (ply == 0) { ctx->root_best_move = move; }
+		}
+
+		if (score > alpha) { alpha = score; }
+		if (alpha >= beta) {
+			uint16_t packed = ttchess_move_pack(move);
+			if (ctx->killers[ply][0] != packed) {
+				ctx->killers[ply][1] = ctx->killers[ply][0];
+				ctx->killers[ply][0] = packed;
+			}
+
+			int32_t* history = &ctx->history[ttchess_search_history_index(move)];
+			*history += depth * depth;
+			if (*history >= TTCHESS_SEARCH_ORDER_KILLER) {
+				for (int j = 0; j < TTCHESS_SEARCH_HISTORY_SIZE; ++j) {
+					ctx->history[j] /= 2;
+				}
+			}
+			break;
+		}
+	}
+
+	ttchess_bound_t bound;
+	if (best_score >= beta) {
+		bound = TTCHESS_BOUND_LOWER;
+	} else if (best_score > original_alpha) {
+		bound = TTCHESS_BOUND_EXACT;
+	} else {
+		bound = TTCHESS_BOUND_UPPER;
+	}
+	ttchess_tt_store(ctx->tt, state->hash, (ttchess_tt_data_t){
+		.move = ttchess_move_pack(best_move),
+		.score = (int16_t)ttchess_score_to_tt(best_score, ply),
+		.depth = (uint8_t)depth,
+		.bound = (uint8_t)bound,
+	});
+
+	return best_score;
+}
+
+// Follows the best moves stored in the table.
+// Every move is checked since entries can be overwritten by other positions.
+static int
+ttchess_search_extract_pv(ttchess_search_ctx_t* ctx, ttchess_move_t* pv, int max_length) {
+	ttchess_state_t state = ctx->state;
+	uint64_t visited[TTCHESS_SEARCH_MAX_DEPTH];
+	int length = 0;
+	while (length < max_length) {
+		ttchess_tt_data_t data;
+		if (!ttchess_tt_probe(ctx->tt, state.hash, &data)) { break; }
+
+		bool repeated = false;
+		for (int i = 0; i < length && !repeated; ++i) {
+			repeated = visited[i] == state.hash;
+		}
+		if (repeated) { break; }
+		visited[length] = state.hash;
+
+		ttchess_move_t move = ttchess_move_unpack(data.move);
+		if (!ttchess_apply_move(&state, move)) { break; }
+		pv[length++] = move;
+	}
+
+	return length;
+}
+
+bool
+ttchess_search(
+	const ttchess_state_t* state,
+	ttchess_tt_t* tt,
+	ttchess_search_config_t config,
+	ttchess_search_result_t* result
+) {
+	*result = (ttchess_search_result_t){ 0 };
+	if (ttchess_list_moves(state, NULL, 0) == 0) { return false; }
+
+	int max_depth = config.max_depth;
+	if (max_depth <= 0 || max_depth > TTCHESS_SEARCH_MAX_DEPTH) {
+		max_depth = TTCHESS_SEARCH_MAX_DEPTH;
+	}
+
+	ttchess_search_ctx_t ctx = {
+		.state = *state,
+		.tt = tt,
+		.config = config,
+		.start_time = ttchess_search_now(),
+	};
+	if (config.weights != NULL) {
+		ctx.weights = *config.weights;
+	} else {
+		ttchess_eval_default_weights(&ctx.weights);
+	}
+
+	for (int depth = 1; depth <= max_depth; ++depth) {
+		// The first iteration always completes so there is a move to return
+		ctx.can_abort = depth > 1;
+		int score = ttchess_search_node(&ctx, depth, 0, -TTCHESS_SEARCH_INF, TTCHESS_SEARCH_INF);
+		if (ctx.aborted) { break; }
+
+		result->best_move = ctx.root_best_move;
+		result->score = score;
+		result->depth = depth;
+
+		// No point going deeper once the outcome is known
+		if (score >= TTCHESS_SEARCH_WIN_BOUND || score <= -TTCHESS_SEARCH_WIN_BOUND) {
+			break;
+		}
+	}
+
+	result->pv_length = ttchess_search_extract_pv(&ctx, result->pv, result->depth);
+	// The root entry can be replaced by a collision so the PV may not start
+	// with the searched move
+	if (result->pv_length == 0 || !ttchess_move_equal(result->pv[0], result->best_move)) {
+		result->pv[0] = result->best_move;
+		result->pv_length = 1;
+	}
+	result->num_nodes = ctx.num_nodes;
+	result->time = ttchess_search_now() - ctx.start_time;
+
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef TTCHESS_SEARCH_H
+#define TTCHESS_SEARCH_H
+
+#include "ttchess.h"
+#include "eval.h"
+#include <stddef.h>
+
+// One ply is one action, a full turn is three plies
+#define TTCHESS_SEARCH_MAX_DEPTH 64
+// Scores at or above this are forced wins, the rest is the distance in plies
+#define TTCHESS_SEARCH_WIN 30000
+#define TTCHESS_SEARCH_WIN_BOUND (TTCHESS_SEARCH_WIN - TTCHESS_SEARCH_MAX_DEPTH)
+
+_Static_assert(TTCHESS_EVAL_MAX_SCORE < TTCHESS_SEARCH_WIN_BOUND, "Evaluations must not look like wins");
+
+// Fixed-size transposition table.
+// Entries are validated on read instead of locked so several searches can
+// share one table.
+typedef struct ttchess_tt_s ttchess_tt_t;
+
+typedef struct {
+	// 0 means TTCHESS_SEARCH_MAX_DEPTH
+	int max_depth;
+	// In seconds, 0 means no limit
+	double time_limit;
+	// 0 means no limit
+	uint64_t node_limit;
+	// NULL means ttchess_eval_default_weights
+	const ttchess_eval_weights_t* weights;
+} ttchess_search_config_t;
+
+typedef struct {
+	ttchess_move_t best_move;
+	// From the point of view of the player to move
+	int score;
+	// Deepest completed iteration
+	int depth;
+	uint64_t num_nodes;
+	double time;
+
+	int pv_length;
+	ttchess_move_t pv[TTCHESS_SEARCH_MAX_DEPTH];
+} ttchess_search_result_t;
+
+size_t
+ttchess_tt_mem_size(int num_entries_log2);
+
+ttchess_tt_t*
+ttchess_tt_init(void* mem, int num_entries_log2);
+
+void
+ttchess_tt_clear(ttchess_tt_t* tt);
+
+// Iterative deepening alpha-beta.
+// The first iteration ignores the budget, so this only returns false when there
+// is no legal move.
+bool
+ttchess_search(
+	const ttchess_state_t* state,
+	ttchess_tt_t* tt,
+	ttchess_search_config_t config,
+	ttchess_search_result_t* result
+);
+
+#endif
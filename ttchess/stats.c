@@ -0,0 +1,180 @@
+#include "stats.h"
+#include <inttypes.h>
+#include <string.h>
+
+const char* const ttchess_stats_move_type_names[TTCHESS_STATS_NUM_MOVE_TYPES] = {
+	[TTCHESS_MOVE_PAWN] = "pawn",
+	[TTCHESS_MOVE_TIME_TRAVEL] = "time_travel",
+	[TTCHESS_MOVE_SHIFT_FOCUS] = "shift_focus",
+	[TTCHESS_MOVE_BUILD_STATUE] = "build_statue",
+	[TTCHESS_MOVE_PULL_STATUE] = "pull_statue",
+};
+
+#ifdef TTCHESS_STATS
+
+#include <stdlib.h>
+#include <threads.h>
+
+_Thread_local ttchess_stats_block_t* ttchess_stats_local_block = NULL;
+
+static once_flag ttchess_stats_once = ONCE_FLAG_INIT;
+static mtx_t ttchess_stats_mutex;
+// Releases the block of a thread when it exits
+static tss_t ttchess_stats_key;
+// Blocks of the running threads
+static ttchess_stats_block_t* ttchess_stats_blocks = NULL;
+// Blocks of finished threads, ready to be reused
+static ttchess_stats_block_t* ttchess_stats_free_blocks = NULL;
+// Counts of finished threads, so that they stay in the totals
+static uint64_t ttchess_stats_retired[TTCHESS_STATS_NUM_COUNTERS] = { 0 };
+
+static void
+ttchess_stats_release_block(void* ptr) {
+	ttchess_stats_block_t* block = ptr;
+
+	mtx_lock(&ttchess_stats_mutex);
+	for (size_t i = 0; i < TTCHESS_STATS_NUM_COUNTERS; ++i) {
+		ttchess_stats_retired[i] += atomic_load_explicit(&block->counters[i], memory_order_relaxed);
+	}
+
+	for (ttchess_stats_block_t** itr = &ttchess_stats_blocks; *itr != NULL; itr = &(*itr)->next) {
+		if (*itr == block) {
+			*itr = block->next;
+			break;
+		}
+	}
+	block->next = ttchess_stats_free_blocks;
+	ttchess_stats_free_blocks = block;
+	mtx_unlock(&ttchess_stats_mutex);
+
+	ttchess_stats_local_block = NULL;
+}
+
+static void
+ttchess_stats_init(void) {
+	mtx_init(&ttchess_stats_mutex, mtx_plain);
+	tss_create(&ttchess_stats_key, ttchess_stats_release_block);
+}
+
+ttchess_stats_block_t*
+ttchess_stats_register_thread(void) {
+	call_once(&ttchess_stats_once, ttchess_stats_init);
+	mtx_lock(&ttchess_stats_mutex);
+	ttchess_stats_block_t* block = ttchess_stats_free_blocks;
+	if (block != NULL) {
+		ttchess_stats_free_blocks = block->next;
+	} else {
+		block = malloc(sizeof(ttchess_stats_block_t));
+		if (block == NULL) { abort(); }
+	}
+
+	block->push_depth = 0;
+	block->push_chain = 0;
+	for (size_t i = 0; i < TTCHESS_STATS_NUM_COUNTERS; ++i) {
+		atomic_init(&block->counters[i], 0);
+	}
+	block->next = ttchess_stats_blocks;
+	ttchess_stats_blocks = block;
+	mtx_unlock(&ttchess_stats_mutex);
+
+	tss_set(ttchess_stats_key, block);
+	ttchess_stats_local_block = block;
+	return block;
+}
+
+bool
+ttchess_stats_enabled(void) {
+	return true;
+}
+
+void
+ttchess_stats_snapshot(ttchess_stats_t* stats) {
+	uint64_t totals[TTCHESS_STATS_NUM_COUNTERS];
+
+	call_once(&ttchess_stats_once, ttchess_stats_init);
+	mtx_lock(&ttchess_stats_mutex);
+	memcpy(totals, ttchess_stats_retired, sizeof(totals));
+	for (ttchess_stats_block_t* block = ttchess_stats_blocks; block != NULL; block = block->next) {
+		for (size_t i = 0; i < TTCHESS_STATS_NUM_COUNTERS; ++i) {
+			totals[i] += atomic_load_explicit(&block->counters[i], memory_order_relaxed);
+		}
+	}
+	mtx_unlock(&ttchess_stats_mutex);
+
+	memcpy(stats, totals, sizeof(*stats));
+}
+
+void
+ttchess_stats_reset(void) {
+	call_once(&ttchess_stats_once, ttchess_stats_init);
+	mtx_lock(&ttchess_stats_mutex);
+	memset(ttchess_stats_retired, 0, sizeof(ttchess_stats_retired));
+	for (ttchess_stats_block_t* block = ttchess_stats_blocks; block != NULL; block = block->next) {
+		for (size_t i = 0; i < TTCHESS_STATS_NUM_COUNTERS; ++i) {
+			atomic_store_explicit(&block->counters[i], 0, memory_order_relaxed);
+		}
+	}
+	mtx_unlock(&ttchess_stats_mutex);
+}
+
+#else
+
+bool
+ttchess_stats_enabled(void) {
+	return false;
+}
+
+void
+ttchess_stats_snapshot(ttchess_stats_t* stats) {
+	memset(stats, 0, sizeof(*stats));
+}
+
+void
+ttchess_stats_reset(void) {
+}
+
+#endif
+
+static void
+ttchess_stats_write_array(FILE* file, const char* name, const uint64_t* values, int count) {
+	fprintf(file, ",\"%s\":[", name);
+	for (int i = 0; i < count; ++i) {
+		fprintf(file, "%s%" PRIu64, i > 0 ? "," : "", values[i]);
+	}
+	fprintf(file, "]");
+}
+
+void
+ttchess_stats_write_json(FILE* file, const char* label, const ttchess_stats_t* stats) {
+	fprintf(file, "{\"label\":\"");
+	for (const char* ch = label; *ch != '\0'; ++ch) {
+		if (*ch == '"' || *ch == '\\') {
+			fputc('\\', file);
+		}
+		if ((unsigned char)*ch >= 0x20) {
+			fputc(*ch, file);
+		}
+	}
+	fprintf(file, "\",\"enabled\":%s", ttchess_stats_enabled() ? "true" : "false");
+
+	fprintf(file, ",\"validate\":{");
+	for (int type = 0; type < TTCHESS_STATS_NUM_MOVE_TYPES; ++type) {
+		fprintf(
+			file, "%s\"%s\":{\"calls\":%" PRIu64 ",\"accepted\":%" PRIu64 "}",
+			type > 0 ? "," : "",
+			ttchess_stats_move_type_names[type],
+			stats->validate_calls[type],
+			stats->validate_accepted[type]
+		);
+	}
+	fprintf(file, "}");
+
+	ttchess_stats_write_array(file, "can_move_depth", stats->can_move_depth, TTCHESS_STATS_MAX_DEPTH);
+	ttchess_stats_write_array(file, "push_chain_length", stats->push_chain_length, TTCHESS_STATS_MAX_CHAIN);
+	fprintf(
+		file, ",\"reindex_calls\":%" PRIu64 ",\"turn_skip_checks\":%" PRIu64 ",\"turn_skips\":%" PRIu64 "}\n",
+		stats->reindex_calls,
+		stats->turn_skip_checks,
+		stats->turn_skips
+	);
+}
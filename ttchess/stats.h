@@ -0,0 +1,138 @@
+#ifndef TTCHESS_STATS_H
+#define TTCHESS_STATS_H
+
+#include "ttchess.h"
+#include <stdio.h>
+
+#define TTCHESS_STATS_NUM_MOVE_TYPES (TTCHESS_MOVE_PULL_STATUE + 1)
+// ttchess_piece_can_move gives up past TTCHESS_BOARD_WIDTH
+#define TTCHESS_STATS_MAX_DEPTH (TTCHESS_BOARD_WIDTH + 2)
+// The last bucket also counts longer chains
+#define TTCHESS_STATS_MAX_CHAIN 8
+
+// Counters on the hot paths of the rules, only collected when the library is
+// built with TTCHESS_STATS, which Release builds never define.
+// Without it, the counters compile to nothing and snapshots are all zeros.
+typedef struct {
+	uint64_t validate_calls[TTCHESS_STATS_NUM_MOVE_TYPES];
+	uint64_t validate_accepted[TTCHESS_STATS_NUM_MOVE_TYPES];
+	// ttchess_piece_can_move calls at each recursion depth
+	uint64_t can_move_depth[TTCHESS_STATS_MAX_DEPTH];
+	// Pushes that moved this many pieces, including the pusher
+	uint64_t push_chain_length[TTCHESS_STATS_MAX_CHAIN];
+	uint64_t reindex_calls;
+	uint64_t turn_skip_checks;
+	uint64_t turn_skips;
+} ttchess_stats_t;
+
+extern const char* const ttchess_stats_move_type_names[TTCHESS_STATS_NUM_MOVE_TYPES];
+
+bool
+ttchess_stats_enabled(void);
+
+// Sums the counters of every thread that has used the rules
+void
+ttchess_stats_snapshot(ttchess_stats_t* stats);
+
+// Counts made by other threads at the same time may be lost
+void
+ttchess_stats_reset(void);
+
+// Writes `stats` as one JSON object followed by a newline
+void
+ttchess_stats_write_json(FILE* file, const char* label, const ttchess_stats_t* stats);
+
+#ifdef TTCHESS_STATS
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define TTCHESS_STATS_NUM_COUNTERS (sizeof(ttchess_stats_t) / sizeof(uint64_t))
+
+// One per thread so counting never contends.
+// Counters are atomic only so that snapshots can read them from other threads.
+typedef struct ttchess_stats_block_s {
+	struct ttchess_stats_block_s* next;
+	int push_depth;
+	int push_chain;
+	atomic_uint_least64_t counters[TTCHESS_STATS_NUM_COUNTERS];
+} ttchess_stats_block_t;
+
+extern _Thread_local ttchess_stats_block_t* ttchess_stats_local_block;
+
+ttchess_stats_block_t*
+ttchess_stats_register_thread(void);
+
+static inline ttchess_stats_block_t*
+ttchess_stats_block(void) {
+	ttchess_stats_block_t* block = ttchess_stats_local_block;
+	return block != NULL ? block : ttchess_stats_register_thread();
+}
+
+static inline void
+ttchess_stats_add(size_t index, uint64_t amount) {
+	// Only this thread writes to the block so there is no need for a locked add
+	atomic_uint_least64_t* counter = &ttchess_stats_block()->counters[index];
+	atomic_store_explicit(
+		counter,
+		atomic_load_explicit(counter, memory_order_relaxed) + amount,
+		memory_order_relaxed
+	);
+}
+
+// Out of range indices are dropped unless `clamp` is set, in which case the
+// last bucket takes the larger ones
+static inline void
+ttchess_stats_add_at(size_t offset, int index, int num_buckets, bool clamp) {
+	if (index < 0) { return; }
+	if (index >= num_buckets) {
+		if (!clamp) { return; }
+		index = num_buckets - 1;
+	}
+	ttchess_stats_add(offset / sizeof(uint64_t) + (size_t)index, 1);
+}
+
+static inline void
+ttchess_stats_push_enter(bool has_piece) {
+	ttchess_stats_block_t* block = ttchess_stats_block();
+	block->push_depth += 1;
+	block->push_chain += has_piece ? 1 : 0;
+}
+
+static inline void
+ttchess_stats_push_exit(void) {
+	ttchess_stats_block_t* block = ttchess_stats_block();
+	if (--block->push_depth > 0) { return; }
+
+	ttchess_stats_add_at(
+		offsetof(ttchess_stats_t, push_chain_length),
+		block->push_chain,
+		TTCHESS_STATS_MAX_CHAIN,
+		true
+	);
+	block->push_chain = 0;
+}
+
+#	define TTCHESS_STATS_COUNT(field) \
+		ttchess_stats_add(offsetof(ttchess_stats_t, field) / sizeof(uint64_t), 1)
+#	define TTCHESS_STATS_NUM_BUCKETS(field) \
+		(int)(sizeof(((ttchess_stats_t*)0)->field) / sizeof(uint64_t))
+#	define TTCHESS_STATS_COUNT_AT(field, index) \
+		ttchess_stats_add_at( \
+			offsetof(ttchess_stats_t, field), (int)(index), TTCHESS_STATS_NUM_BUCKETS(field), false \
+		)
+#	define TTCHESS_STATS_COUNT_BUCKET(field, value) \
+		ttchess_stats_add_at( \
+			offsetof(ttchess_stats_t, field), (int)(value), TTCHESS_STATS_NUM_BUCKETS(field), true \
+		)
+#	define TTCHESS_STATS_PUSH_ENTER(has_piece) ttchess_stats_push_enter(has_piece)
+#	define TTCHESS_STATS_PUSH_EXIT() ttchess_stats_push_exit()
+#else
+#	define TTCHESS_STATS_COUNT(field) (void)0
+#	define TTCHESS_STATS_COUNT_AT(field, index) (void)0
+#	define TTCHESS_STATS_COUNT_BUCKET(field, value) (void)0
+#	define TTCHESS_STATS_PUSH_ENTER(has_piece) (void)0
+#	define TTCHESS_STATS_PUSH_EXIT() (void)0
+#endif
+
+#endif
@@ -0,0 +1,334 @@
+#include "tablebase.h"
+#include <string.h>
+
+#define TTCHESS_TB_MAGIC "TTTB"
+#define TTCHESS_TB_CELLS_PER_ERA (TTCHESS_BOARD_WIDTH * TTCHESS_BOARD_HEIGHT)
+#define TTCHESS_TB_NUM_CELLS (TTCHESS_NUM_ERAS * TTCHESS_TB_CELLS_PER_ERA)
+#define TTCHESS_TB_NUM_FOCUSES (TTCHESS_NUM_ERAS * TTCHESS_NUM_ERAS)
+#define TTCHESS_TB_VALUE_MASK 0x03
+#define TTCHESS_TB_PACKED_OFF_BOARD 0x80
+
+// The turn is one of these followed by one slot per pawn that could have
+// acted first for TTCHESS_ACTION_SECOND
+#define TTCHESS_TB_SLOT_FIRST 0
+#define TTCHESS_TB_SLOT_SHIFT_FOCUS 1
+#define TTCHESS_TB_SLOT_SECOND 2
+
+// The pawns of one player.
+// Cells are numbered `era * 16 + y * 4 + x` and sorted.
+typedef struct {
+	int num_on_board;
+	int num_reserve;
+	int cells[TTCHESS_TB_MAX_PAWNS];
+} ttchess_tb_side_t;
+
+static inline uint64_t
+ttchess_tb_binomial(int n, int k) {
+	if (k < 0 || k > n) { return 0; }
+
+	uint64_t result = 1;
+	for (int i = 1; i <= k; ++i) {
+		result = result * (uint64_t)(n - k + i) / (uint64_t)i;
+	}
+	return result;
+}
+
+static inline int
+ttchess_tb_num_slots(int max_pawns) {
+	return TTCHESS_TB_SLOT_SECOND + max_pawns;
+}
+
+// Sides are grouped by the number of pawns on board, then ordered by the
+// rank of their cells and finally by the number of reserve pawns
+static inline uint64_t
+ttchess_tb_side_offset(int max_pawns, int num_on_board) {
+	uint64_t offset = 0;
+	for (int n = 0; n < num_on_board; ++n) {
+		offset += ttchess_tb_binomial(TTCHESS_TB_NUM_CELLS, n) * (uint64_t)(max_pawns - n + 1);
+	}
+	return offset;
+}
+
+static inline uint64_t
+ttchess_tb_side_index(int max_pawns, const ttchess_tb_side_t* side) {
+	// Combinatorial number system, a bijection between sorted subsets of a
+	// given size and [0, binomial(NUM_CELLS, size))
+	uint64_t rank = 0;
+	for (int i = 0; i < side->num_on_board; ++i) {
+		rank += ttchess_tb_binomial(side->cells[i], i + 1);
+	}
+
+	return ttchess_tb_side_offset(max_pawns, side->num_on_board)
+		+ rank * (uint64_t)(max_pawns - side->num_on_board + 1)
+		+ (uint64_t)side->num_reserve;
+}
+
+static inline void
+ttchess_tb_side_from_index(int max_pawns, uint64_t index, ttchess_tb_side_t* side) {
+	int num_on_board = 0;
+	while (
+		num_on_board < max_pawns
+		&& index >= ttchess_tb_side_offset(max_pawns, num_on_board + 1)
+	) {
+		++num_on_board;
+	}
+
+	index -= ttchess_tb_side_offset(max_pawns, num_on_board);
+	uint64_t num_reserve_choices = (uint64_t)(max_pawns - num_on_board + 1);
+	side->num_on_board = num_on_board;
+	side->num_reserve = (int)(index % num_reserve_choices);
+
+	uint64_t rank = index / num_reserve_choices;
+	for (int i = num_on_board - 1; i >= 0; --i) {
+		int cell = TTCHESS_TB_NUM_CELLS - 1;
+		while (ttchess_tb_binomial(cell, i + 1) > rank) { --cell; }
+		side->cells[i] = cell;
+		rank -= ttchess_tb_binomial(cell, i + 1);
+	}
+}
+
+static inline bool
+ttchess_tb_collect_side(
+	int max_pawns,
+	const ttchess_state_t* state,
+	ttchess_color_t color,
+	ttchess_tb_side_t* side
+) {
+	*side = (ttchess_tb_side_t){ 0 };
+
+	int pawn_min = color == TTCHESS_COLOR_WHITE
+		? TTCHESS_FIRST_WHITE_PAWN
+		: TTCHESS_FIRST_BLACK_PAWN;
+	int pawn_max = pawn_min + TTCHESS_NUM_PAWNS / 2;
+	int num_alive = 0;
+	for (int pawn_index = pawn_min; pawn_index < pawn_max; ++pawn_index) {
+		ttchess_pawn_status_t status = state->pawns[pawn_index].status;
+		side->num_reserve += status == TTCHESS_PAWN_RESERVE;
+		num_alive += status != TTCHESS_PAWN_DEAD;
+	}
+	if (num_alive > max_pawns) { return false; }
+
+	// Going through the bitboards in order yields sorted cells
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		for (
+			ttchess_bitboard_t pawns = state->boards[era].pawns[color];
+			pawns != 0;
+			pawns = (ttchess_bitboard_t)(pawns & (pawns - 1))
+		) {
+			int bit = 0;
+			while (!(pawns & (1u << bit))) { ++bit; }
+			side->cells[side->num_on_board++] = era * TTCHESS_TB_CELLS_PER_ERA + bit;
+		}
+	}
+
+	return true;
+}
+
+uint64_t
+ttchess_tb_num_entries(int max_pawns) {
+	if (!(0 < max_pawns && max_pawns <= TTCHESS_TB_MAX_PAWNS)) { return 0; }
+
+	uint64_t num_sides = ttchess_tb_side_offset(max_pawns, max_pawns + 1);
+	return num_sides * num_sides
+		* TTCHESS_TB_NUM_FOCUSES
+		* TTCHESS_NUM_PLAYERS
+		* (uint64_t)ttchess_tb_num_slots(max_pawns);
+}
+
+bool
+ttchess_tb_index(int max_pawns, const ttchess_state_t* state, uint64_t* index) {
+	if (!(0 < max_pawns && max_pawns <= TTCHESS_TB_MAX_PAWNS)) { return false; }
+	if (state->config.with_statues || state->phase.action == TTCHESS_ACTION_WON) {
+		return false;
+	}
+
+	ttchess_tb_side_t sides[TTCHESS_NUM_PLAYERS];
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		if (!ttchess_tb_collect_side(max_pawns, state, (ttchess_color_t)color, &sides[color])) {
+			return false;
+		}
+	}
+
+	ttchess_color_t color = state->phase.color;
+	int slot = TTCHESS_TB_SLOT_FIRST;
+	switch (state->phase.action) {
+		case TTCHESS_ACTION_FIRST:
+			slot = TTCHESS_TB_SLOT_FIRST;
+			break;
+		case TTCHESS_ACTION_SHIFT_FOCUS:
+			slot = TTCHESS_TB_SLOT_SHIFT_FOCUS;
+			break;
+		case TTCHESS_ACTION_SECOND: {
+			// Only the cell of the pawn that acted first matters
+			int8_t pawn_id = state->last_pawn;
+			if (!(0 <= pawn_id && pawn_id < TTCHESS_NUM_PAWNS)) { return false; }
+			if (ttchess_pawn_color(pawn_id) != color) { return false; }
+
+			const ttchess_pawn_t* pawn = &state->pawns[pawn_id];
+			if (!(TTCHESS_PAWN_PAST <= pawn->status && pawn->status <= TTCHESS_PAWN_FUTURE)) {
+				return false;
+			}
+			int cell = (pawn->status - TTCHESS_PAWN_PAST) * TTCHESS_TB_CELLS_PER_ERA
+				+ pawn->pos.y * TTCHESS_BOARD_WIDTH + pawn->pos.x;
+
+			const ttchess_tb_side_t* side = &sides[color];
+			int i = 0;
+			while (i < side->num_on_board && side->cells[i] != cell) { ++i; }
+			if (i == side->num_on_board) { return false; }
+			slot = TTCHESS_TB_SLOT_SECOND + i;
+		} break;
+		case TTCHESS_ACTION_WON:
+			return false;
+	}
+
+	uint64_t num_sides = ttchess_tb_side_offset(max_pawns, max_pawns + 1);
+	uint64_t result = ttchess_tb_side_index(max_pawns, &sides[TTCHESS_COLOR_WHITE]);
+	result = result * num_sides + ttchess_tb_side_index(max_pawns, &sides[TTCHESS_COLOR_BLACK]);
+	result = result * TTCHESS_TB_NUM_FOCUSES
+		+ (uint64_t)(state->focuses[TTCHESS_COLOR_WHITE] * TTCHESS_NUM_ERAS + state->focuses[TTCHESS_COLOR_BLACK]);
+	result = result * TTCHESS_NUM_PLAYERS + (uint64_t)color;
+	result = result * (uint64_t)ttchess_tb_num_slots(max_pawns) + (uint64_t)slot;
+
+	*index = result;
+	return true;
+}
+
+bool
+ttchess_tb_state(int max_pawns, uint64_t index, ttchess_state_t* state) {
+	if (index >= ttchess_tb_num_entries(max_pawns)) { return false; }
+
+	int num_slots = ttchess_tb_num_slots(max_pawns);
+	int slot = (int)(index % (uint64_t)num_slots);
+	index /= (uint64_t)num_slots;
+	ttchess_color_t color = (ttchess_color_t)(index % TTCHESS_NUM_PLAYERS);
+	index /= TTCHESS_NUM_PLAYERS;
+	int focuses = (int)(index % TTCHESS_TB_NUM_FOCUSES);
+	index /= TTCHESS_TB_NUM_FOCUSES;
+
+	uint64_t num_sides = ttchess_tb_side_offset(max_pawns, max_pawns + 1);
+	ttchess_tb_side_t sides[TTCHESS_NUM_PLAYERS];
+	ttchess_tb_side_from_index(max_pawns, index % num_sides, &sides[TTCHESS_COLOR_BLACK]);
+	ttchess_tb_side_from_index(max_pawns, index / num_sides, &sides[TTCHESS_COLOR_WHITE]);
+
+	const ttchess_tb_side_t* own_side = &sides[color];
+	ttchess_player_action_t action;
+	int first_pawn = color == TTCHESS_COLOR_WHITE
+		? TTCHESS_FIRST_WHITE_PAWN
+		: TTCHESS_FIRST_BLACK_PAWN;
+	int8_t last_pawn = (int8_t)first_pawn;
+	if (slot == TTCHESS_TB_SLOT_FIRST) {
+		action = TTCHESS_ACTION_FIRST;
+	} else if (slot == TTCHESS_TB_SLOT_SHIFT_FOCUS) {
+		// The turn is skipped instead when the pawn that acted died
+		if (own_side->num_on_board == 0) { return false; }
+		action = TTCHESS_ACTION_SHIFT_FOCUS;
+	} else {
+		if (slot - TTCHESS_TB_SLOT_SECOND >= own_side->num_on_board) { return false; }
+		action = TTCHESS_ACTION_SECOND;
+		// Pawns on board get the first ids in cell order
+		last_pawn = (int8_t)(first_pawn + slot - TTCHESS_TB_SLOT_SECOND);
+	}
+
+	// Go through the packed representation so the derived state is built by
+	// the rules themselves
+	uint8_t packed[TTCHESS_PACKED_SIZE];
+	memset(packed, TTCHESS_TB_PACKED_OFF_BOARD, sizeof(packed));
+	packed[0] = TTCHESS_PACKED_VERSION;
+	packed[1] = (uint8_t)(
+		  ((unsigned)action << 1)
+		| ((unsigned)color << 3)
+		| ((unsigned)(focuses / TTCHESS_NUM_ERAS) << 4)
+		| ((unsigned)(focuses % TTCHESS_NUM_ERAS) << 6)
+	);
+	packed[2] = (uint8_t)last_pawn;
+
+	for (int side_color = 0; side_color < TTCHESS_NUM_PLAYERS; ++side_color) {
+		const ttchess_tb_side_t* side = &sides[side_color];
+		uint8_t* pawns = packed + 3 + (side_color == TTCHESS_COLOR_WHITE
+			? TTCHESS_FIRST_WHITE_PAWN
+			: TTCHESS_FIRST_BLACK_PAWN);
+
+		int pawn_index = 0;
+		for (int i = 0; i < side->num_on_board; ++i) {
+			int era = side->cells[i] / TTCHESS_TB_CELLS_PER_ERA;
+			int bit = side->cells[i] % TTCHESS_TB_CELLS_PER_ERA;
+			pawns[pawn_index++] = (uint8_t)(((TTCHESS_PAWN_PAST + era) << 4) | bit);
+		}
+		for (int i = 0; i < side->num_reserve; ++i) {
+			pawns[pawn_index++] = (uint8_t)(TTCHESS_TB_PACKED_OFF_BOARD | (TTCHESS_PAWN_RESERVE << 4));
+		}
+		while (pawn_index < TTCHESS_NUM_PAWNS / 2) {
+			pawns[pawn_index++] = (uint8_t)(TTCHESS_TB_PACKED_OFF_BOARD | (TTCHESS_PAWN_DEAD << 4));
+		}
+	}
+
+	// Fails when both players have a pawn on the same cell
+	return ttchess_state_unpack(state, packed);
+}
+
+size_t
+ttchess_tb_encoded_size(int max_pawns) {
+	return TTCHESS_TB_HEADER_SIZE + (size_t)((ttchess_tb_num_entries(max_pawns) + 3) / 4);
+}
+
+void
+ttchess_tb_encode(int max_pawns, const uint8_t* values, uint8_t* out) {
+	uint64_t num_entries = ttchess_tb_num_entries(max_pawns);
+
+	memcpy(out, TTCHESS_TB_MAGIC, 4);
+	out[4] = TTCHESS_TB_VERSION;
+	out[5] = (uint8_t)max_pawns;
+	out[6] = 0;
+	out[7] = 0;
+	for (int i = 0; i < 8; ++i) {
+		out[8 + i] = (uint8_t)((num_entries >> (i * 8)) & 0xff);
+	}
+	out += TTCHESS_TB_HEADER_SIZE;
+
+	memset(out, 0, (size_t)((num_entries + 3) / 4));
+	for (uint64_t i = 0; i < num_entries; ++i) {
+		out[i / 4] |= (uint8_t)((values[i] & TTCHESS_TB_VALUE_MASK) << ((i % 4) * 2));
+	}
+}
+
+bool
+ttchess_tb_open(ttchess_tb_t* tb, const void* data, size_t size) {
+	const uint8_t* in = data;
+	if (
+		size < TTCHESS_TB_HEADER_SIZE
+		|| memcmp(in, TTCHESS_TB_MAGIC, 4) != 0
+		|| in[4] != TTCHESS_TB_VERSION
+		|| in[6] != 0
+		|| in[7] != 0
+	) {
+		return false;
+	}
+
+	int max_pawns = in[5];
+	uint64_t num_entries = 0;
+	for (int i = 0; i < 8; ++i) {
+		num_entries |= (uint64_t)in[8 + i] << (i * 8);
+	}
+	if (
+		num_entries == 0
+		|| num_entries != ttchess_tb_num_entries(max_pawns)
+		|| size != ttchess_tb_encoded_size(max_pawns)
+	) {
+		return false;
+	}
+
+	*tb = (ttchess_tb_t){
+		.max_pawns = max_pawns,
+		.num_entries = num_entries,
+		.values = in + TTCHESS_TB_HEADER_SIZE,
+	};
+	return true;
+}
+
+ttchess_tb_value_t
+ttchess_tb_probe(const ttchess_tb_t* tb, const ttchess_state_t* state) {
+	uint64_t index;
+	if (!ttchess_tb_index(tb->max_pawns, state, &index)) { return TTCHESS_TB_UNKNOWN; }
+
+	return (ttchess_tb_value_t)((tb->values[index / 4] >> ((index % 4) * 2)) & TTCHESS_TB_VALUE_MASK);
+}
@@ -0,0 +1,73 @@
+#ifndef TTCHESS_TABLEBASE_H
+#define TTCHESS_TABLEBASE_H
+
+#include "ttchess.h"
+#include <stddef.h>
+
+// Index sizes grow quickly: 135000 entries for 1 pawn per side and
+// 108 million (27 MB) for 2
+#define TTCHESS_TB_MAX_PAWNS 2
+#define TTCHESS_TB_VERSION 1
+#define TTCHESS_TB_HEADER_SIZE 16
+
+typedef enum {
+	// The position is not covered by the table
+	TTCHESS_TB_UNKNOWN = 0,
+	TTCHESS_TB_DRAW,
+	TTCHESS_TB_WIN,
+	TTCHESS_TB_LOSS,
+} ttchess_tb_value_t;
+
+// Game theoretic values of every position without statues where each player
+// has at most `max_pawns` pawns left, on board or in reserve.
+//
+// Encoded as:
+//
+// - 4 bytes: "TTTB"
+// - u8: TTCHESS_TB_VERSION
+// - u8: max_pawns
+// - u16: unused, 0
+// - u64: number of entries
+// - 2 bits per entry: ttchess_tb_value_t for the player to move, 4 entries
+//   per byte starting from the low bits
+//
+// All integers are little endian.
+// The file is meant to be memory mapped and read in place.
+typedef struct {
+	int max_pawns;
+	uint64_t num_entries;
+	const uint8_t* values;
+} ttchess_tb_t;
+
+uint64_t
+ttchess_tb_num_entries(int max_pawns);
+
+// Maps a position to its entry.
+// Pawns of the same color are interchangeable so positions that only differ
+// by pawn ids share one entry.
+// Returns false when the position is not covered.
+bool
+ttchess_tb_index(int max_pawns, const ttchess_state_t* state, uint64_t* index);
+
+// Reverse of ttchess_tb_index.
+// Returns false when the entry does not describe a position that can occur
+// in a game, such as two pawns on the same cell.
+bool
+ttchess_tb_state(int max_pawns, uint64_t index, ttchess_state_t* state);
+
+size_t
+ttchess_tb_encoded_size(int max_pawns);
+
+// `values` has one ttchess_tb_value_t per entry
+void
+ttchess_tb_encode(int max_pawns, const uint8_t* values, uint8_t* out);
+
+// Validates the header, `data` must outlive `tb`
+bool
+ttchess_tb_open(ttchess_tb_t* tb, const void* data, size_t size);
+
+// Games that are already won are not covered
+ttchess_tb_value_t
+ttchess_tb_probe(const ttchess_tb_t* tb, const ttchess_state_t* state);
+
+#endif
@@ -0,0 +1,4 @@
+// Headless tools do not link with bgame so they need their own copy
+#define BLIB_IMPLEMENTATION
+#define BSERIAL_MEM
+#include <bserial.h>
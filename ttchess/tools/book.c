@@ -0,0 +1,509 @@
+// Builds a ttchess opening book by exhaustive search of the first turns.
+//
+// Usage: ttchess-book [-d turns] [-s 0|1] [-j threads] [-w weights] [-o file]
+//
+// -d: Number of turns to explore from the start (default: 4)
+// -s: Only build for games with or without statues (default: both)
+// -j: Number of worker threads (default: 4)
+// -w: Evaluation weights for the leaves (default: ttchess_eval_default_weights)
+// -o: Output file (default: ttchess.book)
+//
+// Every position within the first turns gets its minimax move, with leaves
+// scored by ttchess_evaluate. The positions after the first turn are shared
+// between the threads and the first turn is finished from their results.
+
+#include "../ttchess.h"
+#include "../book.h"
+#include "../eval.h"
+#include "../search.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _WIN32
+#	define BOOK_HAS_MMAP 0
+#else
+#	define BOOK_HAS_MMAP 1
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#define BOOK_MAX_TURNS 8
+#define BOOK_INITIAL_TABLE_SIZE_LOG2 12
+
+#define BOOK_DEFAULT_TURNS 4
+#define BOOK_DEFAULT_THREADS 4
+
+typedef struct {
+	uint64_t key;
+	ttchess_move_t move;
+	// Wins count plies from this position so transpositions reached at
+	// another ply can reuse them
+	int score;
+	// Number of turns searched below
+	int turns;
+} book_node_t;
+
+// Searched positions so transpositions are only explored once
+typedef struct {
+	int num_nodes;
+	int nodes_capacity;
+	book_node_t* nodes;
+
+	// Open addressing, node index + 1 with 0 for empty slots
+	int table_size_log2;
+	uint32_t* table;
+} book_memo_t;
+
+typedef struct {
+	ttchess_state_t state;
+	int turns;
+	int ply;
+} book_task_t;
+
+typedef struct {
+	ttchess_eval_weights_t weights;
+
+	int num_tasks;
+	int tasks_capacity;
+	book_task_t* tasks;
+	atomic_int next_task;
+	atomic_bool out_of_memory;
+} book_ctx_t;
+
+typedef struct {
+	book_ctx_t* ctx;
+	book_memo_t memo;
+} book_worker_t;
+
+static double
+book_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void
+book_memo_cleanup(book_memo_t* memo) {
+	free(memo->nodes);
+	free(memo->table);
+	*memo = (book_memo_t){ 0 };
+}
+
+static inline uint32_t*
+book_memo_slot(const book_memo_t* memo, uint64_t key) {
+	uint32_t mask = (1u << memo->table_size_log2) - 1;
+	uint32_t slot = (uint32_t)(key >> 32) & mask;
+	while (
+		memo->table[slot] != 0
+		&& memo->nodes[memo->table[slot] - 1].key != key
+	) {
+		slot = (slot + 1) & mask;
+	}
+	return &memo->table[slot];
+}
+
+static book_node_t*
+book_memo_find(const book_memo_t* memo, uint64_t key) {
+	if (memo->table == NULL) { return NULL; }
+
+	uint32_t index = *book_memo_slot(memo, key);
+	return index != 0 ? &memo->nodes[index - 1] : NULL;
+}
+
+static bool
+book_memo_store(book_memo_t* memo, const book_node_t* node) {
+	book_node_t* existing = book_memo_find(memo, node->key);
+	if (existing != NULL) {
+		if (node->turns > existing->turns) { *existing = *node; }
+		return true;
+	}
+
+	if (memo->num_nodes + 1 > memo->nodes_capacity) {
+		int new_capacity = memo->nodes_capacity > 0 ? memo->nodes_capacity * 2 : 1024;
+		book_node_t* new_nodes = realloc(memo->nodes, sizeof(book_node_t) * (size_t)new_capacity);
+		if (new_nodes == NULL) { return false; }
+		memo->nodes = new_nodes;
+		memo->nodes_capacity = new_capacity;
+	}
+
+	// Keep the table at most half full
+	if (memo->table == NULL || (memo->num_nodes + 1) * 2 > (1 << memo->table_size_log2)) {
+		int new_size_log2 = memo->table != NULL
+			? memo->table_size_log2 + 1
+			: BOOK_INITIAL_TABLE_SIZE_LOG2;
+		uint32_t* new_table = calloc((size_t)1 << new_size_log2, sizeof(uint32_t));
+		if (new_table == NULL) { return false; }
+
+		free(memo->table);
+		memo->table = new_table;
+		memo->table_size_log2 = new_size_log2;
+		for (int i = 0; i < memo->num_nodes; ++i) {
+			*book_memo_slot(memo, memo->nodes[i].key) = (uint32_t)i + 1;
+		}
+	}
+
+	memo->nodes[memo->num_nodes] = *node;
+	*book_memo_slot(memo, node->key) = (uint32_t)++memo->num_nodes;
+	return true;
+}
+
+static int
+book_evaluate(const book_ctx_t* ctx, const ttchess_state_t* state) {
+	int score = ttchess_evaluate(state, &ctx->weights);
+	if (score >= TTCHESS_SEARCH_WIN_BOUND) { score = TTCHESS_SEARCH_WIN_BOUND - 1; }
+	if (score <= -TTCHESS_SEARCH_WIN_BOUND) { score = -TTCHESS_SEARCH_WIN_BOUND + 1; }
+	return score;
+}
+
+static inline int
+book_score_to_memo(int score, int ply) {
+	if (score >= TTCHESS_SEARCH_WIN_BOUND) { return score + ply; }
+	if (score <= -TTCHESS_SEARCH_WIN_BOUND) { return score - ply; }
+	return score;
+}
+
+static inline int
+book_score_from_memo(int score, int ply) {
+	if (score >= TTCHESS_SEARCH_WIN_BOUND) { return score - ply; }
+	if (score <= -TTCHESS_SEARCH_WIN_BOUND) { return score + ply; }
+	return score;
+}
+
+// A skipped turn gives the move back to the same player so the color alone
+// does not tell turns apart
+static inline bool
+book_turn_ended(const ttchess_state_t* next_state) {
+	return next_state->phase.action == TTCHESS_ACTION_FIRST;
+}
+
+// Minimax over the next `turns` turns, from the point of view of the player
+// to move
+static int
+book_search(book_ctx_t* ctx, book_memo_t* memo, const ttchess_state_t* state, int turns, int ply) {
+	if (turns == 0) { return book_evaluate(ctx, state); }
+
+	uint64_t key = ttchess_book_key(state);
+	const book_node_t* node = book_memo_find(memo, key);
+	if (node != NULL && node->turns >= turns) { return book_score_from_memo(node->score, ply); }
+
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	if (num_moves == 0) { return book_evaluate(ctx, state); }
+
+	book_node_t best = {
+		.key = key,
+		.score = -TTCHESS_SEARCH_WIN - 1,
+		.turns = turns,
+	};
+	for (int i = 0; i < num_moves; ++i) {
+		ttchess_state_t next_state = *state;
+		ttchess_apply_move(&next_state, moves[i]);
+
+		int score;
+		if (next_state.phase.action == TTCHESS_ACTION_WON) {
+			// Prefer the fastest win
+			score = next_state.phase.color == state->phase.color
+				? TTCHESS_SEARCH_WIN - (ply + 1)
+				: -(TTCHESS_SEARCH_WIN - (ply + 1));
+		} else {
+			score = book_search(
+				ctx, memo, &next_state,
+				book_turn_ended(&next_state) ? turns - 1 : turns,
+				ply + 1
+			);
+			if (next_state.phase.color != state->phase.color) { score = -score; }
+		}
+
+		if (score > best.score) {
+			best.score = score;
+			best.move = moves[i];
+		}
+	}
+
+	int score = best.score;
+	best.score = book_score_to_memo(score, ply);
+	if (!book_memo_store(memo, &best)) {
+		atomic_store(&ctx->out_of_memory, true);
+	}
+	return score;
+}
+
+static bool
+book_add_task(book_ctx_t* ctx, const ttchess_state_t* state, int turns, int ply) {
+	// The same position can be reached in several ways
+	uint64_t key = ttchess_book_key(state);
+	for (int i = 0; i < ctx->num_tasks; ++i) {
+		if (ttchess_book_key(&ctx->tasks[i].state) == key) { return true; }
+	}
+
+	if (ctx->num_tasks + 1 > ctx->tasks_capacity) {
+		int new_capacity = ctx->tasks_capacity > 0 ? ctx->tasks_capacity * 2 : 256;
+		book_task_t* new_tasks = realloc(ctx->tasks, sizeof(book_task_t) * (size_t)new_capacity);
+		if (new_tasks == NULL) { return false; }
+		ctx->tasks = new_tasks;
+		ctx->tasks_capacity = new_capacity;
+	}
+
+	ctx->tasks[ctx->num_tasks++] = (book_task_t){
+		.state = *state,
+		.turns = turns,
+		.ply = ply,
+	};
+	return true;
+}
+
+// Collects the positions at the end of the first turn
+static bool
+book_collect_tasks(book_ctx_t* ctx, const ttchess_state_t* state, int turns, int ply) {
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	for (int i = 0; i < num_moves; ++i) {
+		ttchess_state_t next_state = *state;
+		ttchess_apply_move(&next_state, moves[i]);
+
+		bool ok = true;
+		if (next_state.phase.action == TTCHESS_ACTION_WON) {
+			continue;
+		} else if (book_turn_ended(&next_state)) {
+			ok = book_add_task(ctx, &next_state, turns - 1, ply + 1);
+		} else {
+			ok = book_collect_tasks(ctx, &next_state, turns, ply + 1);
+		}
+		if (!ok) { return false; }
+	}
+
+	return true;
+}
+
+static int
+book_worker_main(void* userdata) {
+	book_worker_t* worker = userdata;
+	book_ctx_t* ctx = worker->ctx;
+
+	int task_index;
+	while (
+		!atomic_load(&ctx->out_of_memory)
+		&& (task_index = atomic_fetch_add(&ctx->next_task, 1)) < ctx->num_tasks
+	) {
+		const book_task_t* task = &ctx->tasks[task_index];
+		book_search(ctx, &worker->memo, &task->state, task->turns, task->ply);
+	}
+
+	return 0;
+}
+
+static int
+book_compare_nodes(const void* lhs, const void* rhs) {
+	uint64_t lhs_key = ((const book_node_t*)lhs)->key;
+	uint64_t rhs_key = ((const book_node_t*)rhs)->key;
+	return (lhs_key > rhs_key) - (lhs_key < rhs_key);
+}
+
+static bool
+book_check(const char* path, const ttchess_config_t* configs, int num_configs) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return false; }
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+	if (size <= 0) { return false; }
+
+	void* data;
+#if BOOK_HAS_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) { return false; }
+	data = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) { return false; }
+#else
+	data = malloc((size_t)size);
+	file = fopen(path, "rb");
+	bool read_ok = data != NULL && file != NULL && fread(data, (size_t)size, 1, file) == 1;
+	if (file != NULL) { fclose(file); }
+	if (!read_ok) {
+		free(data);
+		return false;
+	}
+#endif
+
+	ttchess_book_t book;
+	bool ok = ttchess_book_open(&book, data, (size_t)size);
+	for (int i = 0; ok && i < num_configs; ++i) {
+		ttchess_state_t state;
+		ttchess_init(&state, configs[i]);
+
+		// Follow the book as far as it goes
+		int num_moves = 0;
+		ttchess_book_entry_t entry;
+		double start = book_now();
+		while (state.phase.action != TTCHESS_ACTION_WON && ttchess_book_lookup(&book, &state, &entry)) {
+			if (num_moves == 0) {
+				printf(
+					"Statues %d: score %d, %.3fus per lookup\n",
+					configs[i].with_statues, entry.score, (book_now() - start) * 1e6
+				);
+			}
+			ttchess_apply_move(&state, entry.move);
+			++num_moves;
+		}
+		printf("Statues %d: %d book moves from the start\n", configs[i].with_statues, num_moves);
+		ok = num_moves > 0;
+	}
+
+#if BOOK_HAS_MMAP
+	munmap(data, (size_t)size);
+#else
+	free(data);
+#endif
+	return ok;
+}
+
+int
+main(int argc, const char** argv) {
+	int num_turns = BOOK_DEFAULT_TURNS;
+	int with_statues = -1;
+	int num_threads = BOOK_DEFAULT_THREADS;
+	const char* weights_path = NULL;
+	const char* output_path = "ttchess.book";
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			num_turns = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			with_statues = atoi(argv[++i]) != 0;
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			num_threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			weights_path = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else {
+			fprintf(
+				stderr,
+				"Usage: %s [-d turns] [-s 0|1] [-j threads] [-w weights] [-o file]\n",
+				argv[0]
+			);
+			return 1;
+		}
+	}
+
+	if (num_turns < 1) { num_turns = 1; }
+	if (num_turns > BOOK_MAX_TURNS) { num_turns = BOOK_MAX_TURNS; }
+	if (num_threads < 1) { num_threads = 1; }
+
+	book_ctx_t ctx = { 0 };
+	if (weights_path == NULL) {
+		ttchess_eval_default_weights(&ctx.weights);
+	} else if (!ttchess_eval_load_weights(&ctx.weights, weights_path)) {
+		fprintf(stderr, "Could not load weights from %s\n", weights_path);
+		return 1;
+	}
+	atomic_init(&ctx.next_task, 0);
+	atomic_init(&ctx.out_of_memory, false);
+
+	ttchess_config_t configs[2];
+	int num_configs = 0;
+	for (int config = 0; config < 2; ++config) {
+		if (with_statues < 0 || with_statues == config) {
+			configs[num_configs++] = (ttchess_config_t){ .with_statues = config != 0 };
+		}
+	}
+
+	double start = book_now();
+	for (int i = 0; i < num_configs; ++i) {
+		ttchess_state_t root;
+		ttchess_init(&root, configs[i]);
+		if (!book_collect_tasks(&ctx, &root, num_turns, 0)) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+	}
+	printf("%d positions after the first turn\n", ctx.num_tasks);
+
+	book_worker_t* workers = calloc((size_t)num_threads, sizeof(book_worker_t));
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (workers == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	int num_started = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		workers[i].ctx = &ctx;
+		if (thrd_create(&threads[i], book_worker_main, &workers[i]) != thrd_success) { break; }
+		++num_started;
+	}
+	if (num_started == 0) {
+		fprintf(stderr, "Could not start any worker\n");
+		return 1;
+	}
+
+	// Merge every worker into one memo then finish the first turn from it
+	book_memo_t memo = { 0 };
+	bool ok = true;
+	for (int i = 0; i < num_started; ++i) {
+		thrd_join(threads[i], NULL);
+		for (int node = 0; ok && node < workers[i].memo.num_nodes; ++node) {
+			ok = book_memo_store(&memo, &workers[i].memo.nodes[node]);
+		}
+		book_memo_cleanup(&workers[i].memo);
+	}
+	free(threads);
+	free(workers);
+	free(ctx.tasks);
+
+	for (int i = 0; ok && i < num_configs; ++i) {
+		ttchess_state_t root;
+		ttchess_init(&root, configs[i]);
+		book_search(&ctx, &memo, &root, num_turns, 0);
+	}
+	if (!ok || atomic_load(&ctx.out_of_memory)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	printf("%d positions in %.3fs\n", memo.num_nodes, book_now() - start);
+
+	qsort(memo.nodes, (size_t)memo.num_nodes, sizeof(book_node_t), book_compare_nodes);
+	ttchess_book_entry_t* entries = malloc(sizeof(ttchess_book_entry_t) * (size_t)memo.num_nodes);
+	size_t size = ttchess_book_encoded_size((uint32_t)memo.num_nodes);
+	uint8_t* encoded = malloc(size);
+	if (entries == NULL || encoded == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < memo.num_nodes; ++i) {
+		entries[i] = (ttchess_book_entry_t){
+			.key = memo.nodes[i].key,
+			.move = memo.nodes[i].move,
+			.score = memo.nodes[i].score,
+		};
+	}
+	ttchess_book_encode(entries, (uint32_t)memo.num_nodes, encoded);
+	free(entries);
+	book_memo_cleanup(&memo);
+
+	FILE* file = fopen(output_path, "wb");
+	bool written = file != NULL && fwrite(encoded, size, 1, file) == 1;
+	written = (file != NULL && fclose(file) == 0) && written;
+	free(encoded);
+	if (!written) {
+		fprintf(stderr, "Could not write %s\n", output_path);
+		return 1;
+	}
+	printf("Wrote %zu bytes to %s\n", size, output_path);
+
+	if (!book_check(output_path, configs, num_configs)) {
+		fprintf(stderr, "Could not read the book back\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,222 @@
+// Walks the ttchess game tree to a fixed depth and reports node counts and
+// throughput.
+//
+// Usage: ttchess-perft [-d depth] [-s 0|1] [-c] [-u]
+//
+// -d: Maximum depth, every depth up to it is reported (default: 9, three full turns)
+// -s: Only run with or without statues (default: both)
+// -c: Cross check the move generator against ttchess_list_moves_reference
+//     and ttchess_apply_move, and the incremental hash against
+//     ttchess_compute_hash at every node. With -u, also checks that
+//     ttchess_unmake_move restores the whole state. Exits with a non-zero code
+//     on any mismatch.
+// -u: Walk the tree with ttchess_make_move/ttchess_unmake_move instead of
+//     copying the state at every node.
+
+#include "../ttchess.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PERFT_DEFAULT_DEPTH 9
+#define PERFT_MAX_REPORTED_ERRORS 16
+
+typedef struct {
+	bool check;
+	bool unmake;
+	uint64_t num_nodes;
+	uint64_t num_errors;
+} perft_ctx_t;
+
+static double
+perft_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void
+perft_report_error(perft_ctx_t* ctx, const char* message, ttchess_move_t move) {
+	if (ctx->num_errors++ < PERFT_MAX_REPORTED_ERRORS) {
+		fprintf(
+			stderr,
+			"%s: type=%d pawn=%d subject=%d pos=(%d, %d)\n",
+			message,
+			move.type, move.pawn_id, move.subject_id, move.pos.x, move.pos.y
+		);
+	}
+}
+
+static void
+perft_check_moves(
+	perft_ctx_t* ctx,
+	const ttchess_state_t* state,
+	const ttchess_move_t* moves,
+	int num_moves
+) {
+	ttchess_move_t reference_moves[TTCHESS_MAX_MOVES];
+	int num_reference_moves = ttchess_list_moves_reference(state, reference_moves, TTCHESS_MAX_MOVES);
+	if (num_reference_moves != num_moves) {
+		fprintf(
+			stderr,
+			"Generated %d moves, reference has %d (action=%d, color=%d)\n",
+			num_moves, num_reference_moves, state->phase.action, state->phase.color
+		);
+		++ctx->num_errors;
+	}
+
+	// Both lists are duplicate free so checking both directions of inclusion
+	// is enough to show they are the same set
+	for (int i = 0; i < num_moves; ++i) {
+		bool found = false;
+		for (int j = 0; j < num_reference_moves && !found; ++j) {
+			found = ttchess_move_equal(moves[i], reference_moves[j]);
+		}
+
+		if (!found) { perft_report_error(ctx, "Illegal move generated", moves[i]); }
+	}
+
+	for (int i = 0; i < num_reference_moves; ++i) {
+		bool found = false;
+		for (int j = 0; j < num_moves && !found; ++j) {
+			found = ttchess_move_equal(reference_moves[i], moves[j]);
+		}
+
+		if (!found) { perft_report_error(ctx, "Legal move not generated", reference_moves[i]); }
+	}
+}
+
+// With unmake, `state` is modified during the walk and restored before returning
+static uint64_t
+perft(perft_ctx_t* ctx, ttchess_state_t* state, int depth) {
+	if (depth == 0) { return 1; }
+
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	if (num_moves > TTCHESS_MAX_MOVES) {
+		fprintf(stderr, "Too many moves: %d\n", num_moves);
+		++ctx->num_errors;
+		num_moves = TTCHESS_MAX_MOVES;
+	}
+
+	if (ctx->check) {
+		perft_check_moves(ctx, state, moves, num_moves);
+
+		if (state->hash != ttchess_compute_hash(state)) {
+			fprintf(
+				stderr,
+				"Incremental hash %016" PRIx64 " differs from recomputed hash %016" PRIx64 "\n",
+				state->hash, ttchess_compute_hash(state)
+			);
+			++ctx->num_errors;
+		}
+	}
+
+	uint64_t num_leaves = 0;
+	if (ctx->unmake) {
+		// Copied as bytes so that memcmp also sees the padding as it was
+		ttchess_state_t before;
+		if (ctx->check) { memcpy(&before, state, sizeof(before)); }
+
+		for (int i = 0; i < num_moves; ++i) {
+			ttchess_undo_t undo;
+			if (!ttchess_make_move(state, moves[i], &undo)) {
+				perft_report_error(ctx, "Generated move was rejected", moves[i]);
+				continue;
+			}
+
+			++ctx->num_nodes;
+			num_leaves += perft(ctx, state, depth - 1);
+			ttchess_unmake_move(state, &undo);
+
+			if (ctx->check && memcmp(&before, state, sizeof(before)) != 0) {
+				perft_report_error(ctx, "Unmake did not restore the state", moves[i]);
+				// Keep walking from the right position
+				memcpy(state, &before, sizeof(before));
+			}
+		}
+	} else {
+		for (int i = 0; i < num_moves; ++i) {
+			ttchess_state_t next_state = *state;
+			if (!ttchess_apply_move(&next_state, moves[i])) {
+				perft_report_error(ctx, "Generated move was rejected", moves[i]);
+				continue;
+			}
+
+			++ctx->num_nodes;
+			num_leaves += perft(ctx, &next_state, depth - 1);
+		}
+	}
+
+	return num_leaves;
+}
+
+static bool
+perft_run(ttchess_config_t config, int max_depth, bool check, bool unmake) {
+	ttchess_state_t state;
+	ttchess_init(&state, config);
+
+	printf("--- with_statues = %s ---\n", config.with_statues ? "true" : "false");
+	printf("%5s %14s %14s %10s %14s\n", "depth", "leaves", "nodes", "time (s)", "nodes/s");
+
+	bool ok = true;
+	for (int depth = 1; depth <= max_depth; ++depth) {
+		perft_ctx_t ctx = { .check = check, .unmake = unmake };
+
+		double start = perft_now();
+		uint64_t num_leaves = perft(&ctx, &state, depth);
+		double elapsed = perft_now() - start;
+
+		printf(
+			"%5d %14" PRIu64 " %14" PRIu64 " %10.3f %14.0f\n",
+			depth,
+			num_leaves,
+			ctx.num_nodes,
+			elapsed,
+			elapsed > 0.0 ? (double)ctx.num_nodes / elapsed : 0.0
+		);
+
+		if (ctx.num_errors > 0) {
+			fprintf(stderr, "%" PRIu64 " error(s) at depth %d\n", ctx.num_errors, depth);
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+int
+main(int argc, const char** argv) {
+	int max_depth = PERFT_DEFAULT_DEPTH;
+	int with_statues = -1;
+	bool check = false;
+	bool unmake = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			max_depth = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			with_statues = atoi(argv[++i]) != 0;
+		} else if (strcmp(argv[i], "-c") == 0) {
+			check = true;
+		} else if (strcmp(argv[i], "-u") == 0) {
+			unmake = true;
+		} else {
+			fprintf(stderr, "Usage: %s [-d depth] [-s 0|1] [-c] [-u]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bool ok = true;
+	if (with_statues != 1) {
+		ok &= perft_run((ttchess_config_t){ .with_statues = false }, max_depth, check, unmake);
+	}
+	if (with_statues != 0) {
+		ok &= perft_run((ttchess_config_t){ .with_statues = true }, max_depth, check, unmake);
+	}
+
+	return ok ? 0 : 1;
+}
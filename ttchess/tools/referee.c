@@ -0,0 +1,645 @@
+// Serves many concurrent ttchess games from one process.
+//
+// Usage: ttchess-referee [-u socket] [-j threads]
+//
+// -u: Listen on this Unix domain socket instead of using stdin and stdout
+// -j: Number of worker threads (default: 4)
+//
+// Games are sharded across the workers by id so every game is only ever
+// touched by one thread and needs no locking.
+//
+// Requests and responses are frames:
+//
+// - u32: size of the rest of the frame
+// - u8: request type or response status
+// - u32: request id, echoed back in the response
+// - u32: game id
+// - payload
+//
+// Requests:
+//
+// - 1 new game: u8 with_statues. The response carries the new game id.
+// - 2 list moves: responds with u8 count and u16 ttchess_move_pack per move
+// - 3 apply move: u16 ttchess_move_pack. Responds with the new ttchess_state_pack.
+// - 4 get state: responds with ttchess_state_pack
+// - 5 snapshot: responds with the output of ttchess_serialize
+// - 6 load game: output of ttchess_serialize. The response carries the new
+//   game id.
+// - 7 delete game
+//
+// Statuses: 0 ok, 1 unknown game, 2 illegal move, 3 malformed request,
+// 4 unknown request, 5 out of memory.
+//
+// All integers are little endian.
+// Responses for different games can come out of order, they are matched to
+// requests by id.
+
+#ifndef _WIN32
+// For fdopen with the extensions turned off
+#	define _POSIX_C_SOURCE 200809L
+#endif
+
+// For bserial_mem_in_t and bserial_mem_out_t
+#define BSERIAL_MEM
+#include "../ttchess.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#ifdef _WIN32
+#	define REFEREE_HAS_SOCKETS 0
+#	include <fcntl.h>
+#	include <io.h>
+#else
+#	define REFEREE_HAS_SOCKETS 1
+#	include <signal.h>
+#	include <sys/socket.h>
+#	include <sys/un.h>
+#	include <unistd.h>
+#endif
+
+#define REFEREE_HEADER_SIZE 13
+// Everything in the frame size after the size itself
+#define REFEREE_FRAME_OVERHEAD (REFEREE_HEADER_SIZE - 4)
+#define REFEREE_MAX_PAYLOAD (1 << 20)
+#define REFEREE_INITIAL_GAMES_LOG2 6
+#define REFEREE_DEFAULT_THREADS 4
+
+typedef enum {
+	REFEREE_REQUEST_NEW_GAME = 1,
+	REFEREE_REQUEST_LIST_MOVES,
+	REFEREE_REQUEST_APPLY_MOVE,
+	REFEREE_REQUEST_GET_STATE,
+	REFEREE_REQUEST_SNAPSHOT,
+	REFEREE_REQUEST_LOAD_GAME,
+	REFEREE_REQUEST_DELETE_GAME,
+} referee_request_type_t;
+
+typedef enum {
+	REFEREE_STATUS_OK = 0,
+	REFEREE_STATUS_UNKNOWN_GAME,
+	REFEREE_STATUS_ILLEGAL_MOVE,
+	REFEREE_STATUS_MALFORMED,
+	REFEREE_STATUS_UNKNOWN_REQUEST,
+	REFEREE_STATUS_OUT_OF_MEMORY,
+} referee_status_t;
+
+static const bserial_ctx_config_t referee_bserial_config = {
+	.max_depth = 16,
+	.max_num_symbols = 256,
+	.max_record_fields = 32,
+	.max_symbol_len = 64,
+};
+
+typedef struct {
+	FILE* in;
+	FILE* out;
+	mtx_t write_mutex;
+	// The reader and every request still in a queue
+	atomic_int num_refs;
+} referee_conn_t;
+
+typedef struct referee_job_s {
+	struct referee_job_s* next;
+	referee_conn_t* conn;
+	uint8_t type;
+	uint32_t request_id;
+	uint32_t game_id;
+	uint32_t payload_size;
+	uint8_t payload[];
+} referee_job_t;
+
+typedef struct {
+	// 0 for empty slots
+	uint32_t id;
+	ttchess_state_t state;
+} referee_game_t;
+
+// Open addressing with linear probing
+typedef struct {
+	int num_games;
+	int size_log2;
+	referee_game_t* slots;
+} referee_games_t;
+
+typedef struct {
+	mtx_t mutex;
+	cnd_t cond;
+	referee_job_t* head;
+	referee_job_t* tail;
+	bool stopping;
+
+	// Only touched by the worker thread
+	referee_games_t games;
+	void* bserial_mem;
+} referee_worker_t;
+
+typedef struct {
+	int num_workers;
+	referee_worker_t* workers;
+	atomic_uint next_game_id;
+} referee_ctx_t;
+
+typedef struct {
+	referee_ctx_t* ctx;
+	referee_conn_t* conn;
+} referee_reader_t;
+
+static inline uint32_t
+referee_read_u32(const uint8_t* in) {
+	return (uint32_t)in[0]
+		| ((uint32_t)in[1] << 8)
+		| ((uint32_t)in[2] << 16)
+		| ((uint32_t)in[3] << 24);
+}
+
+static inline void
+referee_write_u32(uint8_t* out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = (uint8_t)((value >> (i * 8)) & 0xff);
+	}
+}
+
+static inline size_t
+referee_game_slot(uint32_t id, int size_log2) {
+	// Fibonacci hashing since ids are sequential within a shard
+	return (size_t)((id * 2654435769u) >> (32 - size_log2));
+}
+
+static referee_game_t*
+referee_find_game(referee_games_t* games, uint32_t id) {
+	if (games->slots == NULL) { return NULL; }
+
+	size_t mask = ((size_t)1 << games->size_log2) - 1;
+	for (size_t slot = referee_game_slot(id, games->size_log2); ; slot = (slot + 1) & mask) {
+		referee_game_t* game = &games->slots[slot];
+		if (game->id == id) { return game; }
+		if (game->id == 0) { return NULL; }
+	}
+}
+
+static referee_game_t*
+referee_insert_game(referee_games_t* games, uint32_t id) {
+	// Keep the load factor under 1/2
+	if (games->slots == NULL || (games->num_games + 1) * 2 > (1 << games->size_log2)) {
+		int new_size_log2 = games->slots == NULL ? REFEREE_INITIAL_GAMES_LOG2 : games->size_log2 + 1;
+		referee_game_t* new_slots = calloc((size_t)1 << new_size_log2, sizeof(referee_game_t));
+		if (new_slots == NULL) { return NULL; }
+
+		size_t new_mask = ((size_t)1 << new_size_log2) - 1;
+		for (int i = 0; games->slots != NULL && i < (1 << games->size_log2); ++i) {
+			if (games->slots[i].id == 0) { continue; }
+
+			size_t slot = referee_game_slot(games->slots[i].id, new_size_log2);
+			while (new_slots[slot].id != 0) { slot = (slot + 1) & new_mask; }
+			new_slots[slot] = games->slots[i];
+		}
+
+		free(games->slots);
+		games->slots = new_slots;
+		games->size_log2 = new_size_log2;
+	}
+
+	size_t mask = ((size_t)1 << games->size_log2) - 1;
+	size_t slot = referee_game_slot(id, games->size_log2);
+	while (games->slots[slot].id != 0) { slot = (slot + 1) & mask; }
+	games->slots[slot].id = id;
+	games->num_games += 1;
+	return &games->slots[slot];
+}
+
+static void
+referee_delete_game(referee_games_t* games, referee_game_t* game) {
+	// Shift the rest of the cluster back so that probing needs no tombstones
+	size_t mask = ((size_t)1 << games->size_log2) - 1;
+	size_t hole = (size_t)(game - games->slots);
+	for (size_t slot = (hole + 1) & mask; games->slots[slot].id != 0; slot = (slot + 1) & mask) {
+		size_t home = referee_game_slot(games->slots[slot].id, games->size_log2);
+		// Only move entries whose home is not between the hole and their slot
+		bool can_move = hole <= slot
+			? (home <= hole || home > slot)
+			: (home <= hole && home > slot);
+		if (can_move) {
+			games->slots[hole] = games->slots[slot];
+			hole = slot;
+		}
+	}
+
+	games->slots[hole].id = 0;
+	games->num_games -= 1;
+}
+
+static void
+referee_release_conn(referee_conn_t* conn) {
+	if (atomic_fetch_sub(&conn->num_refs, 1) != 1) { return; }
+
+	if (conn->in != stdin) { fclose(conn->in); }
+	if (conn->out != stdout) { fclose(conn->out); }
+	mtx_destroy(&conn->write_mutex);
+	free(conn);
+}
+
+static void
+referee_respond(
+	referee_job_t* job,
+	referee_status_t status,
+	const void* payload,
+	uint32_t payload_size
+) {
+	uint8_t header[REFEREE_HEADER_SIZE];
+	referee_write_u32(header, REFEREE_FRAME_OVERHEAD + payload_size);
+	header[4] = (uint8_t)status;
+	referee_write_u32(header + 5, job->request_id);
+	referee_write_u32(header + 9, job->game_id);
+
+	// Clients that went away are only noticed by the reader
+	referee_conn_t* conn = job->conn;
+	mtx_lock(&conn->write_mutex);
+	fwrite(header, sizeof(header), 1, conn->out);
+	if (payload_size > 0) {
+		fwrite(payload, payload_size, 1, conn->out);
+	}
+	fflush(conn->out);
+	mtx_unlock(&conn->write_mutex);
+}
+
+static void
+referee_respond_state(referee_job_t* job, const ttchess_state_t* state) {
+	uint8_t packed[TTCHESS_PACKED_SIZE];
+	ttchess_state_pack(state, packed);
+	referee_respond(job, REFEREE_STATUS_OK, packed, sizeof(packed));
+}
+
+// ttchess_serialize rejects values out of range and off board pawns, the
+// packed round trip also rejects pieces sharing a cell
+static bool
+referee_validate_state(const ttchess_state_t* state) {
+	uint8_t packed[TTCHESS_PACKED_SIZE];
+	ttchess_state_pack(state, packed);
+	ttchess_state_t unpacked;
+	return ttchess_state_unpack(&unpacked, packed);
+}
+
+static void
+referee_snapshot(referee_worker_t* worker, referee_job_t* job, ttchess_state_t* state) {
+	bserial_mem_out_t mem_out = { 0 };
+	bserial_out_t* out = bserial_mem_init_out(&mem_out, NULL);
+	bserial_ctx_t* ctx = bserial_make_ctx(worker->bserial_mem, referee_bserial_config, NULL, out);
+
+	bserial_status_t status = ttchess_serialize(ctx, state);
+	if (status == BSERIAL_OK) { status = bserial_status(ctx); }
+	if (status == BSERIAL_OK) {
+		referee_respond(job, REFEREE_STATUS_OK, mem_out.mem, (uint32_t)mem_out.len);
+	} else {
+		referee_respond(job, REFEREE_STATUS_OUT_OF_MEMORY, NULL, 0);
+	}
+	free(mem_out.mem);
+}
+
+static void
+referee_load_game(referee_worker_t* worker, referee_job_t* job) {
+	bserial_mem_in_t mem_in;
+	bserial_in_t* in = bserial_mem_init_in(&mem_in, job->payload, job->payload_size);
+	bserial_ctx_t* ctx = bserial_make_ctx(worker->bserial_mem, referee_bserial_config, in, NULL);
+
+	ttchess_state_t state;
+	ttchess_init(&state, (ttchess_config_t){ 0 });
+	bserial_status_t status = ttchess_serialize(ctx, &state);
+	if (status == BSERIAL_OK) { status = bserial_status(ctx); }
+	if (status != BSERIAL_OK || !referee_validate_state(&state)) {
+		referee_respond(job, REFEREE_STATUS_MALFORMED, NULL, 0);
+		return;
+	}
+
+	referee_game_t* game = referee_insert_game(&worker->games, job->game_id);
+	if (game == NULL) {
+		referee_respond(job, REFEREE_STATUS_OUT_OF_MEMORY, NULL, 0);
+		return;
+	}
+
+	game->state = state;
+	referee_respond(job, REFEREE_STATUS_OK, NULL, 0);
+}
+
+static void
+referee_process(referee_worker_t* worker, referee_job_t* job) {
+	if (job->type == REFEREE_REQUEST_NEW_GAME) {
+		if (job->payload_size != 1) {
+			referee_respond(job, REFEREE_STATUS_MALFORMED, NULL, 0);
+			return;
+		}
+
+		referee_game_t* game = referee_insert_game(&worker->games, job->game_id);
+		if (game == NULL) {
+			referee_respond(job, REFEREE_STATUS_OUT_OF_MEMORY, NULL, 0);
+			return;
+		}
+
+		ttchess_init(&game->state, (ttchess_config_t){ .with_statues = job->payload[0] != 0 });
+		referee_respond(job, REFEREE_STATUS_OK, NULL, 0);
+		return;
+	} else if (job->type == REFEREE_REQUEST_LOAD_GAME) {
+		referee_load_game(worker, job);
+		return;
+	}
+
+	referee_game_t* game = referee_find_game(&worker->games, job->game_id);
+	if (game == NULL) {
+		referee_respond(job, REFEREE_STATUS_UNKNOWN_GAME, NULL, 0);
+		return;
+	}
+
+	switch ((referee_request_type_t)job->type) {
+		case REFEREE_REQUEST_LIST_MOVES: {
+			ttchess_move_t moves[TTCHESS_MAX_MOVES];
+			int num_moves = ttchess_list_moves(&game->state, moves, TTCHESS_MAX_MOVES);
+
+			uint8_t payload[1 + TTCHESS_MAX_MOVES * 2];
+			payload[0] = (uint8_t)num_moves;
+			for (int i = 0; i < num_moves; ++i) {
+				uint16_t packed = ttchess_move_pack(moves[i]);
+				payload[1 + i * 2] = (uint8_t)(packed & 0xff);
+				payload[2 + i * 2] = (uint8_t)(packed >> 8);
+			}
+			referee_respond(job, REFEREE_STATUS_OK, payload, (uint32_t)(1 + num_moves * 2));
+		} break;
+		case REFEREE_REQUEST_APPLY_MOVE: {
+			if (job->payload_size != 2) {
+				referee_respond(job, REFEREE_STATUS_MALFORMED, NULL, 0);
+				break;
+			}
+
+			uint16_t packed = (uint16_t)(job->payload[0] | (job->payload[1] << 8));
+			if (ttchess_apply_move(&game->state, ttchess_move_unpack(packed))) {
+				referee_respond_state(job, &game->state);
+			} else {
+				referee_respond(job, REFEREE_STATUS_ILLEGAL_MOVE, NULL, 0);
+			}
+		} break;
+		case REFEREE_REQUEST_GET_STATE:
+			referee_respond_state(job, &game->state);
+			break;
+		case REFEREE_REQUEST_SNAPSHOT:
+			referee_snapshot(worker, job, &game->state);
+			break;
+		case REFEREE_REQUEST_DELETE_GAME:
+			referee_delete_game(&worker->games, game);
+			referee_respond(job, REFEREE_STATUS_OK, NULL, 0);
+			break;
+		default:
+			referee_respond(job, REFEREE_STATUS_UNKNOWN_REQUEST, NULL, 0);
+			break;
+	}
+}
+
+static int
+referee_worker_main(void* userdata) {
+	referee_worker_t* worker = userdata;
+
+	while (true) {
+		mtx_lock(&worker->mutex);
+		while (worker->head == NULL && !worker->stopping) {
+			cnd_wait(&worker->cond, &worker->mutex);
+		}
+		// Take the whole queue at once to keep the lock short
+		referee_job_t* jobs = worker->head;
+		worker->head = worker->tail = NULL;
+		bool stopping = worker->stopping;
+		mtx_unlock(&worker->mutex);
+
+		if (jobs == NULL && stopping) { break; }
+
+		while (jobs != NULL) {
+			referee_job_t* next = jobs->next;
+			referee_process(worker, jobs);
+			referee_release_conn(jobs->conn);
+			free(jobs);
+			jobs = next;
+		}
+	}
+
+	return 0;
+}
+
+static void
+referee_submit(referee_ctx_t* ctx, referee_job_t* job) {
+	referee_worker_t* worker = &ctx->workers[job->game_id % (uint32_t)ctx->num_workers];
+
+	atomic_fetch_add(&job->conn->num_refs, 1);
+	mtx_lock(&worker->mutex);
+	if (worker->tail != NULL) {
+		worker->tail->next = job;
+	} else {
+		worker->head = job;
+	}
+	worker->tail = job;
+	cnd_signal(&worker->cond);
+	mtx_unlock(&worker->mutex);
+}
+
+// Reads requests until the connection closes or sends a malformed frame
+static void
+referee_serve(referee_ctx_t* ctx, referee_conn_t* conn) {
+	uint8_t header[REFEREE_HEADER_SIZE];
+	while (fread(header, sizeof(header), 1, conn->in) == 1) {
+		uint32_t frame_size = referee_read_u32(header);
+		if (frame_size < REFEREE_FRAME_OVERHEAD || frame_size - REFEREE_FRAME_OVERHEAD > REFEREE_MAX_PAYLOAD) {
+			break;
+		}
+
+		uint32_t payload_size = frame_size - REFEREE_FRAME_OVERHEAD;
+		referee_job_t* job = malloc(sizeof(referee_job_t) + payload_size);
+		if (job == NULL) { break; }
+
+		*job = (referee_job_t){
+			.conn = conn,
+			.type = header[4],
+			.request_id = referee_read_u32(header + 5),
+			.game_id = referee_read_u32(header + 9),
+			.payload_size = payload_size,
+		};
+		if (payload_size > 0 && fread(job->payload, payload_size, 1, conn->in) != 1) {
+			free(job);
+			break;
+		}
+
+		if (job->type == REFEREE_REQUEST_NEW_GAME || job->type == REFEREE_REQUEST_LOAD_GAME) {
+			// 0 is never a valid id
+			uint32_t game_id;
+			do {
+				game_id = atomic_fetch_add(&ctx->next_game_id, 1);
+			} while (game_id == 0);
+			job->game_id = game_id;
+		}
+
+		referee_submit(ctx, job);
+	}
+}
+
+#if REFEREE_HAS_SOCKETS
+
+static int
+referee_reader_main(void* userdata) {
+	referee_reader_t* reader = userdata;
+	referee_serve(reader->ctx, reader->conn);
+	referee_release_conn(reader->conn);
+	free(reader);
+	return 0;
+}
+
+static int
+referee_listen(referee_ctx_t* ctx, const char* socket_path) {
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path is too long: %s\n", socket_path);
+		return 1;
+	}
+	strcpy(addr.sun_path, socket_path);
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	// Left behind by a previous run
+	unlink(socket_path);
+	if (
+		bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0
+		|| listen(listen_fd, SOMAXCONN) != 0
+	) {
+		perror(socket_path);
+		close(listen_fd);
+		return 1;
+	}
+
+	// Writes to a client that went away should fail instead of killing us
+	signal(SIGPIPE, SIG_IGN);
+	fprintf(stderr, "Listening on %s\n", socket_path);
+
+	while (true) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) { continue; }
+
+		int out_fd = dup(fd);
+		referee_conn_t* conn = malloc(sizeof(referee_conn_t));
+		referee_reader_t* reader = malloc(sizeof(referee_reader_t));
+		FILE* in = fdopen(fd, "rb");
+		FILE* out = out_fd >= 0 ? fdopen(out_fd, "wb") : NULL;
+		if (conn == NULL || reader == NULL || in == NULL || out == NULL) {
+			free(conn);
+			free(reader);
+			if (in != NULL) { fclose(in); } else { close(fd); }
+			if (out != NULL) { fclose(out); } else if (out_fd >= 0) { close(out_fd); }
+			continue;
+		}
+
+		*conn = (referee_conn_t){ .in = in, .out = out };
+		mtx_init(&conn->write_mutex, mtx_plain);
+		atomic_init(&conn->num_refs, 1);
+		*reader = (referee_reader_t){ .ctx = ctx, .conn = conn };
+
+		thrd_t thread;
+		if (thrd_create(&thread, referee_reader_main, reader) != thrd_success) {
+			referee_release_conn(conn);
+			free(reader);
+			continue;
+		}
+		thrd_detach(thread);
+	}
+}
+
+#endif
+
+int
+main(int argc, const char** argv) {
+	const char* socket_path = NULL;
+	int num_threads = REFEREE_DEFAULT_THREADS;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-u") == 0 && i + 1 < argc && REFEREE_HAS_SOCKETS) {
+			socket_path = argv[++i];
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			num_threads = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Usage: %s [-u socket] [-j threads]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (num_threads < 1) { num_threads = 1; }
+
+	referee_ctx_t ctx = {
+		.num_workers = num_threads,
+		.workers = calloc((size_t)num_threads, sizeof(referee_worker_t)),
+	};
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (ctx.workers == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	atomic_init(&ctx.next_game_id, 1);
+
+	for (int i = 0; i < num_threads; ++i) {
+		referee_worker_t* worker = &ctx.workers[i];
+		mtx_init(&worker->mutex, mtx_plain);
+		cnd_init(&worker->cond);
+		worker->bserial_mem = malloc(bserial_ctx_mem_size(referee_bserial_config));
+		if (
+			worker->bserial_mem == NULL
+			|| thrd_create(&threads[i], referee_worker_main, worker) != thrd_success
+		) {
+			fprintf(stderr, "Could not start worker %d\n", i);
+			return 1;
+		}
+	}
+
+	int exit_code = 0;
+#if REFEREE_HAS_SOCKETS
+	if (socket_path != NULL) {
+		// Only returns on error
+		exit_code = referee_listen(&ctx, socket_path);
+	} else
+#endif
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		referee_conn_t* conn = malloc(sizeof(referee_conn_t));
+		if (conn == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		*conn = (referee_conn_t){ .in = stdin, .out = stdout };
+		mtx_init(&conn->write_mutex, mtx_plain);
+		atomic_init(&conn->num_refs, 1);
+
+		referee_serve(&ctx, conn);
+		referee_release_conn(conn);
+	}
+
+	// Let the workers finish what was already submitted
+	for (int i = 0; i < num_threads; ++i) {
+		referee_worker_t* worker = &ctx.workers[i];
+		mtx_lock(&worker->mutex);
+		worker->stopping = true;
+		cnd_signal(&worker->cond);
+		mtx_unlock(&worker->mutex);
+	}
+	for (int i = 0; i < num_threads; ++i) {
+		referee_worker_t* worker = &ctx.workers[i];
+		thrd_join(threads[i], NULL);
+		free(worker->games.slots);
+		free(worker->bserial_mem);
+		cnd_destroy(&worker->cond);
+		mtx_destroy(&worker->mutex);
+	}
+	free(threads);
+	free(ctx.workers);
+
+	return exit_code;
+}
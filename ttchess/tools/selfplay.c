@@ -0,0 +1,424 @@
+// Plays ttchess games between two engines and reports results.
+//
+// Usage: ttchess-selfplay [-a engine] [-b engine] [-n games] [-j threads]
+//                         [-s 0|1] [-x] [-l max_length] [-o log] [-S stats]
+//
+// -a, -b: Engines for the two players (default: random).
+//         White is `a` unless -x is given.
+//         random:           Uniformly random legal moves
+//         alphabeta[:nodes[:weights]]
+//                           ttchess_search with a node budget (default: 10000)
+//                           and evaluation weights loaded from a file
+//         mcts[:playouts]   ttchess_mcts_search with a playout budget (default: 1000)
+// -n: Number of games (default: 1000)
+// -j: Number of worker threads, each plays one game at a time (default: 4)
+// -s: Only play with or without statues (default: alternate)
+// -x: Swap colors every other game
+// -l: Games longer than this many actions are draws (default: 600)
+// -o: Append every game to this log
+// -S: Append the rules counters of the run to this file as one JSON line.
+//     They are only collected when built with TTCHESS_STATS.
+//
+// The log starts with the 4 bytes "TTSP" and a version byte. Each game is:
+//
+// - u8: flags, bit 0 is `with_statues`, bit 1 is set when engine `b` played
+//   white
+// - u8: winner, 0 for white, 1 for black, 2 for a draw
+// - u16: number of moves
+// - u16 per move: ttchess_move_pack
+//
+// All integers are little endian.
+
+#include "../ttchess.h"
+#include "../eval.h"
+#include "../mcts.h"
+#include "../search.h"
+#include "../stats.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define SELFPLAY_LOG_MAGIC "TTSP"
+#define SELFPLAY_LOG_VERSION 1
+#define SELFPLAY_FLAG_WITH_STATUES 0x01
+#define SELFPLAY_FLAG_SWAPPED 0x02
+#define SELFPLAY_DRAW 2
+#define SELFPLAY_TT_SIZE_LOG2 18
+
+#define SELFPLAY_DEFAULT_GAMES 1000
+#define SELFPLAY_DEFAULT_THREADS 4
+#define SELFPLAY_DEFAULT_MAX_LENGTH 600
+#define SELFPLAY_DEFAULT_NODES 10000
+#define SELFPLAY_DEFAULT_PLAYOUTS 1000
+
+typedef enum {
+	SELFPLAY_ENGINE_RANDOM,
+	SELFPLAY_ENGINE_ALPHABETA,
+	SELFPLAY_ENGINE_MCTS,
+} selfplay_engine_type_t;
+
+typedef struct {
+	selfplay_engine_type_t type;
+	uint64_t budget;
+	ttchess_eval_weights_t weights;
+} selfplay_engine_t;
+
+typedef struct {
+	selfplay_engine_t engines[2];
+	int num_games;
+	int with_statues;
+	bool swap_colors;
+	int max_length;
+
+	FILE* log;
+	mtx_t log_mutex;
+
+	atomic_int next_game;
+	// Indexed by engine, then SELFPLAY_DRAW for draws
+	atomic_int num_wins[3];
+	atomic_int num_white_wins;
+	atomic_int num_black_wins;
+	atomic_uint_fast64_t total_length;
+} selfplay_ctx_t;
+
+typedef struct {
+	selfplay_ctx_t* ctx;
+	ttchess_tt_t* tt;
+	uint64_t rng;
+	uint16_t moves[UINT16_MAX];
+} selfplay_worker_t;
+
+static double
+selfplay_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t
+selfplay_random(selfplay_worker_t* worker, uint32_t bound) {
+	// xorshift64*
+	worker->rng ^= worker->rng >> 12;
+	worker->rng ^= worker->rng << 25;
+	worker->rng ^= worker->rng >> 27;
+	uint64_t value = worker->rng * 0x2545f4914f6cdd1dull;
+	return (uint32_t)(((value >> 32) * bound) >> 32);
+}
+
+static bool
+selfplay_parse_engine(const char* spec, selfplay_engine_t* engine) {
+	const char* separator = strchr(spec, ':');
+	size_t name_len = separator != NULL ? (size_t)(separator - spec) : strlen(spec);
+	char* budget_end = NULL;
+	uint64_t budget = separator != NULL ? strtoull(separator + 1, &budget_end, 10) : 0;
+	const char* weights_path = budget_end != NULL && *budget_end == ':' ? budget_end + 1 : NULL;
+
+	if (name_len == strlen("random") && strncmp(spec, "random", name_len) == 0) {
+		*engine = (selfplay_engine_t){ .type = SELFPLAY_ENGINE_RANDOM };
+	} else if (name_len == strlen("alphabeta") && strncmp(spec, "alphabeta", name_len) == 0) {
+		*engine = (selfplay_engine_t){
+			.type = SELFPLAY_ENGINE_ALPHABETA,
+			.budget = budget > 0 ? budget : SELFPLAY_DEFAULT_NODES,
+		};
+		if (weights_path == NULL) {
+			ttchess_eval_default_weights(&engine->weights);
+		} else if (!ttchess_eval_load_weights(&engine->weights, weights_path)) {
+			fprintf(stderr, "Could not load weights from %s\n", weights_path);
+			return false;
+		}
+	} else if (name_len == strlen("mcts") && strncmp(spec, "mcts", name_len) == 0) {
+		*engine = (selfplay_engine_t){
+			.type = SELFPLAY_ENGINE_MCTS,
+			.budget = budget > 0 ? budget : SELFPLAY_DEFAULT_PLAYOUTS,
+		};
+	} else {
+		fprintf(stderr, "Unknown engine: %s\n", spec);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+selfplay_pick_move(
+	selfplay_worker_t* worker,
+	const selfplay_engine_t* engine,
+	const ttchess_state_t* state,
+	ttchess_move_t* move
+) {
+	switch (engine->type) {
+		case SELFPLAY_ENGINE_RANDOM: {
+			ttchess_move_t moves[TTCHESS_MAX_MOVES];
+			int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+			if (num_moves == 0) { return false; }
+
+			*move = moves[selfplay_random(worker, (uint32_t)num_moves)];
+			return true;
+		}
+		case SELFPLAY_ENGINE_ALPHABETA: {
+			ttchess_search_result_t result;
+			bool found = ttchess_search(state, worker->tt, (ttchess_search_config_t){
+				.node_limit = engine->budget,
+				.weights = &engine->weights,
+			}, &result);
+			*move = result.best_move;
+			return found;
+		}
+		case SELFPLAY_ENGINE_MCTS: {
+			ttchess_mcts_result_t result;
+			bool found = ttchess_mcts_search(state, (ttchess_mcts_config_t){
+				.max_playouts = engine->budget,
+				.seed = selfplay_random(worker, UINT32_MAX),
+			}, &result);
+			*move = result.best_move;
+			return found;
+		}
+	}
+
+	return false;
+}
+
+static void
+selfplay_write_u16(uint8_t* out, uint16_t value) {
+	out[0] = (uint8_t)(value & 0xff);
+	out[1] = (uint8_t)(value >> 8);
+}
+
+static void
+selfplay_log_game(
+	selfplay_worker_t* worker,
+	uint8_t flags,
+	uint8_t winner,
+	int num_moves
+) {
+	selfplay_ctx_t* ctx = worker->ctx;
+	if (ctx->log == NULL) { return; }
+
+	// Encode outside of the lock, the moves are rewritten in place
+	uint8_t header[4] = { flags, winner };
+	selfplay_write_u16(header + 2, (uint16_t)num_moves);
+	for (int i = 0; i < num_moves; ++i) {
+		uint16_t move = worker->moves[i];
+		selfplay_write_u16((uint8_t*)&worker->moves[i], move);
+	}
+
+	mtx_lock(&ctx->log_mutex);
+	fwrite(header, sizeof(header), 1, ctx->log);
+	fwrite(worker->moves, sizeof(uint16_t), (size_t)num_moves, ctx->log);
+	mtx_unlock(&ctx->log_mutex);
+}
+
+static void
+selfplay_play_game(selfplay_worker_t* worker, int game_index) {
+	selfplay_ctx_t* ctx = worker->ctx;
+
+	bool with_statues = ctx->with_statues >= 0
+		? ctx->with_statues != 0
+		: (game_index & 1) != 0;
+	// With alternating statues, swap every other pair so both engines get
+	// both colors in both configurations
+	bool swapped = ctx->swap_colors
+		&& (ctx->with_statues >= 0 ? (game_index & 1) != 0 : (game_index & 2) != 0);
+
+	ttchess_state_t state;
+	ttchess_init(&state, (ttchess_config_t){ .with_statues = with_statues });
+	if (worker->tt != NULL) { ttchess_tt_clear(worker->tt); }
+
+	int num_moves = 0;
+	while (state.phase.action != TTCHESS_ACTION_WON && num_moves < ctx->max_length) {
+		int engine_index = (state.phase.color == TTCHESS_COLOR_WHITE) != swapped ? 0 : 1;
+
+		ttchess_move_t move;
+		if (!selfplay_pick_move(worker, &ctx->engines[engine_index], &state, &move)) { break; }
+		if (!ttchess_apply_move(&state, move)) {
+			fprintf(stderr, "Engine %c picked an illegal move\n", 'a' + engine_index);
+			break;
+		}
+
+		worker->moves[num_moves++] = ttchess_move_pack(move);
+	}
+
+	uint8_t winner = SELFPLAY_DRAW;
+	if (state.phase.action == TTCHESS_ACTION_WON) {
+		winner = (uint8_t)state.phase.color;
+		int engine_index = (state.phase.color == TTCHESS_COLOR_WHITE) != swapped ? 0 : 1;
+		atomic_fetch_add(&ctx->num_wins[engine_index], 1);
+		atomic_fetch_add(
+			state.phase.color == TTCHESS_COLOR_WHITE ? &ctx->num_white_wins : &ctx->num_black_wins,
+			1
+		);
+	} else {
+		atomic_fetch_add(&ctx->num_wins[SELFPLAY_DRAW], 1);
+	}
+	atomic_fetch_add(&ctx->total_length, (uint_fast64_t)num_moves);
+
+	uint8_t flags = (with_statues ? SELFPLAY_FLAG_WITH_STATUES : 0)
+		| (swapped ? SELFPLAY_FLAG_SWAPPED : 0);
+	selfplay_log_game(worker, flags, winner, num_moves);
+}
+
+static int
+selfplay_worker_main(void* userdata) {
+	selfplay_worker_t* worker = userdata;
+	selfplay_ctx_t* ctx = worker->ctx;
+
+	int game_index;
+	while ((game_index = atomic_fetch_add(&ctx->next_game, 1)) < ctx->num_games) {
+		selfplay_play_game(worker, game_index);
+	}
+
+	return 0;
+}
+
+int
+main(int argc, const char** argv) {
+	selfplay_ctx_t ctx = {
+		.num_games = SELFPLAY_DEFAULT_GAMES,
+		.with_statues = -1,
+		.max_length = SELFPLAY_DEFAULT_MAX_LENGTH,
+	};
+	int num_threads = SELFPLAY_DEFAULT_THREADS;
+	const char* log_path = NULL;
+	const char* stats_path = NULL;
+	const char* engine_specs[2] = { "random", "random" };
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			engine_specs[0] = argv[++i];
+			if (!selfplay_parse_engine(engine_specs[0], &ctx.engines[0])) { return 1; }
+		} else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			engine_specs[1] = argv[++i];
+			if (!selfplay_parse_engine(engine_specs[1], &ctx.engines[1])) { return 1; }
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			ctx.num_games = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			num_threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			ctx.with_statues = atoi(argv[++i]) != 0;
+		} else if (strcmp(argv[i], "-x") == 0) {
+			ctx.swap_colors = true;
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			ctx.max_length = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			log_path = argv[++i];
+		} else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+			stats_path = argv[++i];
+		} else {
+			fprintf(
+				stderr,
+				"Usage: %s [-a engine] [-b engine] [-n games] [-j threads] [-s 0|1] [-x] [-l max_length] [-o log] [-S stats]\n",
+				argv[0]
+			);
+			return 1;
+		}
+	}
+
+	if (num_threads < 1) { num_threads = 1; }
+	if (ctx.max_length < 1 || ctx.max_length > UINT16_MAX) { ctx.max_length = UINT16_MAX; }
+
+	if (log_path != NULL) {
+		ctx.log = fopen(log_path, "ab");
+		if (ctx.log == NULL) {
+			fprintf(stderr, "Could not open %s\n", log_path);
+			return 1;
+		}
+
+		// A fresh file gets a header, appends continue the existing stream
+		fseek(ctx.log, 0, SEEK_END);
+		if (ftell(ctx.log) == 0) {
+			fwrite(SELFPLAY_LOG_MAGIC, 4, 1, ctx.log);
+			fputc(SELFPLAY_LOG_VERSION, ctx.log);
+		}
+	}
+	mtx_init(&ctx.log_mutex, mtx_plain);
+	atomic_init(&ctx.next_game, 0);
+	for (int i = 0; i < 3; ++i) { atomic_init(&ctx.num_wins[i], 0); }
+	atomic_init(&ctx.num_white_wins, 0);
+	atomic_init(&ctx.num_black_wins, 0);
+	atomic_init(&ctx.total_length, 0);
+
+	bool needs_tt = ctx.engines[0].type == SELFPLAY_ENGINE_ALPHABETA
+		|| ctx.engines[1].type == SELFPLAY_ENGINE_ALPHABETA;
+	selfplay_worker_t* workers = calloc((size_t)num_threads, sizeof(selfplay_worker_t));
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (workers == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	ttchess_stats_reset();
+	double start = selfplay_now();
+	int num_started = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		selfplay_worker_t* worker = &workers[i];
+		worker->ctx = &ctx;
+		worker->rng = ((uint64_t)i + 1) * 0x9e3779b97f4a7c15ull;
+		if (needs_tt) {
+			void* mem = malloc(ttchess_tt_mem_size(SELFPLAY_TT_SIZE_LOG2));
+			if (mem == NULL) { break; }
+			worker->tt = ttchess_tt_init(mem, SELFPLAY_TT_SIZE_LOG2);
+		}
+
+		if (thrd_create(&threads[i], selfplay_worker_main, worker) != thrd_success) {
+			free(worker->tt);
+			break;
+		}
+		++num_started;
+	}
+	if (num_started == 0) {
+		fprintf(stderr, "Could not start any worker\n");
+		return 1;
+	}
+
+	for (int i = 0; i < num_started; ++i) {
+		thrd_join(threads[i], NULL);
+		free(workers[i].tt);
+	}
+	double elapsed = selfplay_now() - start;
+
+	if (ctx.log != NULL) { fclose(ctx.log); }
+	mtx_destroy(&ctx.log_mutex);
+	free(threads);
+	free(workers);
+
+	int num_games = ctx.num_games > 0 ? ctx.num_games : 0;
+	double denominator = num_games > 0 ? (double)num_games : 1.0;
+	int num_a_wins = atomic_load(&ctx.num_wins[0]);
+	int num_b_wins = atomic_load(&ctx.num_wins[1]);
+	int num_draws = atomic_load(&ctx.num_wins[SELFPLAY_DRAW]);
+	int num_white_wins = atomic_load(&ctx.num_white_wins);
+	int num_black_wins = atomic_load(&ctx.num_black_wins);
+
+	printf("%d games in %.3fs (%.2f games/s)\n", num_games, elapsed, elapsed > 0.0 ? num_games / elapsed : 0.0);
+	printf("a:     %6d wins (%5.1f%%)\n", num_a_wins, 100.0 * num_a_wins / denominator);
+	printf("b:     %6d wins (%5.1f%%)\n", num_b_wins, 100.0 * num_b_wins / denominator);
+	printf("white: %6d wins (%5.1f%%)\n", num_white_wins, 100.0 * num_white_wins / denominator);
+	printf("black: %6d wins (%5.1f%%)\n", num_black_wins, 100.0 * num_black_wins / denominator);
+	printf("draw:  %6d      (%5.1f%%)\n", num_draws, 100.0 * num_draws / denominator);
+	printf(
+		"Average length: %.1f actions\n",
+		(double)atomic_load(&ctx.total_length) / denominator
+	);
+
+	if (stats_path != NULL) {
+		FILE* stats_file = fopen(stats_path, "a");
+		if (stats_file == NULL) {
+			fprintf(stderr, "Could not open %s\n", stats_path);
+			return 1;
+		}
+
+		char label[256];
+		snprintf(label, sizeof(label), "selfplay %s vs %s", engine_specs[0], engine_specs[1]);
+		ttchess_stats_t stats;
+		ttchess_stats_snapshot(&stats);
+		ttchess_stats_write_json(stats_file, label, &stats);
+		fclose(stats_file);
+	}
+
+	return 0;
+}
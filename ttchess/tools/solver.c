@@ -0,0 +1,766 @@
+// Solves ttchess positions with parallel df-pn (depth-first proof-number
+// search).
+//
+// Usage: ttchess-solver [-s 0|1] [-p plies] [-j threads] [-m log2_entries]
+//                       [-t seconds] [-f checkpoint] [-i seconds]
+//
+// -s: Only solve with or without statues (default: both)
+// -p: Solve every distinct position this many actions away from the start
+//     instead of the start itself (default: 0)
+// -j: Number of worker threads (default: 4)
+// -m: Log2 of the number of hash table entries (default: 22)
+// -t: Give up on a position after this many seconds (default: no limit)
+// -f: Checkpoint file, loaded on start when it exists and rewritten
+//     periodically and on exit
+// -i: Seconds between checkpoints (default: 300)
+//
+// Every position is first solved for the player to move. When that is
+// disproven it is solved again for the opponent.
+//
+// Repetitions and lines deeper than SOLVER_MAX_PLY count as "not a win" for
+// the player being proven. This makes disproofs path dependent (the graph
+// history interaction problem) so "no forced win" results are only
+// heuristic. Proofs never go through a repetition and are always sound.
+
+#include "../ttchess.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define SOLVER_INF 0x3fffffffu
+#define SOLVER_MAX_PLY 256
+#define SOLVER_CLUSTER_SIZE 4
+#define SOLVER_PATH_FILTER_SIZE 4096
+#define SOLVER_NODE_BATCH 1024
+#define SOLVER_MAX_ROOTS 4096
+#define SOLVER_CHECKPOINT_MAGIC 0x4e504454u // "TDPN"
+#define SOLVER_CHECKPOINT_VERSION 1
+
+#define SOLVER_DEFAULT_THREADS 4
+#define SOLVER_DEFAULT_TABLE_SIZE_LOG2 22
+#define SOLVER_DEFAULT_CHECKPOINT_INTERVAL 300.0
+
+typedef struct {
+	uint64_t key;
+	uint32_t pn;
+	uint32_t dn;
+	// Number of nodes expanded below this one, used for replacement
+	uint32_t work;
+	// Threads currently searching below this node, not checkpointed
+	uint32_t busy;
+} solver_entry_t;
+
+typedef struct {
+	atomic_int lock;
+	solver_entry_t entries[SOLVER_CLUSTER_SIZE];
+} solver_cluster_t;
+
+typedef struct {
+	uint64_t mask;
+	solver_cluster_t* clusters;
+} solver_table_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t num_entries;
+} solver_checkpoint_header_t;
+
+typedef struct {
+	uint64_t key;
+	uint32_t pn;
+	uint32_t dn;
+	uint32_t work;
+} solver_checkpoint_entry_t;
+
+typedef struct {
+	solver_table_t* table;
+	atomic_bool stop;
+	atomic_uint_fast64_t num_nodes;
+} solver_shared_t;
+
+typedef struct {
+	solver_shared_t* shared;
+	ttchess_state_t state;
+	ttchess_color_t attacker;
+	uint64_t key_salt;
+	uint64_t num_nodes;
+
+	// Hashes of the positions on the current line, with a counting filter
+	// so most lookups do not need a scan
+	uint64_t path[SOLVER_MAX_PLY];
+	uint16_t path_filter[SOLVER_PATH_FILTER_SIZE];
+	ttchess_move_t moves[SOLVER_MAX_PLY][TTCHESS_MAX_MOVES];
+} solver_worker_t;
+
+static double
+solver_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline uint32_t
+solver_add(uint32_t lhs, uint32_t rhs) {
+	uint32_t sum = lhs + rhs;
+	return sum >= SOLVER_INF ? SOLVER_INF : sum;
+}
+
+// Table
+
+static bool
+solver_table_init(solver_table_t* table, int num_entries_log2) {
+	int num_clusters_log2 = num_entries_log2 > 2 ? num_entries_log2 - 2 : 0;
+	size_t num_clusters = (size_t)1 << num_clusters_log2;
+	table->mask = num_clusters - 1;
+	table->clusters = calloc(num_clusters, sizeof(solver_cluster_t));
+	if (table->clusters == NULL) { return false; }
+
+	for (size_t i = 0; i < num_clusters; ++i) {
+		atomic_init(&table->clusters[i].lock, 0);
+	}
+
+	return true;
+}
+
+// Clusters are only held for a handful of loads and stores so a spin lock is
+// cheaper than a mutex
+static inline void
+solver_cluster_lock(solver_cluster_t* cluster) {
+	while (atomic_exchange_explicit(&cluster->lock, 1, memory_order_acquire)) {
+		while (atomic_load_explicit(&cluster->lock, memory_order_relaxed)) { }
+	}
+}
+
+static inline void
+solver_cluster_unlock(solver_cluster_t* cluster) {
+	atomic_store_explicit(&cluster->lock, 0, memory_order_release);
+}
+
+static inline solver_cluster_t*
+solver_table_lock(solver_table_t* table, uint64_t key) {
+	solver_cluster_t* cluster = &table->clusters[key & table->mask];
+	solver_cluster_lock(cluster);
+	return cluster;
+}
+
+static inline solver_entry_t*
+solver_cluster_find(solver_cluster_t* cluster, uint64_t key) {
+	for (int i = 0; i < SOLVER_CLUSTER_SIZE; ++i) {
+		if (cluster->entries[i].key == key) { return &cluster->entries[i]; }
+	}
+
+	return NULL;
+}
+
+// Finds or makes room for `key`.
+// Empty entries are used first, then the one with the least work, preferring
+// entries no thread is searching.
+static inline solver_entry_t*
+solver_cluster_insert(solver_cluster_t* cluster, uint64_t key) {
+	solver_entry_t* entry = solver_cluster_find(cluster, key);
+	if (entry != NULL) { return entry; }
+
+	entry = &cluster->entries[0];
+	for (int i = 1; i < SOLVER_CLUSTER_SIZE && entry->key != 0; ++i) {
+		solver_entry_t* candidate = &cluster->entries[i];
+		if (candidate->key == 0) {
+			entry = candidate;
+		} else if ((candidate->busy == 0) != (entry->busy == 0)) {
+			if (candidate->busy == 0) { entry = candidate; }
+		} else if (candidate->work < entry->work) {
+			entry = candidate;
+		}
+	}
+
+	*entry = (solver_entry_t){ .key = key, .pn = 1, .dn = 1 };
+	return entry;
+}
+
+static bool
+solver_table_get(solver_table_t* table, uint64_t key, solver_entry_t* result) {
+	solver_cluster_t* cluster = solver_table_lock(table, key);
+	solver_entry_t* entry = solver_cluster_find(cluster, key);
+	if (entry != NULL) { *result = *entry; }
+	solver_cluster_unlock(cluster);
+
+	return entry != NULL;
+}
+
+static void
+solver_table_put(solver_table_t* table, uint64_t key, uint32_t pn, uint32_t dn, uint32_t work) {
+	solver_cluster_t* cluster = solver_table_lock(table, key);
+	solver_entry_t* entry = solver_cluster_insert(cluster, key);
+	// A worker that was stopped halfway must not hide another one's result
+	if (entry->pn != 0 && entry->dn != 0) {
+		entry->pn = pn;
+		entry->dn = dn;
+		// Solved entries are never worth evicting
+		entry->work = (pn == 0 || dn == 0) ? UINT32_MAX : work;
+	}
+	solver_cluster_unlock(cluster);
+}
+
+static void
+solver_table_enter(solver_table_t* table, uint64_t key) {
+	solver_cluster_t* cluster = solver_table_lock(table, key);
+	++solver_cluster_insert(cluster, key)->busy;
+	solver_cluster_unlock(cluster);
+}
+
+static void
+solver_table_leave(solver_table_t* table, uint64_t key) {
+	solver_cluster_t* cluster = solver_table_lock(table, key);
+	// The entry may have been evicted in the meantime
+	solver_entry_t* entry = solver_cluster_find(cluster, key);
+	if (entry != NULL && entry->busy > 0) { --entry->busy; }
+	solver_cluster_unlock(cluster);
+}
+
+// Checkpoint
+
+static bool
+solver_save_checkpoint(solver_table_t* table, const char* path) {
+	// Write to a temporary file so an interrupted save keeps the previous one
+	char tmp_path[1024];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	FILE* file = fopen(tmp_path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open %s for writing\n", tmp_path);
+		return false;
+	}
+
+	solver_checkpoint_header_t header = {
+		.magic = SOLVER_CHECKPOINT_MAGIC,
+		.version = SOLVER_CHECKPOINT_VERSION,
+	};
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	// Entries are copied under the cluster lock so each one is consistent
+	// even while the workers are running
+	for (uint64_t i = 0; ok && i <= table->mask; ++i) {
+		solver_checkpoint_entry_t entries[SOLVER_CLUSTER_SIZE];
+		int num_entries = 0;
+
+		solver_cluster_t* cluster = &table->clusters[i];
+		solver_cluster_lock(cluster);
+		for (int j = 0; j < SOLVER_CLUSTER_SIZE; ++j) {
+			const solver_entry_t* entry = &cluster->entries[j];
+			if (entry->key == 0) { continue; }
+
+			entries[num_entries++] = (solver_checkpoint_entry_t){
+				.key = entry->key,
+				.pn = entry->pn,
+				.dn = entry->dn,
+				.work = entry->work,
+			};
+		}
+		solver_cluster_unlock(cluster);
+
+		ok = fwrite(entries, sizeof(entries[0]), (size_t)num_entries, file) == (size_t)num_entries;
+		header.num_entries += (uint64_t)num_entries;
+	}
+
+	// Patch in the count now that it is known
+	ok = ok
+		&& fseek(file, 0, SEEK_SET) == 0
+		&& fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+
+	if (ok) {
+		// rename does not replace an existing file on every platform
+		remove(path);
+		ok = rename(tmp_path, path) == 0;
+	}
+
+	if (!ok) {
+		fprintf(stderr, "Could not write checkpoint %s\n", path);
+	}
+
+	return ok;
+}
+
+static bool
+solver_load_checkpoint(solver_table_t* table, const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return false; }
+
+	solver_checkpoint_header_t header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1
+		&& header.magic == SOLVER_CHECKPOINT_MAGIC
+		&& header.version == SOLVER_CHECKPOINT_VERSION;
+
+	uint64_t num_loaded = 0;
+	for (; ok && num_loaded < header.num_entries; ++num_loaded) {
+		solver_checkpoint_entry_t entry;
+		ok = fread(&entry, sizeof(entry), 1, file) == 1;
+		if (ok) { solver_table_put(table, entry.key, entry.pn, entry.dn, entry.work); }
+	}
+	fclose(file);
+
+	if (ok) {
+		fprintf(stderr, "Loaded %" PRIu64 " entries from %s\n", num_loaded, path);
+	} else {
+		fprintf(stderr, "Checkpoint %s is invalid, starting from scratch\n", path);
+	}
+
+	return ok;
+}
+
+// Search
+
+static inline uint64_t
+solver_key(uint64_t key_salt, uint64_t hash) {
+	uint64_t key = hash ^ key_salt;
+	// 0 marks empty entries
+	return key != 0 ? key : 1;
+}
+
+static inline bool
+solver_is_or_node(const solver_worker_t* worker) {
+	return worker->state.phase.color == worker->attacker;
+}
+
+static inline bool
+solver_on_path(const solver_worker_t* worker, int ply, uint64_t hash) {
+	if (worker->path_filter[hash % SOLVER_PATH_FILTER_SIZE] == 0) { return false; }
+
+	for (int i = 0; i < ply; ++i) {
+		if (worker->path[i] == hash) { return true; }
+	}
+
+	return false;
+}
+
+// Proof and disproof numbers of the current state when it is a leaf
+static inline bool
+solver_terminal(const solver_worker_t* worker, uint32_t* pn, uint32_t* dn) {
+	if (worker->state.phase.action == TTCHESS_ACTION_WON) {
+		// The winner keeps the turn
+		bool attacker_won = worker->state.phase.color == worker->attacker;
+		*pn = attacker_won ? 0 : SOLVER_INF;
+		*dn = attacker_won ? SOLVER_INF : 0;
+		return true;
+	}
+
+	return false;
+}
+
+static void
+solver_child_numbers(
+	solver_worker_t* worker,
+	int ply,
+	ttchess_move_t move,
+	uint32_t* pn,
+	uint32_t* dn,
+	uint32_t* busy
+) {
+	ttchess_undo_t undo;
+	ttchess_make_move(&worker->state, move, &undo);
+
+	uint64_t hash = worker->state.hash;
+	solver_entry_t entry;
+	*busy = 0;
+	if (solver_terminal(worker, pn, dn)) {
+		// Nothing to do
+	} else if (ply + 1 >= SOLVER_MAX_PLY || solver_on_path(worker, ply + 1, hash)) {
+		*pn = SOLVER_INF;
+		*dn = 0;
+	} else if (solver_table_get(worker->shared->table, solver_key(worker->key_salt, hash), &entry)) {
+		*pn = entry.pn;
+		*dn = entry.dn;
+		*busy = entry.busy;
+	} else {
+		*pn = 1;
+		*dn = 1;
+	}
+
+	ttchess_unmake_move(&worker->state, &undo);
+}
+
+
+// Expands the current state until its proof or disproof number reaches the
+// threshold. Returns the number of nodes expanded.
+static uint32_t
+solver_mid(solver_worker_t* worker, int ply, uint32_t pn_threshold, uint32_t dn_threshold) {
+	solver_table_t* table = worker->shared->table;
+	uint64_t hash = worker->state.hash;
+	uint64_t key = solver_key(worker->key_salt, hash);
+
+	if ((++worker->num_nodes % SOLVER_NODE_BATCH) == 0) {
+		atomic_fetch_add_explicit(&worker->shared->num_nodes, SOLVER_NODE_BATCH, memory_order_relaxed);
+	}
+
+	uint32_t pn, dn;
+	ttchess_move_t* moves = worker->moves[ply];
+	int num_moves = ttchess_list_moves(&worker->state, moves, TTCHESS_MAX_MOVES);
+	if (solver_terminal(worker, &pn, &dn)) {
+		solver_table_put(table, key, pn, dn, 1);
+		return 1;
+	} else if (num_moves == 0) {
+		// Neither player can move, the attacker did not win
+		solver_table_put(table, key, SOLVER_INF, 0, 1);
+		return 1;
+	}
+
+	worker->path[ply] = hash;
+	++worker->path_filter[hash % SOLVER_PATH_FILTER_SIZE];
+	solver_table_enter(table, key);
+
+	// In an OR node the attacker moves: pn is the min over the children and dn
+	// the sum. It is the other way around in an AND node.
+	// Below, "min" and "sum" are named from the point of view of either node.
+	bool is_or_node = solver_is_or_node(worker);
+	uint32_t min_threshold = is_or_node ? pn_threshold : dn_threshold;
+	uint32_t sum_threshold = is_or_node ? dn_threshold : pn_threshold;
+	uint32_t work = 1;
+	uint32_t min = 0;
+	uint32_t sum = 0;
+	bool evaluated = false;
+	while (!atomic_load_explicit(&worker->shared->stop, memory_order_relaxed)) {
+		evaluated = true;
+		int best_index = -1;
+		uint32_t best_cost = SOLVER_INF;
+		uint32_t second_cost = SOLVER_INF;
+		uint32_t best_sum = 0;
+		min = SOLVER_INF;
+		sum = 0;
+		for (int i = 0; i < num_moves; ++i) {
+			uint32_t child_pn, child_dn, child_busy;
+			solver_child_numbers(worker, ply, moves[i], &child_pn, &child_dn, &child_busy);
+
+			uint32_t child_min = is_or_node ? child_pn : child_dn;
+			uint32_t child_sum = is_or_node ? child_dn : child_pn;
+			if (child_min < min) { min = child_min; }
+			sum = solver_add(sum, child_sum);
+
+			// Children other threads are working on look more expensive so
+			// the workers spread over the tree
+			uint32_t cost = child_min;
+			for (uint32_t j = 0; j < child_busy && cost < SOLVER_INF; ++j) {
+				cost = solver_add(cost, cost);
+			}
+
+			if (cost < best_cost) {
+				second_cost = best_cost;
+				best_cost = cost;
+				best_sum = child_sum;
+				best_index = i;
+			} else if (cost < second_cost) {
+				second_cost = cost;
+			}
+		}
+
+		if (min >= min_threshold || sum >= sum_threshold || best_index < 0) { break; }
+
+		uint32_t child_min_threshold = solver_add(second_cost, 1);
+		if (child_min_threshold > min_threshold) { child_min_threshold = min_threshold; }
+		uint32_t child_sum_threshold = sum_threshold >= SOLVER_INF
+			? SOLVER_INF
+			: sum_threshold - sum + best_sum;
+
+		ttchess_undo_t undo;
+		ttchess_make_move(&worker->state, moves[best_index], &undo);
+		uint32_t child_work = solver_mid(
+			worker,
+			ply + 1,
+			is_or_node ? child_min_threshold : child_sum_threshold,
+			is_or_node ? child_sum_threshold : child_min_threshold
+		);
+		ttchess_unmake_move(&worker->state, &undo);
+
+		work = solver_add(work, child_work);
+	}
+
+	solver_table_leave(table, key);
+	if (evaluated) {
+		pn = is_or_node ? min : sum;
+		dn = is_or_node ? sum : min;
+		solver_table_put(table, key, pn, dn, work);
+	}
+	--worker->path_filter[hash % SOLVER_PATH_FILTER_SIZE];
+
+	return work;
+}
+
+static int
+solver_worker_main(void* userdata) {
+	solver_worker_t* worker = userdata;
+	solver_mid(worker, 0, SOLVER_INF, SOLVER_INF);
+
+	// The root is solved or the run was interrupted, either way the others
+	// should stop
+	atomic_store(&worker->shared->stop, true);
+	atomic_fetch_add(&worker->shared->num_nodes, worker->num_nodes % SOLVER_NODE_BATCH);
+	return 0;
+}
+
+typedef enum {
+	SOLVER_RESULT_UNKNOWN,
+	SOLVER_RESULT_PROVEN,
+	SOLVER_RESULT_DISPROVEN,
+} solver_result_t;
+
+typedef struct {
+	solver_table_t* table;
+	int num_threads;
+	double time_limit;
+	const char* checkpoint_path;
+	double checkpoint_interval;
+	double last_checkpoint;
+} solver_options_t;
+
+// The same position has different numbers depending on who is proving and
+// whether statues can be built
+static uint64_t
+solver_key_salt(const ttchess_state_t* state, ttchess_color_t attacker) {
+	uint64_t salt = 0;
+	if (attacker == TTCHESS_COLOR_BLACK) { salt ^= 0x5bd1e9955bd1e995ull; }
+	if (state->config.with_statues) { salt ^= 0xc2b2ae3d27d4eb4full; }
+	return salt;
+}
+
+static solver_result_t
+solver_prove(solver_options_t* options, const ttchess_state_t* state, ttchess_color_t attacker) {
+	solver_shared_t shared = { .table = options->table };
+	atomic_init(&shared.stop, false);
+	atomic_init(&shared.num_nodes, 0);
+
+	// Workers hold a move buffer for every ply, too big for the stack
+	solver_worker_t* workers = calloc((size_t)options->num_threads, sizeof(solver_worker_t));
+	thrd_t* threads = calloc((size_t)options->num_threads, sizeof(thrd_t));
+	if (workers == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	int num_started = 0;
+	for (int i = 0; i < options->num_threads; ++i) {
+		workers[i] = (solver_worker_t){
+			.shared = &shared,
+			.state = *state,
+			.attacker = attacker,
+			.key_salt = solver_key_salt(state, attacker),
+		};
+		if (thrd_create(&threads[i], solver_worker_main, &workers[i]) != thrd_success) {
+			fprintf(stderr, "Could not start worker %d\n", i);
+			break;
+		}
+		++num_started;
+	}
+	if (num_started == 0) { atomic_store(&shared.stop, true); }
+
+	double start = solver_now();
+	while (!atomic_load(&shared.stop)) {
+		thrd_sleep(&(struct timespec){ .tv_nsec = 100 * 1000 * 1000 }, NULL);
+
+		double now = solver_now();
+		if (options->time_limit > 0.0 && now - start >= options->time_limit) {
+			atomic_store(&shared.stop, true);
+		}
+
+		if (
+			options->checkpoint_path != NULL
+			&& now - options->last_checkpoint >= options->checkpoint_interval
+		) {
+			solver_save_checkpoint(options->table, options->checkpoint_path);
+			options->last_checkpoint = now;
+		}
+	}
+
+	for (int i = 0; i < num_started; ++i) {
+		thrd_join(threads[i], NULL);
+	}
+	double elapsed = solver_now() - start;
+	free(threads);
+	free(workers);
+
+	uint64_t num_nodes = atomic_load(&shared.num_nodes);
+	solver_entry_t root;
+	uint64_t root_key = solver_key(solver_key_salt(state, attacker), state->hash);
+	solver_result_t result = SOLVER_RESULT_UNKNOWN;
+	if (solver_table_get(options->table, root_key, &root)) {
+		if (root.pn == 0) {
+			result = SOLVER_RESULT_PROVEN;
+		} else if (root.dn == 0) {
+			result = SOLVER_RESULT_DISPROVEN;
+		}
+	}
+
+	fprintf(
+		stderr,
+		"  %s: %s, %" PRIu64 " nodes in %.3fs (%.0f nodes/s)\n",
+		attacker == TTCHESS_COLOR_WHITE ? "white" : "black",
+		result == SOLVER_RESULT_PROVEN ? "win"
+			: result == SOLVER_RESULT_DISPROVEN ? "no forced win"
+			: "unknown",
+		num_nodes,
+		elapsed,
+		elapsed > 0.0 ? (double)num_nodes / elapsed : 0.0
+	);
+
+	return result;
+}
+
+static void
+solver_solve(solver_options_t* options, const ttchess_state_t* state) {
+	ttchess_color_t color = state->phase.color;
+	ttchess_color_t opposing_color = color == TTCHESS_COLOR_WHITE
+		? TTCHESS_COLOR_BLACK
+		: TTCHESS_COLOR_WHITE;
+
+	const char* value = "unknown";
+	solver_result_t result = solver_prove(options, state, color);
+	if (result == SOLVER_RESULT_PROVEN) {
+		value = "win";
+	} else if (result == SOLVER_RESULT_DISPROVEN) {
+		result = solver_prove(options, state, opposing_color);
+		if (result == SOLVER_RESULT_PROVEN) {
+			value = "loss";
+		} else if (result == SOLVER_RESULT_DISPROVEN) {
+			value = "no forced win";
+		}
+	}
+
+	printf(
+		"%016" PRIx64 " %s to move (action %d): %s\n",
+		state->hash,
+		color == TTCHESS_COLOR_WHITE ? "white" : "black",
+		state->phase.action,
+		value
+	);
+	fflush(stdout);
+}
+
+typedef struct {
+	int num_roots;
+	uint64_t hashes[SOLVER_MAX_ROOTS];
+	ttchess_state_t* states;
+} solver_roots_t;
+
+static void
+solver_collect_roots(solver_roots_t* roots, const ttchess_state_t* state, int plies) {
+	if (plies == 0 || state->phase.action == TTCHESS_ACTION_WON) {
+		for (int i = 0; i < roots->num_roots; ++i) {
+			if (roots->hashes[i] == state->hash) { return; }
+		}
+
+		if (roots->num_roots < SOLVER_MAX_ROOTS) {
+			roots->hashes[roots->num_roots] = state->hash;
+			roots->states[roots->num_roots] = *state;
+			++roots->num_roots;
+		}
+		return;
+	}
+
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	for (int i = 0; i < num_moves; ++i) {
+		ttchess_state_t next_state = *state;
+		ttchess_apply_move(&next_state, moves[i]);
+		solver_collect_roots(roots, &next_state, plies - 1);
+	}
+}
+
+static void
+solver_run(solver_options_t* options, ttchess_config_t config, int plies) {
+	printf("--- with_statues = %s ---\n", config.with_statues ? "true" : "false");
+
+	ttchess_state_t state;
+	ttchess_init(&state, config);
+
+	solver_roots_t* roots = calloc(1, sizeof(solver_roots_t));
+	ttchess_state_t* states = calloc(SOLVER_MAX_ROOTS, sizeof(ttchess_state_t));
+	if (roots == NULL || states == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	roots->states = states;
+
+	solver_collect_roots(roots, &state, plies);
+	if (roots->num_roots >= SOLVER_MAX_ROOTS) {
+		fprintf(stderr, "Only solving the first %d positions\n", SOLVER_MAX_ROOTS);
+	}
+
+	for (int i = 0; i < roots->num_roots; ++i) {
+		solver_solve(options, &roots->states[i]);
+	}
+
+	free(states);
+	free(roots);
+}
+
+int
+main(int argc, const char** argv) {
+	int with_statues = -1;
+	int plies = 0;
+	int num_entries_log2 = SOLVER_DEFAULT_TABLE_SIZE_LOG2;
+	solver_options_t options = {
+		.num_threads = SOLVER_DEFAULT_THREADS,
+		.checkpoint_interval = SOLVER_DEFAULT_CHECKPOINT_INTERVAL,
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			with_statues = atoi(argv[++i]) != 0;
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			plies = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			options.num_threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			num_entries_log2 = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			options.time_limit = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			options.checkpoint_path = argv[++i];
+		} else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			options.checkpoint_interval = atof(argv[++i]);
+		} else {
+			fprintf(
+				stderr,
+				"Usage: %s [-s 0|1] [-p plies] [-j threads] [-m log2_entries] [-t seconds] [-f checkpoint] [-i seconds]\n",
+				argv[0]
+			);
+			return 1;
+		}
+	}
+
+	if (options.num_threads < 1) { options.num_threads = 1; }
+	if (num_entries_log2 < 2 || num_entries_log2 > 40) {
+		fprintf(stderr, "Table size must be between 2^2 and 2^40 entries\n");
+		return 1;
+	}
+
+	solver_table_t table;
+	if (!solver_table_init(&table, num_entries_log2)) {
+		fprintf(stderr, "Could not allocate 2^%d table entries\n", num_entries_log2);
+		return 1;
+	}
+	options.table = &table;
+
+	if (options.checkpoint_path != NULL) {
+		solver_load_checkpoint(&table, options.checkpoint_path);
+	}
+	options.last_checkpoint = solver_now();
+
+	// Both configurations share the table
+	if (with_statues != 1) {
+		solver_run(&options, (ttchess_config_t){ .with_statues = false }, plies);
+	}
+	if (with_statues != 0) {
+		solver_run(&options, (ttchess_config_t){ .with_statues = true }, plies);
+	}
+
+	if (options.checkpoint_path != NULL) {
+		solver_save_checkpoint(&table, options.checkpoint_path);
+	}
+	free(table.clusters);
+
+	return 0;
+}
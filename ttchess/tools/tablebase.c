@@ -0,0 +1,339 @@
+// Generates a ttchess endgame tablebase by retrograde analysis.
+//
+// Usage: ttchess-tablebase [-k pawns] [-j threads] [-o file] [-c]
+//
+// -k: Maximum number of pawns per player, on board or in reserve (default: 1)
+// -j: Number of worker threads (default: 4)
+// -o: Output file (default: ttchess-<pawns>.tb)
+// -c: Map the written file back and check every entry against the probe API
+//
+// No move ever brings a pawn back so the positions of the table only lead to
+// each other. Every pass goes over the undecided positions and resolves those
+// whose successors are decided enough: a position is won when one move wins
+// and lost when every move loses. Passes repeat until nothing changes and the
+// positions left undecided are draws.
+
+#include "../ttchess.h"
+#include "../tablebase.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _WIN32
+#	define TB_HAS_MMAP 0
+#else
+#	define TB_HAS_MMAP 1
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+// Entries that are not positions keep TTCHESS_TB_UNKNOWN
+#define TB_PENDING 0xff
+#define TB_CHUNK_SIZE 4096
+
+#define TB_DEFAULT_PAWNS 1
+#define TB_DEFAULT_THREADS 4
+
+typedef struct {
+	int max_pawns;
+	uint64_t num_entries;
+	_Atomic uint8_t* values;
+
+	atomic_uint_fast64_t next_chunk;
+	atomic_uint_fast64_t num_changed;
+	atomic_uint_fast64_t num_escaped;
+	bool initializing;
+} tb_ctx_t;
+
+static double
+tb_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint8_t
+tb_resolve(tb_ctx_t* ctx, const ttchess_state_t* state) {
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+	int num_moves = ttchess_list_moves(state, moves, TTCHESS_MAX_MOVES);
+	// Nobody can move, the game is stuck and ends up a draw
+	if (num_moves == 0) { return TB_PENDING; }
+
+	bool all_lost = true;
+	for (int i = 0; i < num_moves; ++i) {
+		ttchess_state_t next_state = *state;
+		ttchess_apply_move(&next_state, moves[i]);
+
+		uint8_t value;
+		uint64_t index;
+		if (next_state.phase.action == TTCHESS_ACTION_WON) {
+			value = next_state.phase.color == state->phase.color ? TTCHESS_TB_WIN : TTCHESS_TB_LOSS;
+		} else if (ttchess_tb_index(ctx->max_pawns, &next_state, &index)) {
+			value = atomic_load_explicit(&ctx->values[index], memory_order_relaxed);
+			if (
+				next_state.phase.color != state->phase.color
+				&& (value == TTCHESS_TB_WIN || value == TTCHESS_TB_LOSS)
+			) {
+				value = value == TTCHESS_TB_WIN ? TTCHESS_TB_LOSS : TTCHESS_TB_WIN;
+			}
+		} else {
+			// Would be a bug in the index, keep going but report it
+			atomic_fetch_add(&ctx->num_escaped, 1);
+			value = TB_PENDING;
+		}
+
+		if (value == TTCHESS_TB_WIN) { return TTCHESS_TB_WIN; }
+		all_lost &= value == TTCHESS_TB_LOSS;
+	}
+
+	return all_lost ? TTCHESS_TB_LOSS : TB_PENDING;
+}
+
+static int
+tb_worker_main(void* userdata) {
+	tb_ctx_t* ctx = userdata;
+	uint64_t num_chunks = (ctx->num_entries + TB_CHUNK_SIZE - 1) / TB_CHUNK_SIZE;
+
+	uint64_t chunk;
+	while ((chunk = atomic_fetch_add(&ctx->next_chunk, 1)) < num_chunks) {
+		uint64_t begin = chunk * TB_CHUNK_SIZE;
+		uint64_t end = begin + TB_CHUNK_SIZE < ctx->num_entries
+			? begin + TB_CHUNK_SIZE
+			: ctx->num_entries;
+		uint64_t num_changed = 0;
+
+		for (uint64_t index = begin; index < end; ++index) {
+			ttchess_state_t state;
+			if (ctx->initializing) {
+				uint8_t value = ttchess_tb_state(ctx->max_pawns, index, &state)
+					? TB_PENDING
+					: TTCHESS_TB_UNKNOWN;
+				atomic_store_explicit(&ctx->values[index], value, memory_order_relaxed);
+				continue;
+			}
+
+			if (atomic_load_explicit(&ctx->values[index], memory_order_relaxed) != TB_PENDING) {
+				continue;
+			}
+
+			ttchess_tb_state(ctx->max_pawns, index, &state);
+			uint8_t value = tb_resolve(ctx, &state);
+			if (value != TB_PENDING) {
+				atomic_store_explicit(&ctx->values[index], value, memory_order_relaxed);
+				++num_changed;
+			}
+		}
+
+		atomic_fetch_add(&ctx->num_changed, num_changed);
+	}
+
+	return 0;
+}
+
+static bool
+tb_run_pass(tb_ctx_t* ctx, thrd_t* threads, int num_threads) {
+	atomic_store(&ctx->next_chunk, 0);
+
+	int num_started = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		if (thrd_create(&threads[i], tb_worker_main, ctx) != thrd_success) { break; }
+		++num_started;
+	}
+	if (num_started == 0) { return false; }
+
+	for (int i = 0; i < num_started; ++i) {
+		thrd_join(threads[i], NULL);
+	}
+
+	return true;
+}
+
+static bool
+tb_check(const char* path, const tb_ctx_t* ctx) {
+	size_t size = ttchess_tb_encoded_size(ctx->max_pawns);
+	uint8_t* data = NULL;
+
+#if TB_HAS_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size != size) {
+		close(fd);
+		return false;
+	}
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) { return false; }
+	data = mapping;
+#else
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) { return false; }
+	data = malloc(size);
+	bool read_ok = data != NULL && fread(data, size, 1, file) == 1;
+	fclose(file);
+	if (!read_ok) {
+		free(data);
+		return false;
+	}
+#endif
+
+	ttchess_tb_t tb;
+	bool ok = ttchess_tb_open(&tb, data, size);
+	for (uint64_t index = 0; ok && index < ctx->num_entries; ++index) {
+		ttchess_state_t state;
+		if (!ttchess_tb_state(ctx->max_pawns, index, &state)) { continue; }
+
+		uint64_t probed_index;
+		ok = ttchess_tb_index(ctx->max_pawns, &state, &probed_index)
+			&& probed_index == index
+			&& ttchess_tb_probe(&tb, &state) == atomic_load(&ctx->values[index]);
+		if (!ok) {
+			fprintf(stderr, "Entry %" PRIu64 " does not match\n", index);
+		}
+	}
+
+#if TB_HAS_MMAP
+	munmap(data, size);
+#else
+	free(data);
+#endif
+	return ok;
+}
+
+int
+main(int argc, const char** argv) {
+	int max_pawns = TB_DEFAULT_PAWNS;
+	int num_threads = TB_DEFAULT_THREADS;
+	const char* output_path = NULL;
+	bool check = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+			max_pawns = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			num_threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (strcmp(argv[i], "-c") == 0) {
+			check = true;
+		} else {
+			fprintf(stderr, "Usage: %s [-k pawns] [-j threads] [-o file] [-c]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (!(0 < max_pawns && max_pawns <= TTCHESS_TB_MAX_PAWNS)) {
+		fprintf(stderr, "The number of pawns must be between 1 and %d\n", TTCHESS_TB_MAX_PAWNS);
+		return 1;
+	}
+	if (num_threads < 1) { num_threads = 1; }
+
+	char default_path[32];
+	if (output_path == NULL) {
+		snprintf(default_path, sizeof(default_path), "ttchess-%d.tb", max_pawns);
+		output_path = default_path;
+	}
+
+	tb_ctx_t ctx = {
+		.max_pawns = max_pawns,
+		.num_entries = ttchess_tb_num_entries(max_pawns),
+	};
+	ctx.values = malloc(sizeof(ctx.values[0]) * (size_t)ctx.num_entries);
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (ctx.values == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	atomic_init(&ctx.next_chunk, 0);
+	atomic_init(&ctx.num_changed, 0);
+	atomic_init(&ctx.num_escaped, 0);
+
+	double start = tb_now();
+	ctx.initializing = true;
+	if (!tb_run_pass(&ctx, threads, num_threads)) {
+		fprintf(stderr, "Could not start any worker\n");
+		return 1;
+	}
+	ctx.initializing = false;
+
+	uint64_t num_positions = 0;
+	for (uint64_t index = 0; index < ctx.num_entries; ++index) {
+		num_positions += atomic_load_explicit(&ctx.values[index], memory_order_relaxed) == TB_PENDING;
+	}
+	printf("%" PRIu64 " entries, %" PRIu64 " positions\n", ctx.num_entries, num_positions);
+	fflush(stdout);
+
+	for (int pass = 1;; ++pass) {
+		atomic_store(&ctx.num_changed, 0);
+		if (!tb_run_pass(&ctx, threads, num_threads)) {
+			fprintf(stderr, "Could not start any worker\n");
+			return 1;
+		}
+
+		uint64_t num_changed = atomic_load(&ctx.num_changed);
+		printf("Pass %d: %" PRIu64 " resolved (%.3fs)\n", pass, num_changed, tb_now() - start);
+		// Passes over the larger tables take a while
+		fflush(stdout);
+		if (num_changed == 0) { break; }
+	}
+	free(threads);
+
+	uint64_t num_values[4] = { 0 };
+	for (uint64_t index = 0; index < ctx.num_entries; ++index) {
+		uint8_t value = atomic_load_explicit(&ctx.values[index], memory_order_relaxed);
+		if (value == TB_PENDING) {
+			value = TTCHESS_TB_DRAW;
+			atomic_store_explicit(&ctx.values[index], value, memory_order_relaxed);
+		}
+		++num_values[value];
+	}
+	printf(
+		"win: %" PRIu64 ", loss: %" PRIu64 ", draw: %" PRIu64 "\n",
+		num_values[TTCHESS_TB_WIN], num_values[TTCHESS_TB_LOSS], num_values[TTCHESS_TB_DRAW]
+	);
+	if (atomic_load(&ctx.num_escaped) > 0) {
+		fprintf(stderr, "%" PRIu64 " moves left the table\n", (uint64_t)atomic_load(&ctx.num_escaped));
+	}
+
+	// Atomic bytes are not guaranteed to be plain bytes
+	size_t size = ttchess_tb_encoded_size(max_pawns);
+	uint8_t* values = malloc((size_t)ctx.num_entries);
+	uint8_t* encoded = malloc(size);
+	if (values == NULL || encoded == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (uint64_t index = 0; index < ctx.num_entries; ++index) {
+		values[index] = atomic_load_explicit(&ctx.values[index], memory_order_relaxed);
+	}
+	ttchess_tb_encode(max_pawns, values, encoded);
+	free(values);
+
+	FILE* file = fopen(output_path, "wb");
+	bool written = file != NULL && fwrite(encoded, size, 1, file) == 1;
+	written = (file != NULL && fclose(file) == 0) && written;
+	free(encoded);
+	if (!written) {
+		fprintf(stderr, "Could not write %s\n", output_path);
+		return 1;
+	}
+	printf("Wrote %zu bytes to %s\n", size, output_path);
+
+	if (check) {
+		if (!tb_check(output_path, &ctx)) {
+			fprintf(stderr, "Check failed\n");
+			return 1;
+		}
+		printf("Check passed\n");
+	}
+
+	free((void*)ctx.values);
+	return 0;
+}
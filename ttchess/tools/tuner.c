@@ -0,0 +1,661 @@
+// Fits the evaluation weights to game results (Texel tuning).
+//
+// Usage: ttchess-tuner [-i log]... [-g games] [-n nodes] [-r plies]
+//                      [-l max_length] [-w weights] [-k scale] [-e epochs]
+//                      [-a rate] [-j threads] [-o weights]
+//
+// -i: Load positions from a ttchess-selfplay log, can be repeated
+// -g: Also generate this many games with alpha-beta self-play (default: 0,
+//     or 1000 when no log is given)
+// -n: Node budget per move for generated games (default: 2000)
+// -r: Random actions at the start of generated games (default: 6)
+// -l: Generated games longer than this many actions are draws (default: 600)
+// -w: Initial weights (default: ttchess_eval_default_weights)
+// -k: Scale of the score in the logistic function (default: fitted to the
+//     initial weights)
+// -e: Number of gradient descent epochs (default: 2000)
+// -a: Adam learning rate, in score units (default: 1)
+// -j: Number of worker threads (default: 4)
+// -o: Write the tuned weights to this file (default: print them)
+//
+// Every position of every game is labeled with the result for the player to
+// move: 1 for a win, 0 for a loss and 0.5 for a draw. The weights minimize
+// the mean squared error between the label and sigmoid(k * score).
+
+#include "../ttchess.h"
+#include "../eval.h"
+#include "../search.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#define TUNER_LOG_MAGIC "TTSP"
+#define TUNER_LOG_VERSION 1
+#define TUNER_LOG_FLAG_WITH_STATUES 0x01
+#define TUNER_LOG_DRAW 2
+#define TUNER_TT_SIZE_LOG2 16
+#define TUNER_MAX_INPUTS 64
+// Positions per inner loop
+#define TUNER_BLOCK_SIZE 512
+#define TUNER_LANES 8
+#define TUNER_REPORT_INTERVAL 100
+
+#define TUNER_DEFAULT_GAMES 1000
+#define TUNER_DEFAULT_NODES 2000
+#define TUNER_DEFAULT_RANDOM_PLIES 6
+#define TUNER_DEFAULT_MAX_LENGTH 600
+#define TUNER_DEFAULT_EPOCHS 2000
+#define TUNER_DEFAULT_RATE 1.0
+#define TUNER_DEFAULT_THREADS 4
+
+#define TUNER_ADAM_BETA1 0.9
+#define TUNER_ADAM_BETA2 0.999
+#define TUNER_ADAM_EPSILON 1e-8
+
+// Positions as one column per feature
+typedef struct {
+	int count;
+	int capacity;
+	float* features[TTCHESS_NUM_FEATURES];
+	// For the player to move
+	float* results;
+} tuner_dataset_t;
+
+typedef struct {
+	tuner_dataset_t* dataset;
+	mtx_t dataset_mutex;
+
+	const ttchess_eval_weights_t* weights;
+	int num_games;
+	uint64_t num_nodes;
+	int num_random_plies;
+	int max_length;
+
+	atomic_int next_game;
+} tuner_gen_ctx_t;
+
+typedef struct {
+	tuner_gen_ctx_t* ctx;
+	ttchess_tt_t* tt;
+	uint64_t rng;
+	ttchess_state_t* states;
+} tuner_gen_worker_t;
+
+typedef struct {
+	const tuner_dataset_t* dataset;
+	const ttchess_eval_weights_t* weights;
+	float scale;
+	int begin;
+	int end;
+	bool threaded;
+
+	double error;
+	double gradient[TTCHESS_NUM_FEATURES];
+} tuner_shard_t;
+
+static double
+tuner_now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t
+tuner_random(uint64_t* rng, uint32_t bound) {
+	// xorshift64*
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+	uint64_t value = *rng * 0x2545f4914f6cdd1dull;
+	return (uint32_t)(((value >> 32) * bound) >> 32);
+}
+
+static void
+tuner_dataset_cleanup(tuner_dataset_t* dataset) {
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		free(dataset->features[feature]);
+	}
+	free(dataset->results);
+	*dataset = (tuner_dataset_t){ 0 };
+}
+
+static bool
+tuner_dataset_reserve(tuner_dataset_t* dataset, int required) {
+	if (required <= dataset->capacity) { return true; }
+
+	int new_capacity = dataset->capacity > 0 ? dataset->capacity * 2 : 4096;
+	if (new_capacity < required) { new_capacity = required; }
+
+	// Each column is resized on its own, a failure leaves the old ones valid
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		float* column = realloc(dataset->features[feature], sizeof(float) * (size_t)new_capacity);
+		if (column == NULL) { return false; }
+		dataset->features[feature] = column;
+	}
+	float* results = realloc(dataset->results, sizeof(float) * (size_t)new_capacity);
+	if (results == NULL) { return false; }
+	dataset->results = results;
+
+	dataset->capacity = new_capacity;
+	return true;
+}
+
+// `winner` is a color or TUNER_LOG_DRAW
+static bool
+tuner_dataset_add_game(
+	tuner_dataset_t* dataset,
+	const ttchess_state_t* states,
+	int num_states,
+	int winner
+) {
+	if (!tuner_dataset_reserve(dataset, dataset->count + num_states)) { return false; }
+
+	for (int i = 0; i < num_states; ++i) {
+		const ttchess_state_t* state = &states[i];
+		int index = dataset->count++;
+
+		float features[TTCHESS_NUM_FEATURES];
+		ttchess_extract_features(state, features);
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			dataset->features[feature][index] = features[feature];
+		}
+
+		dataset->results[index] = winner == TUNER_LOG_DRAW
+			? 0.5f
+			: (winner == (int)state->phase.color ? 1.f : 0.f);
+	}
+
+	return true;
+}
+
+static bool
+tuner_load_log(tuner_dataset_t* dataset, const char* path, int* num_games) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+
+	uint8_t magic[5];
+	if (
+		fread(magic, sizeof(magic), 1, file) != 1
+		|| memcmp(magic, TUNER_LOG_MAGIC, 4) != 0
+		|| magic[4] != TUNER_LOG_VERSION
+	) {
+		fprintf(stderr, "%s is not a ttchess-selfplay log\n", path);
+		fclose(file);
+		return false;
+	}
+
+	ttchess_state_t* states = malloc(sizeof(ttchess_state_t) * UINT16_MAX);
+	if (states == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		fclose(file);
+		return false;
+	}
+
+	bool ok = true;
+	uint8_t header[4];
+	while (ok && fread(header, sizeof(header), 1, file) == 1) {
+		int winner = header[1];
+		int num_moves = header[2] | (header[3] << 8);
+
+		ttchess_state_t state;
+		ttchess_init(&state, (ttchess_config_t){
+			.with_statues = (header[0] & TUNER_LOG_FLAG_WITH_STATUES) != 0,
+		});
+
+		// The final state is skipped, it is already decided
+		int num_states = 0;
+		for (int i = 0; ok && i < num_moves; ++i) {
+			uint8_t move[2];
+			states[num_states++] = state;
+			ok = fread(move, sizeof(move), 1, file) == 1
+				&& ttchess_apply_move(&state, ttchess_move_unpack((uint16_t)(move[0] | (move[1] << 8))));
+		}
+		if (!ok || winner > TUNER_LOG_DRAW) {
+			fprintf(stderr, "%s is corrupted\n", path);
+			ok = false;
+		} else if (!tuner_dataset_add_game(dataset, states, num_states, winner)) {
+			fprintf(stderr, "Out of memory\n");
+			ok = false;
+		} else {
+			++*num_games;
+		}
+	}
+
+	free(states);
+	fclose(file);
+	return ok;
+}
+
+static int
+tuner_gen_play(tuner_gen_worker_t* worker, int game_index) {
+	tuner_gen_ctx_t* ctx = worker->ctx;
+
+	ttchess_state_t state;
+	ttchess_init(&state, (ttchess_config_t){ .with_statues = (game_index & 1) != 0 });
+	ttchess_tt_clear(worker->tt);
+
+	int num_states = 0;
+	while (state.phase.action != TTCHESS_ACTION_WON && num_states < ctx->max_length) {
+		ttchess_move_t move;
+		if (num_states < ctx->num_random_plies) {
+			ttchess_move_t moves[TTCHESS_MAX_MOVES];
+			int num_moves = ttchess_list_moves(&state, moves, TTCHESS_MAX_MOVES);
+			if (num_moves == 0) { break; }
+			move = moves[tuner_random(&worker->rng, (uint32_t)num_moves)];
+		} else {
+			ttchess_search_result_t result;
+			if (!ttchess_search(&state, worker->tt, (ttchess_search_config_t){
+				.node_limit = ctx->num_nodes,
+				.weights = ctx->weights,
+			}, &result)) {
+				break;
+			}
+			move = result.best_move;
+		}
+
+		worker->states[num_states++] = state;
+		ttchess_apply_move(&state, move);
+	}
+
+	int winner = state.phase.action == TTCHESS_ACTION_WON
+		? (int)state.phase.color
+		: TUNER_LOG_DRAW;
+
+	// The random opening says nothing about the result
+	int num_skipped = num_states < ctx->num_random_plies ? num_states : ctx->num_random_plies;
+	mtx_lock(&ctx->dataset_mutex);
+	bool ok = tuner_dataset_add_game(
+		ctx->dataset,
+		worker->states + num_skipped,
+		num_states - num_skipped,
+		winner
+	);
+	mtx_unlock(&ctx->dataset_mutex);
+
+	return ok ? thrd_success : thrd_nomem;
+}
+
+static int
+tuner_gen_worker_main(void* userdata) {
+	tuner_gen_worker_t* worker = userdata;
+	tuner_gen_ctx_t* ctx = worker->ctx;
+
+	int game_index;
+	while ((game_index = atomic_fetch_add(&ctx->next_game, 1)) < ctx->num_games) {
+		if (tuner_gen_play(worker, game_index) != thrd_success) {
+			// Stop everyone else too
+			atomic_store(&ctx->next_game, ctx->num_games);
+			return thrd_nomem;
+		}
+	}
+
+	return thrd_success;
+}
+
+static bool
+tuner_generate(tuner_gen_ctx_t* ctx, int num_threads) {
+	tuner_gen_worker_t* workers = calloc((size_t)num_threads, sizeof(tuner_gen_worker_t));
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (workers == NULL || threads == NULL) {
+		free(workers);
+		free(threads);
+		return false;
+	}
+
+	mtx_init(&ctx->dataset_mutex, mtx_plain);
+	atomic_init(&ctx->next_game, 0);
+
+	int num_started = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		tuner_gen_worker_t* worker = &workers[i];
+		worker->ctx = ctx;
+		worker->rng = ((uint64_t)i + 1) * 0x9e3779b97f4a7c15ull;
+
+		void* mem = malloc(ttchess_tt_mem_size(TUNER_TT_SIZE_LOG2));
+		worker->states = malloc(sizeof(ttchess_state_t) * (size_t)ctx->max_length);
+		if (mem == NULL || worker->states == NULL) {
+			free(mem);
+			free(worker->states);
+			break;
+		}
+		worker->tt = ttchess_tt_init(mem, TUNER_TT_SIZE_LOG2);
+
+		if (thrd_create(&threads[i], tuner_gen_worker_main, worker) != thrd_success) {
+			free(worker->tt);
+			free(worker->states);
+			break;
+		}
+		++num_started;
+	}
+
+	bool ok = num_started > 0;
+	for (int i = 0; i < num_started; ++i) {
+		int result;
+		thrd_join(threads[i], &result);
+		ok &= result == thrd_success;
+		free(workers[i].tt);
+		free(workers[i].states);
+	}
+
+	mtx_destroy(&ctx->dataset_mutex);
+	free(threads);
+	free(workers);
+	return ok;
+}
+
+// Lane-wise partial sums vectorize without reassociating floating point
+// math, which the compiler is not allowed to do on its own
+static inline float
+tuner_dot(const float* restrict lhs, const float* restrict rhs, int count) {
+	float lanes[TUNER_LANES] = { 0 };
+	int i = 0;
+	for (; i + TUNER_LANES <= count; i += TUNER_LANES) {
+		for (int lane = 0; lane < TUNER_LANES; ++lane) {
+			lanes[lane] += lhs[i + lane] * rhs[i + lane];
+		}
+	}
+	for (; i < count; ++i) {
+		lanes[i % TUNER_LANES] += lhs[i] * rhs[i];
+	}
+
+	float sum = 0.f;
+	for (int lane = 0; lane < TUNER_LANES; ++lane) {
+		sum += lanes[lane];
+	}
+	return sum;
+}
+
+static int
+tuner_shard_main(void* userdata) {
+	tuner_shard_t* shard = userdata;
+	const tuner_dataset_t* dataset = shard->dataset;
+	float scale = shard->scale;
+
+	shard->error = 0.0;
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		shard->gradient[feature] = 0.0;
+	}
+
+	float scores[TUNER_BLOCK_SIZE];
+	float diffs[TUNER_BLOCK_SIZE];
+	float deltas[TUNER_BLOCK_SIZE];
+	for (int start = shard->begin; start < shard->end; start += TUNER_BLOCK_SIZE) {
+		int block_size = shard->end - start < TUNER_BLOCK_SIZE
+			? shard->end - start
+			: TUNER_BLOCK_SIZE;
+
+		const float* columns[TTCHESS_NUM_FEATURES];
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			columns[feature] = dataset->features[feature] + start;
+		}
+		ttchess_evaluate_features(shard->weights, columns, block_size, scores);
+
+		const float* restrict results = dataset->results + start;
+		for (int i = 0; i < block_size; ++i) {
+			float prediction = 1.f / (1.f + expf(-scale * scores[i]));
+			diffs[i] = prediction - results[i];
+			// d(error) / d(score) without the factor 2, the feature is applied
+			// below
+			deltas[i] = diffs[i] * prediction * (1.f - prediction) * scale;
+		}
+
+		shard->error += tuner_dot(diffs, diffs, block_size);
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			shard->gradient[feature] += tuner_dot(deltas, columns[feature], block_size);
+		}
+	}
+
+	return thrd_success;
+}
+
+// Mean squared error, the gradient is summed over all positions
+static double
+tuner_evaluate(
+	const tuner_dataset_t* dataset,
+	const ttchess_eval_weights_t* weights,
+	float scale,
+	tuner_shard_t* shards,
+	thrd_t* threads,
+	int num_shards,
+	double gradient[TTCHESS_NUM_FEATURES]
+) {
+	int shard_size = (dataset->count + num_shards - 1) / num_shards;
+	for (int i = 0; i < num_shards; ++i) {
+		int begin = i * shard_size;
+		shards[i] = (tuner_shard_t){
+			.dataset = dataset,
+			.weights = weights,
+			.scale = scale,
+			.begin = begin < dataset->count ? begin : dataset->count,
+			.end = begin + shard_size < dataset->count ? begin + shard_size : dataset->count,
+		};
+
+		// The first shard runs on this thread, so does any shard whose thread
+		// could not be started
+		shards[i].threaded = i > 0
+			&& thrd_create(&threads[i], tuner_shard_main, &shards[i]) == thrd_success;
+	}
+
+	for (int i = 0; i < num_shards; ++i) {
+		if (shards[i].threaded) {
+			thrd_join(threads[i], NULL);
+		} else {
+			tuner_shard_main(&shards[i]);
+		}
+	}
+
+	double error = 0.0;
+	for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+		gradient[feature] = 0.0;
+	}
+	// Summed in shard order so results do not depend on thread timing
+	for (int i = 0; i < num_shards; ++i) {
+		error += shards[i].error;
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			gradient[feature] += shards[i].gradient[feature];
+		}
+	}
+
+	return error / (double)dataset->count;
+}
+
+int
+main(int argc, const char** argv) {
+	const char* inputs[TUNER_MAX_INPUTS];
+	int num_inputs = 0;
+	int num_games_to_generate = -1;
+	uint64_t num_nodes = TUNER_DEFAULT_NODES;
+	int num_random_plies = TUNER_DEFAULT_RANDOM_PLIES;
+	int max_length = TUNER_DEFAULT_MAX_LENGTH;
+	const char* initial_weights_path = NULL;
+	float scale = 0.f;
+	int num_epochs = TUNER_DEFAULT_EPOCHS;
+	double rate = TUNER_DEFAULT_RATE;
+	int num_threads = TUNER_DEFAULT_THREADS;
+	const char* output_path = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-i") == 0 && i + 1 < argc && num_inputs < TUNER_MAX_INPUTS) {
+			inputs[num_inputs++] = argv[++i];
+		} else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			num_games_to_generate = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			num_nodes = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			num_random_plies = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			max_length = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			initial_weights_path = argv[++i];
+		} else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+			scale = strtof(argv[++i], NULL);
+		} else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			num_epochs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			rate = strtod(argv[++i], NULL);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			num_threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else {
+			fprintf(
+				stderr,
+				"Usage: %s [-i log]... [-g games] [-n nodes] [-r plies] [-l max_length] [-w weights] [-k scale] [-e epochs] [-a rate] [-j threads] [-o weights]\n",
+				argv[0]
+			);
+			return 1;
+		}
+	}
+
+	if (num_threads < 1) { num_threads = 1; }
+	if (num_games_to_generate < 0) {
+		num_games_to_generate = num_inputs == 0 ? TUNER_DEFAULT_GAMES : 0;
+	}
+	if (num_random_plies < 0) { num_random_plies = 0; }
+	if (max_length < 1 || max_length > UINT16_MAX) { max_length = UINT16_MAX; }
+
+	ttchess_eval_weights_t weights;
+	if (initial_weights_path == NULL) {
+		ttchess_eval_default_weights(&weights);
+	} else if (!ttchess_eval_load_weights(&weights, initial_weights_path)) {
+		fprintf(stderr, "Could not load weights from %s\n", initial_weights_path);
+		return 1;
+	}
+
+	tuner_dataset_t dataset = { 0 };
+	int num_games = 0;
+	double start = tuner_now();
+	for (int i = 0; i < num_inputs; ++i) {
+		if (!tuner_load_log(&dataset, inputs[i], &num_games)) {
+			tuner_dataset_cleanup(&dataset);
+			return 1;
+		}
+	}
+
+	if (num_games_to_generate > 0) {
+		tuner_gen_ctx_t gen_ctx = {
+			.dataset = &dataset,
+			.weights = &weights,
+			.num_games = num_games_to_generate,
+			.num_nodes = num_nodes,
+			.num_random_plies = num_random_plies,
+			.max_length = max_length,
+		};
+		if (!tuner_generate(&gen_ctx, num_threads)) {
+			fprintf(stderr, "Could not generate games\n");
+			tuner_dataset_cleanup(&dataset);
+			return 1;
+		}
+		num_games += num_games_to_generate;
+	}
+
+	if (dataset.count == 0) {
+		fprintf(stderr, "No positions\n");
+		tuner_dataset_cleanup(&dataset);
+		return 1;
+	}
+	printf(
+		"%d positions from %d games in %.3fs\n",
+		dataset.count, num_games, tuner_now() - start
+	);
+
+	tuner_shard_t* shards = calloc((size_t)num_threads, sizeof(tuner_shard_t));
+	thrd_t* threads = calloc((size_t)num_threads, sizeof(thrd_t));
+	if (shards == NULL || threads == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		free(shards);
+		free(threads);
+		tuner_dataset_cleanup(&dataset);
+		return 1;
+	}
+
+	double gradient[TTCHESS_NUM_FEATURES];
+	if (scale <= 0.f) {
+		// The error is unimodal in the scale, golden section search on its log
+		double low = log(1e-5);
+		double high = log(1.0);
+		const double ratio = 0.6180339887498949;
+		for (int iteration = 0; iteration < 40; ++iteration) {
+			double mid_low = high - ratio * (high - low);
+			double mid_high = low + ratio * (high - low);
+			double error_low = tuner_evaluate(
+				&dataset, &weights, (float)exp(mid_low), shards, threads, num_threads, gradient
+			);
+			double error_high = tuner_evaluate(
+				&dataset, &weights, (float)exp(mid_high), shards, threads, num_threads, gradient
+			);
+			if (error_low < error_high) {
+				high = mid_high;
+			} else {
+				low = mid_low;
+			}
+		}
+		scale = (float)exp((low + high) * 0.5);
+	}
+
+	double initial_error = tuner_evaluate(&dataset, &weights, scale, shards, threads, num_threads, gradient);
+	printf("Scale: %g\n", scale);
+	printf("Initial error: %.6f\n", initial_error);
+
+	// Adam, with the gradient averaged over the dataset
+	double moments[TTCHESS_NUM_FEATURES] = { 0 };
+	double second_moments[TTCHESS_NUM_FEATURES] = { 0 };
+	double beta1_power = 1.0;
+	double beta2_power = 1.0;
+	double error = initial_error;
+	start = tuner_now();
+	for (int epoch = 1; epoch <= num_epochs; ++epoch) {
+		error = tuner_evaluate(&dataset, &weights, scale, shards, threads, num_threads, gradient);
+
+		beta1_power *= TUNER_ADAM_BETA1;
+		beta2_power *= TUNER_ADAM_BETA2;
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			double g = 2.0 * gradient[feature] / (double)dataset.count;
+			moments[feature] = TUNER_ADAM_BETA1 * moments[feature] + (1.0 - TUNER_ADAM_BETA1) * g;
+			second_moments[feature] = TUNER_ADAM_BETA2 * second_moments[feature]
+				+ (1.0 - TUNER_ADAM_BETA2) * g * g;
+
+			double m = moments[feature] / (1.0 - beta1_power);
+			double v = second_moments[feature] / (1.0 - beta2_power);
+			weights.weights[feature] -= (float)(rate * m / (sqrt(v) + TUNER_ADAM_EPSILON));
+		}
+
+		if (epoch % TUNER_REPORT_INTERVAL == 0) {
+			printf("Epoch %d: error %.6f\n", epoch, error);
+		}
+	}
+	double elapsed = tuner_now() - start;
+	error = tuner_evaluate(&dataset, &weights, scale, shards, threads, num_threads, gradient);
+	printf(
+		"Final error: %.6f after %d epochs in %.3fs (%.0f positions/s)\n",
+		error,
+		num_epochs,
+		elapsed,
+		elapsed > 0.0 ? (double)dataset.count * num_epochs / elapsed : 0.0
+	);
+
+	free(shards);
+	free(threads);
+	tuner_dataset_cleanup(&dataset);
+
+	if (output_path != NULL) {
+		if (!ttchess_eval_save_weights(&weights, output_path)) {
+			fprintf(stderr, "Could not write %s\n", output_path);
+			return 1;
+		}
+	} else {
+		for (int feature = 0; feature < TTCHESS_NUM_FEATURES; ++feature) {
+			printf("%s %.6g\n", ttchess_feature_names[feature], weights.weights[feature]);
+		}
+	}
+
+	return 0;
+}
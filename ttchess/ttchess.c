@@ -1,7 +1,29 @@
 #include "ttchess.h"
+#include "stats.h"
 #include <stdlib.h>
 
+#ifdef TTCHESS_CHECK_DERIVED
+#	include <assert.h>
+#	define TTCHESS_ASSERT_DERIVED(state) assert(ttchess_check_derived(state))
+#else
+#	define TTCHESS_ASSERT_DERIVED(state) (void)0
+#endif
+
 #define TTCHESS_NUM_CARDINAL_DIRECTIONS 4
+#define TTCHESS_BITBOARD_FIRST_COLUMN 0x1111
+#define TTCHESS_BITBOARD_LAST_COLUMN 0x8888
+#define TTCHESS_NUM_CELLS (TTCHESS_BOARD_WIDTH * TTCHESS_BOARD_HEIGHT)
+#define TTCHESS_NUM_ACTIONS (TTCHESS_ACTION_WON + 1)
+#define TTCHESS_PACKED_OFF_BOARD 0x80
+#define TTCHESS_PACKED_POS_MASK 0x0f
+
+// Offsets into the Zobrist key space
+#define TTCHESS_ZOBRIST_PAWN 0
+#define TTCHESS_ZOBRIST_DEAD_PAWN (TTCHESS_ZOBRIST_PAWN + TTCHESS_NUM_PAWNS * TTCHESS_NUM_ERAS * TTCHESS_NUM_CELLS)
+#define TTCHESS_ZOBRIST_STATUE (TTCHESS_ZOBRIST_DEAD_PAWN + TTCHESS_NUM_PAWNS)
+#define TTCHESS_ZOBRIST_FOCUS (TTCHESS_ZOBRIST_STATUE + TTCHESS_NUM_STATUES * TTCHESS_NUM_ERAS * TTCHESS_NUM_CELLS)
+#define TTCHESS_ZOBRIST_PHASE (TTCHESS_ZOBRIST_FOCUS + TTCHESS_NUM_PLAYERS * TTCHESS_NUM_ERAS)
+#define TTCHESS_ZOBRIST_LAST_PAWN (TTCHESS_ZOBRIST_PHASE + TTCHESS_NUM_PLAYERS * TTCHESS_NUM_ACTIONS)
 
 typedef struct {
 	ttchess_move_t* storage;
@@ -23,41 +45,199 @@ ttchess_pos_is_on_board(ttchess_pos_t pos) {
 		&& (0 <= pos.y && pos.y < TTCHESS_BOARD_HEIGHT);
 }
 
-static inline ttchess_board_t*
-ttchess_pawn_board(ttchess_state_t* state, int8_t pawn_id) {
-	const ttchess_pawn_t* pawn = &state->pawns[pawn_id];
+static inline bool
+ttchess_pos_equal(ttchess_pos_t lhs, ttchess_pos_t rhs) {
+	return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+static inline ttchess_bitboard_t
+ttchess_bitboard_adjacent(ttchess_bitboard_t bitboard) {
+	return (ttchess_bitboard_t)(
+		  ((bitboard & ~TTCHESS_BITBOARD_LAST_COLUMN) << 1)
+		| ((bitboard & ~TTCHESS_BITBOARD_FIRST_COLUMN) >> 1)
+		| (bitboard << TTCHESS_BOARD_WIDTH)
+		| (bitboard >> TTCHESS_BOARD_WIDTH)
+	);
+}
+
+static inline ttchess_pos_t
+ttchess_bitboard_first_pos(ttchess_bitboard_t bitboard) {
+#if defined(__GNUC__) || defined(__clang__)
+	int index = __builtin_ctz(bitboard);
+#else
+	int index = 0;
+	while (!(bitboard & 1)) {
+		bitboard >>= 1;
+		++index;
+	}
+#endif
+
+	return (ttchess_pos_t){
+		.x = index % TTCHESS_BOARD_WIDTH,
+		.y = index / TTCHESS_BOARD_WIDTH,
+	};
+}
+
+static inline uint64_t
+ttchess_zobrist_key(int index) {
+	// Keys are a hash of their index (splitmix64) so there is no table to
+	// initialize and they stay the same across runs
+	uint64_t key = (uint64_t)(index + 1) * 0x9e3779b97f4a7c15ull;
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+	return key ^ (key >> 31);
+}
+
+static inline uint64_t
+ttchess_piece_key(ttchess_cell_t cell, ttchess_era_t era, ttchess_pos_t pos) {
+	int cell_index = (int)era * TTCHESS_NUM_CELLS + pos.y * TTCHESS_BOARD_WIDTH + pos.x;
+	switch (cell.piece_type) {
+		case TTCHESS_PIECE_PAWN:
+			return ttchess_zobrist_key(
+				TTCHESS_ZOBRIST_PAWN + cell.piece_id * TTCHESS_NUM_ERAS * TTCHESS_NUM_CELLS + cell_index
+			);
+		case TTCHESS_PIECE_STATUE:
+			return ttchess_zobrist_key(
+				TTCHESS_ZOBRIST_STATUE + cell.piece_id * TTCHESS_NUM_ERAS * TTCHESS_NUM_CELLS + cell_index
+			);
+		default:
+			return 0;
+	}
+}
+
+static inline uint64_t
+ttchess_turn_key(const ttchess_state_t* state) {
+	uint64_t key = ttchess_zobrist_key(
+		TTCHESS_ZOBRIST_PHASE + state->phase.color * TTCHESS_NUM_ACTIONS + state->phase.action
+	);
+	key ^= ttchess_zobrist_key(TTCHESS_ZOBRIST_LAST_PAWN + state->last_pawn);
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		key ^= ttchess_zobrist_key(TTCHESS_ZOBRIST_FOCUS + color * TTCHESS_NUM_ERAS + state->focuses[color]);
+	}
+
+	return key;
+}
+
+static inline void
+ttchess_clear_cell(ttchess_state_t* state, ttchess_era_t era, ttchess_pos_t pos) {
+	ttchess_board_t* board = &state->boards[era];
+	ttchess_cell_t* cell = &board->cells[pos.x][pos.y];
+	ttchess_bitboard_t mask = (ttchess_bitboard_t)~ttchess_pos_bit(pos);
+	board->pawns[TTCHESS_COLOR_WHITE] &= mask;
+	board->pawns[TTCHESS_COLOR_BLACK] &= mask;
+	board->statues &= mask;
+	state->hash ^= ttchess_piece_key(*cell, era, pos);
+	// Empty cells are all alike so that states compare with memcmp
+	cell->piece_type = TTCHESS_PIECE_NONE;
+	cell->piece_id = 0;
+}
+
+static inline void
+ttchess_place_pawn(ttchess_state_t* state, ttchess_era_t era, ttchess_pos_t pos, int8_t pawn_id) {
+	ttchess_clear_cell(state, era, pos);
+
+	ttchess_board_t* board = &state->boards[era];
+	ttchess_cell_t* cell = &board->cells[pos.x][pos.y];
+	board->pawns[ttchess_pawn_color(pawn_id)] |= ttchess_pos_bit(pos);
+	cell->piece_type = TTCHESS_PIECE_PAWN;
+	cell->piece_id = pawn_id;
+	state->hash ^= ttchess_piece_key(*cell, era, pos);
+}
+
+static inline void
+ttchess_place_statue(ttchess_state_t* state, ttchess_era_t era, ttchess_pos_t pos, int8_t statue_id) {
+	ttchess_clear_cell(state, era, pos);
+
+	ttchess_board_t* board = &state->boards[era];
+	ttchess_cell_t* cell = &board->cells[pos.x][pos.y];
+	board->statues |= ttchess_pos_bit(pos);
+	cell->piece_type = TTCHESS_PIECE_STATUE;
+	cell->piece_id = statue_id;
+	state->hash ^= ttchess_piece_key(*cell, era, pos);
+}
+
+static inline bool
+ttchess_pawn_era(const ttchess_pawn_t* pawn, ttchess_era_t* era) {
 	switch (pawn->status) {
-		case TTCHESS_PAWN_PAST:    return &state->boards[0];
-		case TTCHESS_PAWN_PRESENT: return &state->boards[1];
-		case TTCHESS_PAWN_FUTURE:  return &state->boards[2];
-		default: return NULL;
+		case TTCHESS_PAWN_PAST:
+			*era = TTCHESS_ERA_PAST;
+			return true;
+		case TTCHESS_PAWN_PRESENT:
+			*era = TTCHESS_ERA_PRESENT;
+			return true;
+		case TTCHESS_PAWN_FUTURE:
+			*era = TTCHESS_ERA_FUTURE;
+			return true;
+		default:
+			return false;
+	}
+}
+
+uint64_t
+ttchess_compute_hash(const ttchess_state_t* state) {
+	uint64_t hash = ttchess_turn_key(state);
+
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		const ttchess_pawn_t* pawn = &state->pawns[pawn_index];
+		ttchess_era_t pawn_era;
+
+		if (ttchess_pawn_era(pawn, &pawn_era)) {
+			ttchess_cell_t cell = { .piece_type = TTCHESS_PIECE_PAWN, .piece_id = pawn_index };
+			hash ^= ttchess_piece_key(cell, pawn_era, pawn->pos);
+		} else if (pawn->status == TTCHESS_PAWN_DEAD) {
+			hash ^= ttchess_zobrist_key(TTCHESS_ZOBRIST_DEAD_PAWN + pawn_index);
+		}
+	}
+
+	if (state->config.with_statues) {
+		for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+			for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+				ttchess_pos_t pos = state->statues[statue_index].positions[era];
+				if (ttchess_pos_is_on_board(pos)) {
+					ttchess_cell_t cell = { .piece_type = TTCHESS_PIECE_STATUE, .piece_id = statue_index };
+					hash ^= ttchess_piece_key(cell, era, pos);
+				}
+			}
+		}
 	}
+
+	return hash;
 }
 
 static inline void
 ttchess_state_reindex(ttchess_state_t* state) {
+	TTCHESS_STATS_COUNT(reindex_calls);
+
 	// Reset boards
 	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
 		ttchess_board_t* board = &state->boards[era];
 		board->num_pawns[TTCHESS_COLOR_WHITE] = 0;
 		board->num_pawns[TTCHESS_COLOR_BLACK] = 0;
+		board->pawns[TTCHESS_COLOR_WHITE] = 0;
+		board->pawns[TTCHESS_COLOR_BLACK] = 0;
+		board->statues = 0;
 
 		for (int x = 0; x < TTCHESS_BOARD_WIDTH; ++x) {
 			for (int y = 0; y < TTCHESS_BOARD_HEIGHT; ++y) {
-				board->cells[x][y].piece_type = TTCHESS_PIECE_NONE;
+				board->cells[x][y] = (ttchess_cell_t){ .piece_type = TTCHESS_PIECE_NONE };
 			}
 		}
 	}
 
+	// Placing pieces keeps updating the hash so only the keys which are not
+	// tied to a cell are needed up front
+	state->hash = ttchess_turn_key(state);
+
 	// Place pawns
 	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
 		ttchess_pawn_t* pawn = &state->pawns[pawn_index];
-		ttchess_board_t* pawn_board = ttchess_pawn_board(state, pawn_index);
+		ttchess_era_t pawn_era;
 
-		if (pawn_board != NULL) {
-			pawn_board->cells[pawn->pos.x][pawn->pos.y].piece_type = TTCHESS_PIECE_PAWN;
-			pawn_board->cells[pawn->pos.x][pawn->pos.y].piece_id = pawn_index;
-			pawn_board->num_pawns[ttchess_pawn_color(pawn_index)] += 1;
+		if (ttchess_pawn_era(pawn, &pawn_era)) {
+			ttchess_place_pawn(state, pawn_era, pawn->pos, pawn_index);
+			state->boards[pawn_era].num_pawns[ttchess_pawn_color(pawn_index)] += 1;
+		} else if (pawn->status == TTCHESS_PAWN_DEAD) {
+			state->hash ^= ttchess_zobrist_key(TTCHESS_ZOBRIST_DEAD_PAWN + pawn_index);
 		}
 	}
 
@@ -70,12 +250,101 @@ ttchess_state_reindex(ttchess_state_t* state) {
 				ttchess_pos_t pos = state->statues[statue_index].positions[era];
 				if (ttchess_pos_is_on_board(pos)) {
 					state->statue_built[statue_index] = true;
-					state->boards[era].cells[pos.x][pos.y].piece_type = TTCHESS_PIECE_STATUE;
-					state->boards[era].cells[pos.x][pos.y].piece_id = statue_index;
+					ttchess_place_statue(state, era, pos, statue_index);
+				}
+			}
+		}
+	}
+}
+
+bool
+ttchess_check_derived(const ttchess_state_t* state) {
+	ttchess_state_t expected = *state;
+	ttchess_state_reindex(&expected);
+	if (state->hash != expected.hash) { return false; }
+
+	for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+		const ttchess_board_t* board = &state->boards[era];
+		const ttchess_board_t* expected_board = &expected.boards[era];
+		if (board->statues != expected_board->statues) { return false; }
+
+		for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+			if (
+				board->num_pawns[color] != expected_board->num_pawns[color]
+				|| board->pawns[color] != expected_board->pawns[color]
+			) {
+				return false;
+			}
+		}
+
+		// Empty cells keep whatever piece_id they last had
+		for (int x = 0; x < TTCHESS_BOARD_WIDTH; ++x) {
+			for (int y = 0; y < TTCHESS_BOARD_HEIGHT; ++y) {
+				ttchess_cell_t cell = board->cells[x][y];
+				ttchess_cell_t expected_cell = expected_board->cells[x][y];
+				if (cell.piece_type != expected_cell.piece_type) { return false; }
+				if (
+					cell.piece_type != TTCHESS_PIECE_NONE
+					&& cell.piece_id != expected_cell.piece_id
+				) {
+					return false;
+				}
+			}
+		}
+	}
+
+	if (state->config.with_statues) {
+		for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+			if (state->statue_built[statue_index] != expected.statue_built[statue_index]) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Whether the two states agree on everything the derived fields are built from
+static inline bool
+ttchess_base_equal(const ttchess_state_t* lhs, const ttchess_state_t* rhs) {
+	if (
+		lhs->config.with_statues != rhs->config.with_statues
+		|| lhs->phase.action != rhs->phase.action
+		|| lhs->phase.color != rhs->phase.color
+		|| lhs->last_pawn != rhs->last_pawn
+	) {
+		return false;
+	}
+
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		if (lhs->focuses[color] != rhs->focuses[color]) { return false; }
+	}
+
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		const ttchess_pawn_t* lhs_pawn = &lhs->pawns[pawn_index];
+		const ttchess_pawn_t* rhs_pawn = &rhs->pawns[pawn_index];
+		if (
+			lhs_pawn->status != rhs_pawn->status
+			|| !ttchess_pos_equal(lhs_pawn->pos, rhs_pawn->pos)
+		) {
+			return false;
+		}
+	}
+
+	if (lhs->config.with_statues) {
+		for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+			for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+				if (!ttchess_pos_equal(
+					lhs->statues[statue_index].positions[era],
+					rhs->statues[statue_index].positions[era]
+				)) {
+					return false;
 				}
 			}
 		}
 	}
+
+	return true;
 }
 
 void
@@ -134,11 +403,18 @@ ttchess_init(ttchess_state_t* state, ttchess_config_t config) {
 }
 
 static inline bool
-ttchess_validate_move_pos_adjacent(const ttchess_pawn_t* pawn, ttchess_move_t move) {
-	int delta_x = (int)move.pos.x - pawn->pos.x;
-	int delta_y = (int)move.pos.y - pawn->pos.y;
-	return (abs(delta_x) == 1 && delta_y == 0)
-		|| (abs(delta_y) == 1 && delta_x == 0);
+ttchess_has_reserve_pawn(const ttchess_state_t* state, ttchess_color_t color) {
+	int pawn_min = color == TTCHESS_COLOR_WHITE
+		? TTCHESS_FIRST_WHITE_PAWN
+		: TTCHESS_FIRST_BLACK_PAWN;
+	int pawn_max = pawn_min + TTCHESS_NUM_PAWNS / 2;
+	for (int pawn_index = pawn_min; pawn_index < pawn_max; ++pawn_index) {
+		if (state->pawns[pawn_index].status == TTCHESS_PAWN_RESERVE) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 static inline bool
@@ -149,60 +425,37 @@ ttchess_piece_can_move(
 	ttchess_pos_t to,
 	int depth
 ) {
+	TTCHESS_STATS_COUNT_BUCKET(can_move_depth, depth);
 	if (depth > TTCHESS_BOARD_WIDTH) { return false; }
-	if (!ttchess_pos_is_on_board(from)) { return false; }
+	const ttchess_board_t* board = &state->boards[era];
+	ttchess_bitboard_t from_bit = ttchess_pos_bit(from);
+	ttchess_bitboard_t to_bit = ttchess_pos_bit(to);
+	if (from_bit == 0) { return false; }
+
+	if (board->statues & from_bit) {
+		// Statue cannot be pushed off board
+		if (to_bit == 0) { return false; }
+	} else if (ttchess_board_pawns(board) & from_bit) {
+		// Pawn can be pushed off board but can't commit suicide
+		if (to_bit == 0) { return depth > 0; }
+	} else {
+		// Cannot move nothing but can push things there
+		return depth > 0;
+	}
+
+	// Pawns in the way cause a paradox, a push or a squish.
+	// Statues in the way must be pushed along.
+	if (!(board->statues & to_bit)) { return true; }
+
 	ttchess_pos_t target_next = {
 		.x = to.x + (to.x - from.x),
 		.y = to.y + (to.y - from.y),
 	};
-
-	ttchess_cell_t piece = state->boards[era].cells[from.x][from.y];
-	switch (piece.piece_type) {
-		case TTCHESS_PIECE_NONE:
-			// Cannot move nothing but can push things there
-			return depth > 0;
-		case TTCHESS_PIECE_PAWN: {
-			// Pawn can be pushed off board but can't commit suicide
-			if (!ttchess_pos_is_on_board(to)) {
-				return depth > 0;
-			}
-
-			ttchess_cell_t target = state->boards[era].cells[to.x][to.y];
-			switch (target.piece_type) {
-				case TTCHESS_PIECE_NONE:
-					return true;
-				case TTCHESS_PIECE_PAWN:
-					// Paradox, push or squish
-					return true;
-				case TTCHESS_PIECE_STATUE: {
-					return ttchess_piece_can_move(state, era, to, target_next, depth + 1);
-				}
-			}
-		}
-		case TTCHESS_PIECE_STATUE: {
-			// Statue cannot be pushed off board
-			if (!ttchess_pos_is_on_board(to)) {
-				return false;
-			}
-			ttchess_cell_t target = state->boards[era].cells[to.x][to.y];
-			switch (target.piece_type) {
-				case TTCHESS_PIECE_NONE:
-					return true;
-				case TTCHESS_PIECE_PAWN:
-					// Paradox, push or squish
-					return true;
-				case TTCHESS_PIECE_STATUE: {
-					return ttchess_piece_can_move(state, era, to, target_next, depth + 1);
-				}
-			}
-		}
-	}
-
-	return false;
+	return ttchess_piece_can_move(state, era, to, target_next, depth + 1);
 }
 
 static inline bool
-ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
+ttchess_validate_move_impl(const ttchess_state_t* state, ttchess_move_t move) {
 	ttchess_phase_t phase = state->phase;
 
 	// Validate action type against phase
@@ -257,11 +510,15 @@ ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
 		return false;
 	}
 
+	const ttchess_board_t* board = &state->boards[pawn_era];
+	ttchess_bitboard_t pawn_bit = ttchess_pos_bit(pawn->pos);
+	// Off board targets have an empty mask so this also does the range check
+	ttchess_bitboard_t adjacent_target_bit = ttchess_bitboard_adjacent(pawn_bit) & ttchess_pos_bit(move.pos);
+
 	switch (move.type) {
 		// Core
 		case TTCHESS_MOVE_PAWN: {
-			if (!ttchess_pos_is_on_board(move.pos)) { return false; }
-			if (!ttchess_validate_move_pos_adjacent(pawn, move)) { return false; }
+			if (!adjacent_target_bit) { return false; }
 
 			return ttchess_piece_can_move(state, pawn_era, pawn->pos, move.pos, 0);
 		}
@@ -273,23 +530,10 @@ ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
 			if (move.era == pawn_era) { return false; }
 
 			// Target location must be empty
-			ttchess_cell_t cell = state->boards[move.era].cells[pawn->pos.x][pawn->pos.y];
-			if (cell.piece_type != TTCHESS_PIECE_NONE) { return false; }
+			if (ttchess_board_occupied(&state->boards[move.era]) & pawn_bit) { return false; }
 
 			// To travel to an earlier era, there must be a spare pawn
-			if (move.era < pawn_era) {
-				int pawn_min = phase.color == TTCHESS_COLOR_WHITE
-					? TTCHESS_FIRST_WHITE_PAWN
-					: TTCHESS_FIRST_BLACK_PAWN;
-				int pawn_max = pawn_min + TTCHESS_NUM_PAWNS / 2;
-				for (int pawn_index = pawn_min; pawn_index < pawn_max; ++pawn_index) {
-					if (state->pawns[pawn_index].status == TTCHESS_PAWN_RESERVE) {
-						return true;
-					}
-				}
-			}
-
-			return false;
+			return move.era < pawn_era && ttchess_has_reserve_pawn(state, phase.color);
 		}
 		case TTCHESS_MOVE_SHIFT_FOCUS: {
 			if (!(TTCHESS_ERA_PAST <= move.era && move.era <= TTCHESS_ERA_FUTURE)) {
@@ -301,25 +545,23 @@ ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
 		// Statue
 		case TTCHESS_MOVE_BUILD_STATUE: {
 			if (!state->config.with_statues) { return false; }
-			if (!ttchess_pos_is_on_board(move.pos)) { return false; }
-			if (!ttchess_validate_move_pos_adjacent(pawn, move)) { return false; }
+			if (!adjacent_target_bit) { return false; }
 			if (state->statue_built[phase.color]) { return false; }
 
-			ttchess_cell_t cell = state->boards[pawn_era].cells[move.pos.x][move.pos.y];
-			return cell.piece_type == TTCHESS_PIECE_NONE;
+			return !(ttchess_board_occupied(board) & adjacent_target_bit);
 		}
 		case TTCHESS_MOVE_PULL_STATUE: {
-			if (!ttchess_pos_is_on_board(move.pos)) { return false; }
-			if (!ttchess_validate_move_pos_adjacent(pawn, move)) { return false; }
+			if (!adjacent_target_bit) { return false; }
 
 			ttchess_pos_t statue_pos = {
 				.x = pawn->pos.x - (move.pos.x - pawn->pos.x),
 				.y = pawn->pos.y - (move.pos.y - pawn->pos.y),
 			};
-			ttchess_cell_t cell = state->boards[pawn_era].cells[statue_pos.x][statue_pos.y];
-			if (cell.piece_type != TTCHESS_PIECE_STATUE) {
-				return false;
-			}
+			if (!(board->statues & ttchess_pos_bit(statue_pos))) { return false; }
+
+			// Only the statue being pulled is a valid subject
+			ttchess_cell_t cell = board->cells[statue_pos.x][statue_pos.y];
+			if (cell.piece_id != move.subject_id) { return false; }
 
 			return ttchess_piece_can_move(state, pawn_era, pawn->pos, move.pos, 1);
 		}
@@ -338,6 +580,16 @@ ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
 	return false;
 }
 
+static inline bool
+ttchess_validate_move(const ttchess_state_t* state, ttchess_move_t move) {
+	bool is_valid = ttchess_validate_move_impl(state, move);
+	TTCHESS_STATS_COUNT_AT(validate_calls, move.type);
+	if (is_valid) {
+		TTCHESS_STATS_COUNT_AT(validate_accepted, move.type);
+	}
+	return is_valid;
+}
+
 static inline void
 ttchess_add_move_if_legal(ttchess_move_list_t* move_list, const ttchess_state_t* state, ttchess_move_t move) {
 	if (ttchess_validate_move(state, move)) {
@@ -401,7 +653,7 @@ ttchess_add_pawn_moves(ttchess_move_list_t* move_list, const ttchess_state_t* st
 }
 
 int
-ttchess_list_moves(
+ttchess_list_moves_reference(
 	const ttchess_state_t* state,
 	ttchess_move_t* moves,
 	int moves_len
@@ -412,37 +664,180 @@ ttchess_list_moves(
 	};
 	switch (state->phase.action) {
 		case TTCHESS_ACTION_FIRST: {
-			ttchess_era_t focused_era = state->focuses[state->phase.color];
-			int pawn_min = state->phase.color == TTCHESS_COLOR_WHITE
-				? TTCHESS_FIRST_WHITE_PAWN
-				: TTCHESS_FIRST_BLACK_PAWN;
-			int pawn_max = pawn_min + TTCHESS_NUM_PAWNS / 2;
-			for (int pawn_index = pawn_min; pawn_index < pawn_max; ++pawn_index) {
-				const ttchess_pawn_t* pawn = &state->pawns[pawn_index];
-				if (
-					   (pawn->status == TTCHESS_PAWN_PAST    && focused_era == TTCHESS_ERA_PAST)
-					|| (pawn->status == TTCHESS_PAWN_PRESENT && focused_era == TTCHESS_ERA_PRESENT)
-					|| (pawn->status == TTCHESS_PAWN_FUTURE  && focused_era == TTCHESS_ERA_FUTURE)
-				) {
-					ttchess_add_pawn_moves(&move_list, state, pawn_index);
-				}
+			// Only pawns in the focused era can act first
+			ttchess_color_t color = state->phase.color;
+			const ttchess_board_t* focused_board = &state->boards[state->focuses[color]];
+			for (
+				ttchess_bitboard_t pawns = focused_board->pawns[color];
+				pawns != 0;
+				pawns = (ttchess_bitboard_t)(pawns & (pawns - 1))
+			) {
+				ttchess_pos_t pos = ttchess_bitboard_first_pos(pawns);
+				ttchess_add_pawn_moves(&move_list, state, focused_board->cells[pos.x][pos.y].piece_id);
 			}
-		}
+		} break;
 		case TTCHESS_ACTION_SECOND: {
 			ttchess_add_pawn_moves(&move_list, state, state->last_pawn);
-		}
+		} break;
 		case TTCHESS_ACTION_SHIFT_FOCUS: {
-			ttchess_era_t focused_era = state->focuses[state->phase.color];
+			// Validation also rejects focus shift after the last pawn died
 			for (ttchess_era_t era = 0; era < TTCHESS_NUM_ERAS; ++era) {
-				// Must shift focus to a different era
-				if (focused_era != era) {
-					ttchess_add_move(&move_list, (ttchess_move_t){
-						.type = TTCHESS_MOVE_SHIFT_FOCUS,
-						.era = era,
-					});
-				}
+				ttchess_add_move_if_legal(&move_list, state, (ttchess_move_t){
+					.type = TTCHESS_MOVE_SHIFT_FOCUS,
+					.era = era,
+				});
+			}
+		} break;
+		case TTCHESS_ACTION_WON:
+			break;
+	}
+
+	return move_list.len;
+}
+
+static inline void
+ttchess_gen_pawn_moves(
+	ttchess_move_list_t* move_list,
+	const ttchess_state_t* state,
+	int8_t pawn_id,
+	ttchess_era_t pawn_era,
+	bool has_reserve
+) {
+	// The caller has checked that the pawn can act in this phase so only the
+	// conditions specific to each move are left
+	const ttchess_board_t* board = &state->boards[pawn_era];
+	ttchess_pos_t pawn_pos = state->pawns[pawn_id].pos;
+	ttchess_bitboard_t pawn_bit = ttchess_pos_bit(pawn_pos);
+
+	// Time travel is only possible to an earlier empty cell with a spare pawn
+	if (has_reserve) {
+		for (ttchess_era_t era = 0; era < pawn_era; ++era) {
+			if (!(ttchess_board_occupied(&state->boards[era]) & pawn_bit)) {
+				ttchess_add_move(move_list, (ttchess_move_t){
+					.type = TTCHESS_MOVE_TIME_TRAVEL,
+					.pawn_id = pawn_id,
+					.era = era,
+				});
 			}
 		}
+	}
+
+	// Move pawn
+	ttchess_pos_t cardinal_positions[TTCHESS_NUM_CARDINAL_DIRECTIONS];
+	ttchess_gen_cardinal_positions(cardinal_positions, pawn_pos);
+	for (int i = 0; i < TTCHESS_NUM_CARDINAL_DIRECTIONS; ++i) {
+		ttchess_pos_t target = cardinal_positions[i];
+		if (
+			ttchess_pos_bit(target)
+			&& ttchess_piece_can_move(state, pawn_era, pawn_pos, target, 0)
+		) {
+			ttchess_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_PAWN,
+				.pawn_id = pawn_id,
+				.pos = target,
+			});
+		}
+	}
+
+	// Statue
+	if (!state->config.with_statues) { return; }
+
+	bool can_build = !state->statue_built[ttchess_pawn_color(pawn_id)];
+	ttchess_bitboard_t occupied = ttchess_board_occupied(board);
+	for (int i = 0; i < TTCHESS_NUM_CARDINAL_DIRECTIONS; ++i) {
+		ttchess_pos_t target = cardinal_positions[i];
+		ttchess_bitboard_t target_bit = ttchess_pos_bit(target);
+		if (!target_bit) { continue; }
+
+		if (can_build && !(occupied & target_bit)) {
+			ttchess_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_BUILD_STATUE,
+				.pawn_id = pawn_id,
+				.pos = target,
+			});
+		}
+
+		// Cardinal positions come in opposite pairs
+		ttchess_pos_t statue_pos = cardinal_positions[i ^ 1];
+		if (
+			(board->statues & ttchess_pos_bit(statue_pos))
+			&& ttchess_piece_can_move(state, pawn_era, pawn_pos, target, 1)
+		) {
+			ttchess_add_move(move_list, (ttchess_move_t){
+				.type = TTCHESS_MOVE_PULL_STATUE,
+				.pawn_id = pawn_id,
+				.subject_id = board->cells[statue_pos.x][statue_pos.y].piece_id,
+				.pos = target,
+			});
+		}
+	}
+}
+
+static inline bool
+ttchess_last_pawn_era(const ttchess_state_t* state, ttchess_era_t* era) {
+	// The pawn that acted first must still be on board for the rest of the turn
+	int8_t pawn_id = state->last_pawn;
+	if (!(0 <= pawn_id && pawn_id < TTCHESS_NUM_PAWNS)) { return false; }
+	if (ttchess_pawn_color(pawn_id) != state->phase.color) { return false; }
+
+	return ttchess_pawn_era(&state->pawns[pawn_id], era);
+}
+
+int
+ttchess_list_moves(
+	const ttchess_state_t* state,
+	ttchess_move_t* moves,
+	int moves_len
+) {
+	ttchess_move_list_t move_list = {
+		.storage = moves,
+		.max_len = moves_len,
+	};
+	ttchess_color_t color = state->phase.color;
+	switch (state->phase.action) {
+		case TTCHESS_ACTION_FIRST: {
+			// Only pawns in the focused era can act first
+			ttchess_era_t focused_era = state->focuses[color];
+			const ttchess_board_t* focused_board = &state->boards[focused_era];
+			bool has_reserve = ttchess_has_reserve_pawn(state, color);
+			for (
+				ttchess_bitboard_t pawns = focused_board->pawns[color];
+				pawns != 0;
+				pawns = (ttchess_bitboard_t)(pawns & (pawns - 1))
+			) {
+				ttchess_pos_t pos = ttchess_bitboard_first_pos(pawns);
+				ttchess_gen_pawn_moves(
+					&move_list, state,
+					focused_board->cells[pos.x][pos.y].piece_id, focused_era,
+					has_reserve
+				);
+			}
+		} break;
+		case TTCHESS_ACTION_SECOND: {
+			ttchess_era_t pawn_era;
+			if (ttchess_last_pawn_era(state, &pawn_era)) {
+				ttchess_gen_pawn_moves(
+					&move_list, state,
+					state->last_pawn, pawn_era,
+					ttchess_has_reserve_pawn(state, color)
+				);
+			}
+		} break;
+		case TTCHESS_ACTION_SHIFT_FOCUS: {
+			ttchess_era_t pawn_era;
+			if (ttchess_last_pawn_era(state, &pawn_era)) {
+				ttchess_era_t focused_era = state->focuses[color];
+				for (ttchess_era_t era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+					// Must shift focus to a different era
+					if (focused_era != era) {
+						ttchess_add_move(&move_list, (ttchess_move_t){
+							.type = TTCHESS_MOVE_SHIFT_FOCUS,
+							.era = era,
+						});
+					}
+				}
+			}
+		} break;
 		case TTCHESS_ACTION_WON:
 			break;
 	}
@@ -451,31 +846,44 @@ ttchess_list_moves(
 }
 
 static inline void
-ttchess_kill_pawn(ttchess_state_t* state, int8_t pawn_id) {
+ttchess_undo_save_pawn(ttchess_undo_t* undo, const ttchess_state_t* state, int8_t pawn_id) {
+	if (undo == NULL || (undo->touched_pawns & (1u << pawn_id))) { return; }
+
+	const ttchess_pawn_t* pawn = &state->pawns[pawn_id];
+	undo->touched_pawns |= (uint16_t)(1u << pawn_id);
+	undo->pawns[undo->num_pawns++] = (ttchess_pawn_undo_t){
+		.pawn_id = pawn_id,
+		.status = (int8_t)pawn->status,
+		.pos = pawn->pos,
+	};
+}
+
+static inline void
+ttchess_undo_save_statue(ttchess_undo_t* undo, const ttchess_state_t* state, int8_t statue_id) {
+	if (undo == NULL || (undo->touched_statues & (1u << statue_id))) { return; }
+
+	undo->touched_statues |= (uint8_t)(1u << statue_id);
+	undo->statues[statue_id] = state->statues[statue_id];
+}
+
+static inline void
+ttchess_kill_pawn(ttchess_state_t* state, ttchess_undo_t* undo, int8_t pawn_id) {
+	ttchess_undo_save_pawn(undo, state, pawn_id);
+
 	ttchess_pawn_t* pawn = &state->pawns[pawn_id];
-	ttchess_color_t pawn_color = ttchess_pawn_color(pawn_id);
-	ttchess_era_t pawn_era = TTCHESS_ERA_PAST;
-	switch (pawn->status) {
-		case TTCHESS_PAWN_PAST:
-			pawn_era = TTCHESS_ERA_PAST;
-			break;
-		case TTCHESS_PAWN_PRESENT:
-			pawn_era = TTCHESS_ERA_PRESENT;
-			break;
-		case TTCHESS_PAWN_FUTURE:
-			pawn_era = TTCHESS_ERA_FUTURE;
-			break;
-		default:
-			break;
+	ttchess_era_t pawn_era;
+	if (ttchess_pawn_era(pawn, &pawn_era)) {
+		ttchess_clear_cell(state, pawn_era, pawn->pos);
+		state->boards[pawn_era].num_pawns[ttchess_pawn_color(pawn_id)] -= 1;
 	}
-	state->boards[pawn_era].cells[pawn->pos.x][pawn->pos.y].piece_id = TTCHESS_PIECE_NONE;
-	state->boards[pawn_era].num_pawns[pawn_color] -= 1;
 	pawn->status = TTCHESS_PAWN_DEAD;
+	state->hash ^= ttchess_zobrist_key(TTCHESS_ZOBRIST_DEAD_PAWN + pawn_id);
 }
 
 static inline void
 ttchess_push_piece(
 	ttchess_state_t* state,
+	ttchess_undo_t* undo,
 	ttchess_era_t era,
 	ttchess_pos_t from,
 	ttchess_pos_t to
@@ -483,6 +891,7 @@ ttchess_push_piece(
 	ttchess_board_t* board = &state->boards[era];
 	ttchess_cell_t* cell = &board->cells[from.x][from.y];
 	int8_t piece_id = cell->piece_id;
+	TTCHESS_STATS_PUSH_ENTER(cell->piece_type != TTCHESS_PIECE_NONE);
 	int delta_x = to.x - from.x;
 	int delta_y = to.y - from.y;
 	ttchess_pos_t push_target = {
@@ -493,6 +902,7 @@ ttchess_push_piece(
 		case TTCHESS_PIECE_NONE:
 			break;
 		case TTCHESS_PIECE_PAWN: {
+			ttchess_undo_save_pawn(undo, state, piece_id);
 			ttchess_pawn_t* pawn = &state->pawns[piece_id];
 			if (ttchess_pos_is_on_board(to)) {
 				ttchess_cell_t* target_cell = &board->cells[to.x][to.y];
@@ -505,21 +915,21 @@ ttchess_push_piece(
 						ttchess_color_t own_color = ttchess_pawn_color(piece_id);
 						ttchess_color_t target_pawn_color = ttchess_pawn_color(target_cell->piece_id);
 						if (own_color == target_pawn_color) {  // Paradox
-							ttchess_kill_pawn(state, piece_id);
-							ttchess_kill_pawn(state, target_cell->piece_id);
+							ttchess_kill_pawn(state, undo, piece_id);
+							ttchess_kill_pawn(state, undo, target_cell->piece_id);
 							can_move = false;
 						} else {  // Push opponent
-							ttchess_push_piece(state, era, to, push_target);
+							ttchess_push_piece(state, undo, era, to, push_target);
 							can_move = true;
 						}
 					} break;
 					default: {
 						// Try to push target away
 						if (ttchess_piece_can_move(state, era, to, push_target, 1)) {
-							ttchess_push_piece(state, era, to, push_target);
+							ttchess_push_piece(state, undo, era, to, push_target);
 							can_move = true;
 						} else {
-							ttchess_kill_pawn(state, piece_id);
+							ttchess_kill_pawn(state, undo, piece_id);
 							can_move = false;
 						}
 					} break;
@@ -528,23 +938,23 @@ ttchess_push_piece(
 				// Actually move pawn
 				if (can_move) {
 					pawn->pos = to;
-					cell->piece_type = TTCHESS_PIECE_NONE;
-					target_cell->piece_type = TTCHESS_PIECE_PAWN;
-					target_cell->piece_id = piece_id;
+					ttchess_clear_cell(state, era, from);
+					ttchess_place_pawn(state, era, to, piece_id);
 				}
 			} else {  // Pushed off board
+				ttchess_kill_pawn(state, undo, piece_id);
 				// This is just so that the render can draw effects where the
 				// pawn falls off the board
 				pawn->pos.x += delta_x;
 				pawn->pos.y += delta_y;
-				ttchess_kill_pawn(state, piece_id);
 			}
 		} break;
 		case TTCHESS_PIECE_STATUE: {
+			ttchess_undo_save_statue(undo, state, piece_id);
 			ttchess_statue_state_t* statue = &state->statues[piece_id];
 			// Propagate move through time
-			for (int statue_era = era; era < TTCHESS_NUM_ERAS; ++era) {
-				ttchess_pos_t statue_pos = statue->positions[era];
+			for (int statue_era = era; statue_era < TTCHESS_NUM_ERAS; ++statue_era) {
+				ttchess_pos_t statue_pos = statue->positions[statue_era];
 				if (!ttchess_pos_is_on_board(statue_pos)) { break; }
 
 				// Try to move statue relatively
@@ -557,25 +967,104 @@ ttchess_push_piece(
 					.y = statue_to.y + delta_y,
 				};
 				// Clear target
+				ttchess_board_t* statue_board = &state->boards[statue_era];
 				if (ttchess_piece_can_move(state, statue_era, statue_to, statue_push_target, 1)) {
-					ttchess_push_piece(state, era, statue_to, statue_push_target);
+					ttchess_push_piece(state, undo, statue_era, statue_to, statue_push_target);
+				} else if (ttchess_board_pawns(statue_board) & ttchess_pos_bit(statue_to)) {
+					// Squish a pawn that cannot be pushed away
+					ttchess_kill_pawn(state, undo, statue_board->cells[statue_to.x][statue_to.y].piece_id);
 				} else {
 					break;
 				}
 
 				// Move statue
-				statue->positions[era] = statue_to;
-				state->boards[era].cells[statue_pos.x][statue_pos.y].piece_type = TTCHESS_PIECE_NONE;
-				state->boards[era].cells[statue_to.x][statue_to.y].piece_type = TTCHESS_PIECE_STATUE;
-				state->boards[era].cells[statue_to.x][statue_to.y].piece_id = piece_id;
+				statue->positions[statue_era] = statue_to;
+				ttchess_clear_cell(state, statue_era, statue_pos);
+				ttchess_place_statue(state, statue_era, statue_to, piece_id);
 			}
 		} break;
 	}
+
+	TTCHESS_STATS_PUSH_EXIT();
 }
 
-bool
-ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
-	if (!ttchess_validate_move(state, move)) { return false; }
+static inline ttchess_move_cache_entry_t*
+ttchess_move_cache_slot(ttchess_move_cache_t* cache, uint64_t hash) {
+	return &cache->entries[hash & (TTCHESS_MOVE_CACHE_SIZE - 1)];
+}
+
+// `hash` is passed separately since it is not up to date in the middle of a
+// move
+static inline ttchess_move_cache_entry_t*
+ttchess_move_cache_find(ttchess_move_cache_t* cache, const ttchess_state_t* state, uint64_t hash) {
+	ttchess_move_cache_entry_t* entry = ttchess_move_cache_slot(cache, hash);
+	bool hit = entry->valid
+		&& entry->hash == hash
+		&& entry->with_statues == state->config.with_statues
+		&& entry->phase.action == state->phase.action
+		&& entry->phase.color == state->phase.color;
+	return hit ? entry : NULL;
+}
+
+static inline ttchess_move_cache_entry_t*
+ttchess_move_cache_fill(ttchess_move_cache_t* cache, const ttchess_state_t* state, uint64_t hash) {
+	ttchess_move_cache_entry_t* entry = ttchess_move_cache_find(cache, state, hash);
+	if (entry != NULL) { return entry; }
+
+	entry = ttchess_move_cache_slot(cache, hash);
+	entry->valid = true;
+	entry->with_statues = state->config.with_statues;
+	entry->phase = state->phase;
+	entry->hash = hash;
+	entry->num_moves = ttchess_list_moves(state, entry->moves, TTCHESS_MAX_MOVES);
+	return entry;
+}
+
+static bool
+ttchess_apply_move_impl(
+	ttchess_state_t* state,
+	ttchess_undo_t* undo,
+	ttchess_move_cache_t* cache,
+	ttchess_move_t move
+) {
+	ttchess_move_cache_entry_t* cached = cache != NULL
+		? ttchess_move_cache_find(cache, state, state->hash)
+		: NULL;
+	if (cached != NULL) {
+		// Like ttchess_validate_move, ignore the pawn after the first action
+		ttchess_move_t listed_move = move;
+		if (state->phase.action != TTCHESS_ACTION_FIRST) {
+			listed_move.pawn_id = state->last_pawn;
+		}
+
+		bool is_legal = false;
+		for (int i = 0; i < cached->num_moves && !is_legal; ++i) {
+			is_legal = ttchess_move_equal(cached->moves[i], listed_move);
+		}
+		if (!is_legal) { return false; }
+	} else if (!ttchess_validate_move(state, move)) {
+		return false;
+	}
+
+	if (undo != NULL) {
+		undo->hash = state->hash;
+		undo->action = (int8_t)state->phase.action;
+		undo->color = (int8_t)state->phase.color;
+		undo->last_pawn = state->last_pawn;
+		undo->num_pawns = 0;
+		undo->touched_pawns = 0;
+		undo->touched_statues = 0;
+		undo->built_statues = 0;
+		for (int i = 0; i < TTCHESS_NUM_PLAYERS; ++i) {
+			undo->focuses[i] = (int8_t)state->focuses[i];
+		}
+		for (int i = 0; i < TTCHESS_NUM_STATUES; ++i) {
+			undo->built_statues |= (uint8_t)(state->statue_built[i] << i);
+		}
+	}
+
+	// The turn is hashed back in once the phase has advanced
+	state->hash ^= ttchess_turn_key(state);
 
 	int8_t pawn_id = state->last_pawn;
 	if (state->phase.action == TTCHESS_ACTION_FIRST) {
@@ -603,10 +1092,11 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 	switch (move.type) {
 		// Core
 		case TTCHESS_MOVE_PAWN:
-			ttchess_push_piece(state, pawn_era, pawn->pos, move.pos);
+			ttchess_push_piece(state, undo, pawn_era, pawn->pos, move.pos);
 			break;
 		case TTCHESS_MOVE_TIME_TRAVEL: {
 			// Change board
+			ttchess_undo_save_pawn(undo, state, pawn_id);
 			ttchess_pawn_status_t pawn_status = pawn->status;
 			switch (move.era) {
 				case TTCHESS_ERA_PAST:
@@ -624,10 +1114,9 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 			ttchess_board_t* current_board = &state->boards[pawn_era];
 			ttchess_board_t* next_board = &state->boards[move.era];
 			current_board->num_pawns[player_color] -= 1;
-			current_board->cells[pawn_pos.x][pawn_pos.y].piece_type = TTCHESS_PIECE_NONE;
+			ttchess_clear_cell(state, pawn_era, pawn_pos);
 			next_board->num_pawns[player_color] += 1;
-			next_board->cells[pawn_pos.x][pawn_pos.y].piece_type = TTCHESS_PIECE_PAWN;
-			next_board->cells[pawn_pos.x][pawn_pos.y].piece_id = pawn_id;
+			ttchess_place_pawn(state, move.era, pawn_pos, pawn_id);
 
 			// Leave clone behind
 			if (move.era < pawn_era) {
@@ -642,11 +1131,11 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 				) {
 					ttchess_pawn_t* new_pawn = &state->pawns[new_pawn_index];
 					if (new_pawn->status == TTCHESS_PAWN_RESERVE) {
+						ttchess_undo_save_pawn(undo, state, new_pawn_index);
 						new_pawn->pos = pawn_pos;
 						new_pawn->status = pawn_status;
 						current_board->num_pawns[player_color] += 1;
-						current_board->cells[pawn_pos.x][pawn_pos.y].piece_type = TTCHESS_PIECE_PAWN;
-						current_board->cells[pawn_pos.x][pawn_pos.y].piece_id = new_pawn_index;
+						ttchess_place_pawn(state, pawn_era, pawn_pos, new_pawn_index);
 						break;
 					}
 				}
@@ -658,25 +1147,21 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 		// Statue
 		case TTCHESS_MOVE_BUILD_STATUE: {
 			// Build the current era
+			ttchess_undo_save_statue(undo, state, player_color);
 			state->statues[player_color].positions[pawn_era] = move.pos;
-			ttchess_board_t* current_board = &state->boards[pawn_era];
-			current_board->cells[move.pos.x][move.pos.y].piece_type = TTCHESS_PIECE_STATUE;
-			current_board->cells[move.pos.x][move.pos.y].piece_id = player_color;
+			ttchess_place_statue(state, pawn_era, move.pos, player_color);
 
 			// Propagate to later eras
 			for (int era = pawn_era + 1; era < TTCHESS_NUM_ERAS; ++era) {
-				ttchess_board_t* board = &state->boards[era];
-				ttchess_cell_t* cell = &board->cells[move.pos.x][move.pos.y];
 				ttchess_pos_t push_target = {
 					.x = move.pos.x + (move.pos.x - pawn->pos.x),
 					.y = move.pos.y + (move.pos.y - pawn->pos.y),
 				};
 				// Push whatever in the way away if possible for the build
 				if (ttchess_piece_can_move(state, era, move.pos, push_target, 1)) {
-					ttchess_push_piece(state, era, move.pos, push_target);
+					ttchess_push_piece(state, undo, era, move.pos, push_target);
 
-					cell->piece_type = TTCHESS_PIECE_STATUE;
-					cell->piece_id = player_color;
+					ttchess_place_statue(state, era, move.pos, player_color);
 					state->statues[player_color].positions[era] = move.pos;
 				} else {  // If not, halt propagation
 					break;
@@ -685,12 +1170,13 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 			state->statue_built[player_color] = true;
 		} break;
 		case TTCHESS_MOVE_PULL_STATUE: {
-			ttchess_push_piece(state, pawn_era, pawn->pos, move.pos);
+			ttchess_push_piece(state, undo, pawn_era, pawn_pos, move.pos);
+			// Use the position before the move since the pawn has moved away
 			ttchess_pos_t statue_pos = {
-				.x = pawn->pos.x - (move.pos.x - pawn->pos.x),
-				.y = pawn->pos.y - (move.pos.y - pawn->pos.y),
+				.x = pawn_pos.x - (move.pos.x - pawn_pos.x),
+				.y = pawn_pos.y - (move.pos.y - pawn_pos.y),
 			};
-			ttchess_push_piece(state, pawn_era, statue_pos, pawn->pos);
+			ttchess_push_piece(state, undo, pawn_era, statue_pos, pawn_pos);
 		} break;
 		// Plant
 		// TTCHESS_MOVE_PLANT_SEED,
@@ -721,6 +1207,7 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 			}
 			if (num_dominant_eras >= 2) {
 				state->phase.action = TTCHESS_ACTION_WON;
+				state->hash ^= ttchess_turn_key(state);
 				return true;
 			}
 
@@ -733,7 +1220,12 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 	}
 
 	// When there is no legal moves for the next player, skip their turn
-	if (ttchess_list_moves(state, NULL, 0) == 0) {
+	int num_next_moves = cache != NULL
+		? ttchess_move_cache_fill(cache, state, state->hash ^ ttchess_turn_key(state))->num_moves
+		: ttchess_list_moves(state, NULL, 0);
+	TTCHESS_STATS_COUNT(turn_skip_checks);
+	if (num_next_moves == 0) {
+		TTCHESS_STATS_COUNT(turn_skips);
 		state->phase.action = TTCHESS_ACTION_FIRST;
 		// Flip color from latest state because the active player can do
 		// something really dumb and cost them their second action.
@@ -742,9 +1234,99 @@ ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
 			: TTCHESS_COLOR_WHITE;
 	}
 
+	state->hash ^= ttchess_turn_key(state);
 	return true;
 }
 
+bool
+ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move) {
+	bool applied = ttchess_apply_move_impl(state, NULL, NULL, move);
+	TTCHESS_ASSERT_DERIVED(state);
+	return applied;
+}
+
+bool
+ttchess_apply_move_cached(ttchess_state_t* state, ttchess_move_t move, ttchess_move_cache_t* cache) {
+	bool applied = ttchess_apply_move_impl(state, NULL, cache, move);
+	TTCHESS_ASSERT_DERIVED(state);
+	return applied;
+}
+
+bool
+ttchess_make_move(ttchess_state_t* state, ttchess_move_t move, ttchess_undo_t* undo) {
+	bool applied = ttchess_apply_move_impl(state, undo, NULL, move);
+	TTCHESS_ASSERT_DERIVED(state);
+	return applied;
+}
+
+int
+ttchess_move_cache_get(ttchess_move_cache_t* cache, const ttchess_state_t* state, const ttchess_move_t** moves) {
+	ttchess_move_cache_entry_t* entry = ttchess_move_cache_fill(cache, state, state->hash);
+	*moves = entry->moves;
+	return entry->num_moves;
+}
+
+void
+ttchess_unmake_move(ttchess_state_t* state, const ttchess_undo_t* undo) {
+	// Lift every touched piece off the boards first since they may now be
+	// sitting on each other's old cells
+	for (int i = 0; i < undo->num_pawns; ++i) {
+		int8_t pawn_id = undo->pawns[i].pawn_id;
+		ttchess_era_t pawn_era;
+		if (ttchess_pawn_era(&state->pawns[pawn_id], &pawn_era)) {
+			ttchess_clear_cell(state, pawn_era, state->pawns[pawn_id].pos);
+			state->boards[pawn_era].num_pawns[ttchess_pawn_color(pawn_id)] -= 1;
+		}
+	}
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		if (!(undo->touched_statues & (1u << statue_index))) { continue; }
+
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			ttchess_pos_t pos = state->statues[statue_index].positions[era];
+			if (ttchess_pos_is_on_board(pos)) {
+				ttchess_clear_cell(state, era, pos);
+			}
+		}
+	}
+
+	// Then put them back where they were
+	for (int i = 0; i < undo->num_pawns; ++i) {
+		ttchess_pawn_undo_t pawn_undo = undo->pawns[i];
+		ttchess_pawn_t* pawn = &state->pawns[pawn_undo.pawn_id];
+		pawn->status = (ttchess_pawn_status_t)pawn_undo.status;
+		pawn->pos = pawn_undo.pos;
+
+		ttchess_era_t pawn_era;
+		if (ttchess_pawn_era(pawn, &pawn_era)) {
+			ttchess_place_pawn(state, pawn_era, pawn->pos, pawn_undo.pawn_id);
+			state->boards[pawn_era].num_pawns[ttchess_pawn_color(pawn_undo.pawn_id)] += 1;
+		}
+	}
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		if (!(undo->touched_statues & (1u << statue_index))) { continue; }
+
+		state->statues[statue_index] = undo->statues[statue_index];
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			ttchess_pos_t pos = state->statues[statue_index].positions[era];
+			if (ttchess_pos_is_on_board(pos)) {
+				ttchess_place_statue(state, era, pos, statue_index);
+			}
+		}
+	}
+
+	for (int i = 0; i < TTCHESS_NUM_STATUES; ++i) {
+		state->statue_built[i] = (undo->built_statues >> i) & 1;
+	}
+	for (int i = 0; i < TTCHESS_NUM_PLAYERS; ++i) {
+		state->focuses[i] = (ttchess_era_t)undo->focuses[i];
+	}
+	state->phase.action = (ttchess_player_action_t)undo->action;
+	state->phase.color = (ttchess_color_t)undo->color;
+	state->last_pawn = undo->last_pawn;
+	state->hash = undo->hash;
+	TTCHESS_ASSERT_DERIVED(state);
+}
+
 static inline bserial_status_t
 ttchess_fixed_array(bserial_ctx_t* ctx, int len) {
 	uint64_t u64_len = (uint64_t)len;
@@ -779,6 +1361,13 @@ ttchess_serialize_pos(bserial_ctx_t* ctx, ttchess_pos_t* pos) {
 
 bserial_status_t
 ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state) {
+	// When reading back into the state that was written, such as across a
+	// reload, the boards are already correct
+	ttchess_state_t previous;
+	bool is_reading = bserial_mode(ctx) == BSERIAL_MODE_READ;
+	if (is_reading) { previous = *state; }
+	bool has_hash = false;
+
 	BSERIAL_RECORD(ctx, state) {
 		BSERIAL_KEY(ctx, config) {
 			// `state->config` has the same address as `state` and that confuses
@@ -797,12 +1386,14 @@ ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state) {
 				BSERIAL_KEY(ctx, action) {
 					uint8_t action = (uint8_t)state->phase.action;
 					BSERIAL_CHECK_STATUS(bserial_any_int(ctx, &action));
+					if (action > TTCHESS_ACTION_WON) { return BSERIAL_MALFORMED; }
 					state->phase.action = (ttchess_player_action_t)action;
 				}
 
 				BSERIAL_KEY(ctx, color) {
 					uint8_t color = (uint8_t)state->phase.color;
 					BSERIAL_CHECK_STATUS(bserial_any_int(ctx, &color));
+					if (color > TTCHESS_COLOR_BLACK) { return BSERIAL_MALFORMED; }
 					state->phase.color = (ttchess_color_t)color;
 				}
 			}
@@ -824,6 +1415,7 @@ ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state) {
 					BSERIAL_KEY(ctx, status) {
 						uint8_t status = (uint8_t)pawn->status;
 						BSERIAL_CHECK_STATUS(bserial_any_int(ctx, &status));
+						if (status > TTCHESS_PAWN_DEAD) { return BSERIAL_MALFORMED; }
 						pawn->status = (ttchess_pawn_status_t)status;
 					}
 
@@ -839,6 +1431,7 @@ ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state) {
 			for (int i = 0; i < TTCHESS_NUM_PLAYERS; ++i) {
 				uint8_t era = (uint8_t)state->focuses[i];
 				BSERIAL_CHECK_STATUS(bserial_any_int(ctx, &era));
+				if (era > TTCHESS_ERA_FUTURE) { return BSERIAL_MALFORMED; }
 				state->focuses[i] = (ttchess_era_t)era;
 			}
 		}
@@ -858,11 +1451,144 @@ ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state) {
 				}
 			}
 		}
+
+		BSERIAL_KEY(ctx, hash) {
+			BSERIAL_CHECK_STATUS(bserial_any_int(ctx, &state->hash));
+			has_hash = true;
+		}
 	}
 
-	if (bserial_mode(ctx) == BSERIAL_MODE_READ) {
-		ttchess_state_reindex(state);
+	if (is_reading) {
+		// Status and position are separate keys so a pawn can only be checked
+		// once both are in. Placing an off board pawn would write outside of
+		// the cells.
+		for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+			const ttchess_pawn_t* pawn = &state->pawns[pawn_index];
+			ttchess_era_t era;
+			if (ttchess_pawn_era(pawn, &era) && !ttchess_pos_is_on_board(pawn->pos)) {
+				return BSERIAL_MALFORMED;
+			}
+		}
+
+		// The derived fields are never serialized so they still describe
+		// `previous`
+		bool is_unchanged = has_hash
+			&& state->hash == previous.hash
+			&& ttchess_base_equal(state, &previous);
+		if (!is_unchanged) {
+			ttchess_state_reindex(state);
+		}
+		TTCHESS_ASSERT_DERIVED(state);
 	}
 
 	return BSERIAL_OK;
 }
+
+static inline uint8_t
+ttchess_pack_pos(ttchess_pos_t pos) {
+	return ttchess_pos_is_on_board(pos)
+		? (uint8_t)(pos.y * TTCHESS_BOARD_WIDTH + pos.x)
+		: TTCHESS_PACKED_OFF_BOARD;
+}
+
+static inline ttchess_pos_t
+ttchess_unpack_pos(uint8_t packed) {
+	if (packed & TTCHESS_PACKED_OFF_BOARD) {
+		return (ttchess_pos_t){ .x = -1, .y = -1 };
+	} else {
+		return (ttchess_pos_t){
+			.x = (packed & TTCHESS_PACKED_POS_MASK) % TTCHESS_BOARD_WIDTH,
+			.y = (packed & TTCHESS_PACKED_POS_MASK) / TTCHESS_BOARD_WIDTH,
+		};
+	}
+}
+
+void
+ttchess_state_pack(const ttchess_state_t* state, uint8_t packed[TTCHESS_PACKED_SIZE]) {
+	uint8_t* out = packed;
+	*out++ = TTCHESS_PACKED_VERSION;
+	*out++ = (uint8_t)(
+		  (state->config.with_statues ? 0x01 : 0)
+		| ((unsigned)state->phase.action << 1)
+		| ((unsigned)state->phase.color << 3)
+		| ((unsigned)state->focuses[TTCHESS_COLOR_WHITE] << 4)
+		| ((unsigned)state->focuses[TTCHESS_COLOR_BLACK] << 6)
+	);
+	*out++ = (uint8_t)state->last_pawn;
+
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		const ttchess_pawn_t* pawn = &state->pawns[pawn_index];
+		*out++ = (uint8_t)(ttchess_pack_pos(pawn->pos) | ((unsigned)pawn->status << 4));
+	}
+
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			*out++ = ttchess_pack_pos(state->statues[statue_index].positions[era]);
+		}
+	}
+}
+
+bool
+ttchess_state_unpack(ttchess_state_t* state, const uint8_t packed[TTCHESS_PACKED_SIZE]) {
+	const uint8_t* in = packed;
+	if (*in++ != TTCHESS_PACKED_VERSION) { return false; }
+
+	uint8_t flags = *in++;
+	ttchess_state_t unpacked = {
+		.config = { .with_statues = (flags & 0x01) != 0 },
+		.phase = {
+			.action = (ttchess_player_action_t)((flags >> 1) & 0x03),
+			.color = (ttchess_color_t)((flags >> 3) & 0x01),
+		},
+		.focuses = {
+			[TTCHESS_COLOR_WHITE] = (ttchess_era_t)((flags >> 4) & 0x03),
+			[TTCHESS_COLOR_BLACK] = (ttchess_era_t)((flags >> 6) & 0x03),
+		},
+		.last_pawn = (int8_t)*in++,
+	};
+	if (!(0 <= unpacked.last_pawn && unpacked.last_pawn < TTCHESS_NUM_PAWNS)) {
+		return false;
+	}
+	for (int color = 0; color < TTCHESS_NUM_PLAYERS; ++color) {
+		if (unpacked.focuses[color] > TTCHESS_ERA_FUTURE) { return false; }
+	}
+
+	// Two pieces on the same cell would desync the boards on reindex
+	ttchess_bitboard_t occupied[TTCHESS_NUM_ERAS] = { 0 };
+	for (int pawn_index = 0; pawn_index < TTCHESS_NUM_PAWNS; ++pawn_index) {
+		ttchess_pawn_t* pawn = &unpacked.pawns[pawn_index];
+		uint8_t packed_pawn = *in++;
+		uint8_t status = (packed_pawn >> 4) & 0x07;
+		if (status > TTCHESS_PAWN_DEAD) { return false; }
+
+		pawn->status = (ttchess_pawn_status_t)status;
+		pawn->pos = ttchess_unpack_pos(packed_pawn);
+
+		ttchess_era_t era;
+		if (ttchess_pawn_era(pawn, &era)) {
+			ttchess_bitboard_t bit = ttchess_pos_bit(pawn->pos);
+			if (bit == 0 || (occupied[era] & bit)) { return false; }
+			occupied[era] |= bit;
+		}
+	}
+
+	for (int statue_index = 0; statue_index < TTCHESS_NUM_STATUES; ++statue_index) {
+		for (int era = 0; era < TTCHESS_NUM_ERAS; ++era) {
+			uint8_t packed_pos = *in++;
+			if (packed_pos & ~(TTCHESS_PACKED_OFF_BOARD | TTCHESS_PACKED_POS_MASK)) { return false; }
+
+			ttchess_pos_t pos = ttchess_unpack_pos(packed_pos);
+			unpacked.statues[statue_index].positions[era] = pos;
+
+			ttchess_bitboard_t bit = ttchess_pos_bit(pos);
+			if (unpacked.config.with_statues && bit != 0) {
+				if (occupied[era] & bit) { return false; }
+				occupied[era] |= bit;
+			}
+		}
+	}
+
+	ttchess_state_reindex(&unpacked);
+	*state = unpacked;
+	return true;
+}
@@ -13,6 +13,12 @@
 #define TTCHESS_BOARD_HEIGHT 4
 #define TTCHESS_FIRST_WHITE_PAWN 0
 #define TTCHESS_FIRST_BLACK_PAWN 7
+// Upper bound for ttchess_list_moves: 7 pawns in one era with 14 moves each
+#define TTCHESS_MAX_MOVES 128
+// Must be a power of 2
+#define TTCHESS_MOVE_CACHE_SIZE 4
+#define TTCHESS_PACKED_VERSION 1
+#define TTCHESS_PACKED_SIZE (3 + TTCHESS_NUM_PAWNS + TTCHESS_NUM_STATUES * TTCHESS_NUM_ERAS)
 
 typedef struct ttchess_config_s {
 	bool with_statues;
@@ -73,8 +79,14 @@ typedef struct ttchess_cell_s {
 	int8_t piece_id;
 } ttchess_cell_t;
 
+// One bit per cell, indexed by `y * TTCHESS_BOARD_WIDTH + x`
+typedef uint16_t ttchess_bitboard_t;
+
 typedef struct {
 	int8_t num_pawns[TTCHESS_NUM_PLAYERS];
+	// Mirrors `cells` so that occupancy queries are a single AND
+	ttchess_bitboard_t pawns[TTCHESS_NUM_PLAYERS];
+	ttchess_bitboard_t statues;
 	ttchess_cell_t cells[TTCHESS_BOARD_WIDTH][TTCHESS_BOARD_HEIGHT];
 } ttchess_board_t;
 
@@ -126,8 +138,47 @@ typedef struct ttchess_state_s {
 	// Derived states
 	ttchess_board_t boards[TTCHESS_NUM_ERAS];
 	bool statue_built[TTCHESS_NUM_STATUES];
+	// Zobrist key of the position, updated along with the boards
+	uint64_t hash;
 } ttchess_state_t;
 
+typedef struct {
+	bool valid;
+	bool with_statues;
+	ttchess_phase_t phase;
+	uint64_t hash;
+	int num_moves;
+	ttchess_move_t moves[TTCHESS_MAX_MOVES];
+} ttchess_move_cache_entry_t;
+
+// Legal moves of recently seen positions, keyed by hash and phase.
+// A zero initialized cache is empty.
+typedef struct {
+	ttchess_move_cache_entry_t entries[TTCHESS_MOVE_CACHE_SIZE];
+} ttchess_move_cache_t;
+
+typedef struct {
+	int8_t pawn_id;
+	int8_t status;
+	ttchess_pos_t pos;
+} ttchess_pawn_undo_t;
+
+// Enough to revert one ttchess_make_move.
+// Only the pawns and statues touched by the move are saved.
+typedef struct {
+	uint64_t hash;
+	int8_t action;
+	int8_t color;
+	int8_t last_pawn;
+	int8_t focuses[TTCHESS_NUM_PLAYERS];
+	uint8_t built_statues;
+	uint8_t touched_statues;
+	uint16_t touched_pawns;
+	int8_t num_pawns;
+	ttchess_pawn_undo_t pawns[TTCHESS_NUM_PAWNS];
+	ttchess_statue_state_t statues[TTCHESS_NUM_STATUES];
+} ttchess_undo_t;
+
 void
 ttchess_init(ttchess_state_t* state, ttchess_config_t config);
 
@@ -138,15 +189,164 @@ ttchess_list_moves(
 	int moves_len
 );
 
+// Same result as ttchess_list_moves but built by running every candidate move
+// through the full validation.
+// This is slow and only meant as a reference to check the generator against.
+int
+ttchess_list_moves_reference(
+	const ttchess_state_t* state,
+	ttchess_move_t* moves,
+	int moves_len
+);
+
 bool
 ttchess_apply_move(ttchess_state_t* state, ttchess_move_t move);
 
+// Same as ttchess_apply_move but also records how to revert the move into
+// `undo` when it succeeds. Moves must be unmade in the reverse order they were
+// made.
+bool
+ttchess_make_move(ttchess_state_t* state, ttchess_move_t move, ttchess_undo_t* undo);
+
+void
+ttchess_unmake_move(ttchess_state_t* state, const ttchess_undo_t* undo);
+
+// Same as ttchess_list_moves but only generates on a cache miss.
+// `*moves` stays valid until the next call with the same cache.
+int
+ttchess_move_cache_get(ttchess_move_cache_t* cache, const ttchess_state_t* state, const ttchess_move_t** moves);
+
+// Same as ttchess_apply_move but validates against the cached moves of `state`
+// when there are some and leaves the moves of the next position in the cache
+// from the turn skip check.
+bool
+ttchess_apply_move_cached(ttchess_state_t* state, ttchess_move_t move, ttchess_move_cache_t* cache);
+
+// Computes the Zobrist key from scratch.
+// It always matches `state->hash` which is kept up to date incrementally.
+uint64_t
+ttchess_compute_hash(const ttchess_state_t* state);
+
+// Rebuilds the boards, statue_built and hash from scratch into a copy and
+// compares them against the incrementally maintained ones.
+// Builds with TTCHESS_CHECK_DERIVED run this after every state change.
+bool
+ttchess_check_derived(const ttchess_state_t* state);
+
+// Reading only rebuilds the boards when the data differs from what is
+// already in `state`
 bserial_status_t
 ttchess_serialize(bserial_ctx_t* ctx, ttchess_state_t* state);
 
+// Fixed layout alternative to ttchess_serialize for storing many positions:
+//
+// - u8: TTCHESS_PACKED_VERSION
+// - u8: with_statues (1) | action (2) | color (1) | white focus (2) | black focus (2)
+// - u8: last_pawn
+// - u8 per pawn: off board (1) | status (3) | y * 4 + x (4)
+// - u8 per statue and era: off board (1) | unused (3) | y * 4 + x (4)
+//
+// Off board positions all decode to (-1, -1).
+void
+ttchess_state_pack(const ttchess_state_t* state, uint8_t packed[TTCHESS_PACKED_SIZE]);
+
+// Returns false when the version does not match or a field is out of range
+bool
+ttchess_state_unpack(ttchess_state_t* state, const uint8_t packed[TTCHESS_PACKED_SIZE]);
+
 static inline ttchess_color_t
 ttchess_pawn_color(int8_t pawn_id) {
 	return pawn_id < TTCHESS_FIRST_BLACK_PAWN ? TTCHESS_COLOR_WHITE : TTCHESS_COLOR_BLACK;
 }
 
+static inline bool
+ttchess_move_equal(ttchess_move_t lhs, ttchess_move_t rhs) {
+	if (lhs.type != rhs.type) { return false; }
+
+	switch (lhs.type) {
+		case TTCHESS_MOVE_SHIFT_FOCUS:
+			return lhs.era == rhs.era;
+		case TTCHESS_MOVE_TIME_TRAVEL:
+			return lhs.pawn_id == rhs.pawn_id && lhs.era == rhs.era;
+		case TTCHESS_MOVE_PULL_STATUE:
+			return lhs.pawn_id == rhs.pawn_id
+				&& lhs.subject_id == rhs.subject_id
+				&& lhs.pos.x == rhs.pos.x
+				&& lhs.pos.y == rhs.pos.y;
+		default:
+			return lhs.pawn_id == rhs.pawn_id
+				&& lhs.pos.x == rhs.pos.x
+				&& lhs.pos.y == rhs.pos.y;
+	}
+}
+
+// Packs a move into 16 bits:
+// type (3) | pawn_id (4) | subject_id (2) | x or era (2) | y (2)
+static inline uint16_t
+ttchess_move_pack(ttchess_move_t move) {
+	int x, y = 0;
+	switch (move.type) {
+		case TTCHESS_MOVE_SHIFT_FOCUS:
+		case TTCHESS_MOVE_TIME_TRAVEL:
+			x = move.era;
+			break;
+		default:
+			x = move.pos.x;
+			y = move.pos.y;
+			break;
+	}
+
+	return (uint16_t)(
+		  ((unsigned)move.type << 10)
+		| ((unsigned)(move.pawn_id & 0x0f) << 6)
+		| ((unsigned)(move.subject_id & 0x03) << 4)
+		| ((unsigned)(x & 0x03) << 2)
+		| ((unsigned)(y & 0x03))
+	);
+}
+
+static inline ttchess_move_t
+ttchess_move_unpack(uint16_t packed) {
+	ttchess_move_t move = {
+		.type = (ttchess_move_type_t)((packed >> 10) & 0x07),
+		.pawn_id = (int8_t)((packed >> 6) & 0x0f),
+		.subject_id = (int8_t)((packed >> 4) & 0x03),
+	};
+	switch (move.type) {
+		case TTCHESS_MOVE_SHIFT_FOCUS:
+		case TTCHESS_MOVE_TIME_TRAVEL:
+			move.era = (ttchess_era_t)((packed >> 2) & 0x03);
+			break;
+		default:
+			move.pos.x = (int8_t)((packed >> 2) & 0x03);
+			move.pos.y = (int8_t)(packed & 0x03);
+			break;
+	}
+
+	return move;
+}
+
+static inline ttchess_bitboard_t
+ttchess_pos_bit(ttchess_pos_t pos) {
+	// Off board positions map to an empty mask so they never match anything
+	if (!(
+		   (0 <= pos.x && pos.x < TTCHESS_BOARD_WIDTH)
+		&& (0 <= pos.y && pos.y < TTCHESS_BOARD_HEIGHT)
+	)) {
+		return 0;
+	}
+
+	return (ttchess_bitboard_t)(1u << (pos.y * TTCHESS_BOARD_WIDTH + pos.x));
+}
+
+static inline ttchess_bitboard_t
+ttchess_board_pawns(const ttchess_board_t* board) {
+	return (ttchess_bitboard_t)(board->pawns[TTCHESS_COLOR_WHITE] | board->pawns[TTCHESS_COLOR_BLACK]);
+}
+
+static inline ttchess_bitboard_t
+ttchess_board_occupied(const ttchess_board_t* board) {
+	return (ttchess_bitboard_t)(ttchess_board_pawns(board) | board->statues);
+}
+
 #endif